@@ -10,6 +10,7 @@
 #include <eosio/chain/asset.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <fc/io/raw.hpp>
+#include <fc/io/json.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <fc/io/varint.hpp>
 
@@ -55,9 +56,30 @@ namespace eosio { namespace chain {
       set_abi(abi, max_serialization_time);
    }
 
+   // the type plans point into the maps, so a copy needs its own
+   abi_serializer::abi_serializer( const abi_serializer& other )
+   :typedefs(other.typedefs)
+   ,structs(other.structs)
+   ,actions(other.actions)
+   ,tables(other.tables)
+   ,error_messages(other.error_messages)
+   ,variants(other.variants)
+   ,built_in_types(other.built_in_types)
+   {
+      build_type_plans();
+   }
+
+   abi_serializer& abi_serializer::operator=( const abi_serializer& other ) {
+      if( this != &other )
+         *this = abi_serializer( other );
+      return *this;
+   }
+
    void abi_serializer::add_specialized_unpack_pack( const string& name,
                                                      std::pair<abi_serializer::unpack_function, abi_serializer::pack_function> unpack_pack ) {
       built_in_types[name] = std::move( unpack_pack );
+      if( !type_plans.empty() )
+         build_type_plans();
    }
 
    void abi_serializer::configure_built_in_types() {
@@ -108,6 +130,8 @@ namespace eosio { namespace chain {
 
       EOS_ASSERT(starts_with(abi.version, "eosio::abi/1."), unsupported_abi_version_exception, "ABI has an unsupported version");
 
+      // plans point into the maps below, drop them first so a throw part way through leaves none dangling
+      type_plans.clear();
       typedefs.clear();
       structs.clear();
       actions.clear();
@@ -148,6 +172,96 @@ namespace eosio { namespace chain {
       EOS_ASSERT( variants.size() == abi.variants.value.size(), duplicate_abi_variant_def_exception, "duplicate variant definition detected" );
 
       validate(ctx);
+      build_type_plans();
+   }
+
+   void abi_serializer::build_type_plans() {
+      type_plans.clear();
+
+      // plans reference each other and structs may be recursive, so plans are created first and linked afterwards
+      vector<type_plan*> unlinked;
+      auto get_plan = [&]( const type_name& type ) -> const type_plan* {
+         auto itr = type_plans.find( type );
+         if( itr != type_plans.end() )
+            return itr->second.get();
+
+         auto plan = std::make_unique<type_plan>();
+         plan->rtype = resolve_type( type );
+         plan->is_array = is_array( plan->rtype );
+         plan->is_optional = is_optional( plan->rtype );
+         auto btype = built_in_types.find( fundamental_type( plan->rtype ) );
+         if( btype != built_in_types.end() )
+            plan->built_in = &btype->second;
+         unlinked.push_back( plan.get() );
+         return type_plans.emplace( type, std::move( plan ) ).first->second.get();
+      };
+
+      for( const auto& t : typedefs )
+         get_plan( t.first );
+      for( const auto& s : structs )
+         get_plan( s.first );
+      for( const auto& v : variants )
+         get_plan( v.first );
+      for( const auto& a : actions )
+         get_plan( a.second );
+      for( const auto& t : tables )
+         get_plan( t.second );
+
+      while( !unlinked.empty() ) {
+         type_plan* plan = unlinked.back();
+         unlinked.pop_back();
+         if( plan->built_in )
+            continue;
+         if( plan->is_array || plan->is_optional ) {
+            plan->element = get_plan( fundamental_type( plan->rtype ) );
+            continue;
+         }
+         plan->variant_itr = variants.find( plan->rtype );
+         if( plan->variant_itr != variants.end() ) {
+            plan->is_variant = true;
+            for( const auto& type : plan->variant_itr->second.types )
+               plan->variant_types.push_back( get_plan( type ) );
+            continue;
+         }
+         plan->struct_itr = structs.find( plan->rtype );
+         if( plan->struct_itr != structs.end() ) {
+            plan->is_struct = true;
+            const auto& st = plan->struct_itr->second;
+            if( st.base != type_name() )
+               plan->base = get_plan( st.base );
+            for( const auto& field : st.fields ) {
+               field_plan f;
+               f.extension = ends_with( field.type, "$" );
+               f.type = get_plan( f.extension ? _remove_bin_extension( field.type ) : field.type );
+               f.json_name = fc::json::to_string( fc::variant( field.name ) );
+               plan->fields.push_back( f );
+            }
+            plan->duplicate_fields = has_duplicate_fields( st );
+         }
+      }
+   }
+
+   bool abi_serializer::has_duplicate_fields( const struct_def& st )const {
+      set<field_name> names;
+      const struct_def* s = &st;
+      for( size_t depth = 0; depth < max_recursion_depth; ++depth ) {
+         for( const auto& field : s->fields ) {
+            if( !names.insert( field.name ).second )
+               return true;
+         }
+         if( s->base == type_name() )
+            return false;
+         auto itr = structs.find( resolve_type( s->base ) );
+         if( itr == structs.end() )
+            return false;
+         s = &itr->second;
+      }
+      return false;
+   }
+
+   const abi_serializer::type_plan* abi_serializer::find_type_plan( const type_name& type )const {
+      auto itr = type_plans.find( type );
+      return itr != type_plans.end() ? itr->second.get() : nullptr;
    }
 
    bool abi_serializer::is_builtin_type(const type_name& type)const {
@@ -312,9 +426,95 @@ namespace eosio { namespace chain {
       }
    }
 
+   void abi_serializer::_binary_to_variant( const type_plan& plan, fc::datastream<const char *>& stream,
+                                            fc::mutable_variant_object& obj, impl::binary_to_variant_context& ctx )const
+   {
+      auto h = ctx.enter_scope();
+      EOS_ASSERT( plan.is_struct, invalid_type_inside_abi, "Unknown type ${type}", ("type",ctx.maybe_shorten(plan.rtype)) );
+      ctx.hint_struct_type_if_in_array( plan.struct_itr );
+      const auto& st = plan.struct_itr->second;
+      if( plan.base ) {
+         _binary_to_variant(*plan.base, stream, obj, ctx);
+      }
+      bool encountered_extension = false;
+      for( uint32_t i = 0; i < plan.fields.size(); ++i ) {
+         const auto& field = st.fields[i];
+         const auto& fplan = plan.fields[i];
+         encountered_extension |= fplan.extension;
+         if( !stream.remaining() ) {
+            if( fplan.extension ) {
+               continue;
+            }
+            if( encountered_extension ) {
+               EOS_THROW( abi_exception, "Encountered field '${f}' without binary extension designation while processing struct '${p}'",
+                          ("f", ctx.maybe_shorten(field.name))("p", ctx.get_path_string()) );
+            }
+            EOS_THROW( unpack_exception, "Stream unexpectedly ended; unable to unpack field '${f}' of struct '${p}'",
+                       ("f", ctx.maybe_shorten(field.name))("p", ctx.get_path_string()) );
+
+         }
+         auto h1 = ctx.push_to_path( impl::field_path_item{ .parent_struct_itr = plan.struct_itr, .field_ordinal = i } );
+         obj( field.name, _binary_to_variant(*fplan.type, stream, ctx) );
+      }
+   }
+
+   fc::variant abi_serializer::_binary_to_variant( const type_plan& plan, fc::datastream<const char *>& stream,
+                                                   impl::binary_to_variant_context& ctx )const
+   {
+      auto h = ctx.enter_scope();
+      if( plan.built_in ) {
+         try {
+            return plan.built_in->first(stream, plan.is_array, plan.is_optional);
+         } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack ${class} type '${type}' while processing '${p}'",
+                                   ("class", plan.is_array ? "array of built-in" : plan.is_optional ? "optional of built-in" : "built-in")
+                                   ("type", fundamental_type(plan.rtype))("p", ctx.get_path_string()) )
+      }
+      if ( plan.is_array ) {
+         ctx.hint_array_type_if_in_array();
+         fc::unsigned_int size;
+         try {
+            fc::raw::unpack(stream, size);
+         } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack size of array '${p}'", ("p", ctx.get_path_string()) )
+         vector<fc::variant> vars;
+         vars.reserve( std::min<size_t>( size.value, stream.remaining() ) );
+         auto h1 = ctx.push_to_path( impl::array_index_path_item{} );
+         for( decltype(size.value) i = 0; i < size; ++i ) {
+            ctx.set_array_index_of_path_back(i);
+            auto v = _binary_to_variant(*plan.element, stream, ctx);
+            EOS_ASSERT( !v.is_null(), unpack_exception, "Invalid packed array '${p}'", ("p", ctx.get_path_string()) );
+            vars.emplace_back(std::move(v));
+         }
+         return fc::variant( std::move(vars) );
+      } else if ( plan.is_optional ) {
+         char flag;
+         try {
+            fc::raw::unpack(stream, flag);
+         } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack presence flag of optional '${p}'", ("p", ctx.get_path_string()) )
+         return flag ? _binary_to_variant(*plan.element, stream, ctx) : fc::variant();
+      } else if( plan.is_variant ) {
+         ctx.hint_variant_type_if_in_array( plan.variant_itr );
+         fc::unsigned_int select;
+         try {
+            fc::raw::unpack(stream, select);
+         } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack tag of variant '${p}'", ("p", ctx.get_path_string()) )
+         EOS_ASSERT( (size_t)select < plan.variant_types.size(), unpack_exception,
+                     "Unpacked invalid tag (${select}) for variant '${p}'", ("select", select.value)("p",ctx.get_path_string()) );
+         auto h1 = ctx.push_to_path( impl::variant_path_item{ .variant_itr = plan.variant_itr, .variant_ordinal = static_cast<uint32_t>(select) } );
+         return vector<fc::variant>{plan.variant_itr->second.types[select], _binary_to_variant(*plan.variant_types[select], stream, ctx)};
+      }
+
+      fc::mutable_variant_object mvo;
+      _binary_to_variant(plan, stream, mvo, ctx);
+      EOS_ASSERT( mvo.size() > 0, unpack_exception, "Unable to unpack '${p}' from stream", ("p", ctx.get_path_string()) );
+      return fc::variant( std::move(mvo) );
+   }
+
    fc::variant abi_serializer::_binary_to_variant( const type_name& type, fc::datastream<const char *>& stream,
                                                    impl::binary_to_variant_context& ctx )const
    {
+      if( const auto* plan = find_type_plan(type) )
+         return _binary_to_variant(*plan, stream, ctx);
+
       auto h = ctx.enter_scope();
       type_name rtype = resolve_type(type);
       auto ftype = fundamental_type(rtype);
@@ -396,6 +596,130 @@ namespace eosio { namespace chain {
       return _binary_to_variant(type, binary, ctx);
    }
 
+   void abi_serializer::_binary_to_json_fields( const type_plan& plan, fc::datastream<const char *>& stream, string& out,
+                                                bool& first_field, impl::binary_to_variant_context& ctx )const
+   {
+      auto h = ctx.enter_scope();
+      EOS_ASSERT( plan.is_struct, invalid_type_inside_abi, "Unknown type ${type}", ("type",ctx.maybe_shorten(plan.rtype)) );
+      ctx.hint_struct_type_if_in_array( plan.struct_itr );
+      const auto& st = plan.struct_itr->second;
+      if( plan.base ) {
+         _binary_to_json_fields(*plan.base, stream, out, first_field, ctx);
+      }
+      bool encountered_extension = false;
+      for( uint32_t i = 0; i < plan.fields.size(); ++i ) {
+         const auto& field = st.fields[i];
+         const auto& fplan = plan.fields[i];
+         encountered_extension |= fplan.extension;
+         if( !stream.remaining() ) {
+            if( fplan.extension ) {
+               continue;
+            }
+            if( encountered_extension ) {
+               EOS_THROW( abi_exception, "Encountered field '${f}' without binary extension designation while processing struct '${p}'",
+                          ("f", ctx.maybe_shorten(field.name))("p", ctx.get_path_string()) );
+            }
+            EOS_THROW( unpack_exception, "Stream unexpectedly ended; unable to unpack field '${f}' of struct '${p}'",
+                       ("f", ctx.maybe_shorten(field.name))("p", ctx.get_path_string()) );
+
+         }
+         auto h1 = ctx.push_to_path( impl::field_path_item{ .parent_struct_itr = plan.struct_itr, .field_ordinal = i } );
+         if( !first_field )
+            out += ',';
+         first_field = false;
+         out += fplan.json_name;
+         out += ':';
+         _binary_to_json(*fplan.type, stream, out, ctx);
+      }
+   }
+
+   void abi_serializer::_binary_to_json( const type_plan& plan, fc::datastream<const char *>& stream, string& out,
+                                         impl::binary_to_variant_context& ctx )const
+   {
+      auto h = ctx.enter_scope();
+      if( plan.built_in ) {
+         fc::variant v;
+         try {
+            v = plan.built_in->first(stream, plan.is_array, plan.is_optional);
+         } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack ${class} type '${type}' while processing '${p}'",
+                                   ("class", plan.is_array ? "array of built-in" : plan.is_optional ? "optional of built-in" : "built-in")
+                                   ("type", fundamental_type(plan.rtype))("p", ctx.get_path_string()) )
+         out += fc::json::to_string( v );
+         return;
+      }
+      if ( plan.is_array ) {
+         ctx.hint_array_type_if_in_array();
+         fc::unsigned_int size;
+         try {
+            fc::raw::unpack(stream, size);
+         } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack size of array '${p}'", ("p", ctx.get_path_string()) )
+         out += '[';
+         auto h1 = ctx.push_to_path( impl::array_index_path_item{} );
+         for( decltype(size.value) i = 0; i < size; ++i ) {
+            ctx.set_array_index_of_path_back(i);
+            if( i > 0 )
+               out += ',';
+            const auto start = out.size();
+            _binary_to_json(*plan.element, stream, out, ctx);
+            EOS_ASSERT( out.compare( start, string::npos, "null" ) != 0, unpack_exception, "Invalid packed array '${p}'", ("p", ctx.get_path_string()) );
+         }
+         out += ']';
+      } else if ( plan.is_optional ) {
+         char flag;
+         try {
+            fc::raw::unpack(stream, flag);
+         } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack presence flag of optional '${p}'", ("p", ctx.get_path_string()) )
+         if( flag )
+            _binary_to_json(*plan.element, stream, out, ctx);
+         else
+            out += "null";
+      } else if( plan.is_variant ) {
+         ctx.hint_variant_type_if_in_array( plan.variant_itr );
+         fc::unsigned_int select;
+         try {
+            fc::raw::unpack(stream, select);
+         } EOS_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack tag of variant '${p}'", ("p", ctx.get_path_string()) )
+         EOS_ASSERT( (size_t)select < plan.variant_types.size(), unpack_exception,
+                     "Unpacked invalid tag (${select}) for variant '${p}'", ("select", select.value)("p",ctx.get_path_string()) );
+         auto h1 = ctx.push_to_path( impl::variant_path_item{ .variant_itr = plan.variant_itr, .variant_ordinal = static_cast<uint32_t>(select) } );
+         out += '[';
+         out += fc::json::to_string( fc::variant( plan.variant_itr->second.types[select] ) );
+         out += ',';
+         _binary_to_json(*plan.variant_types[select], stream, out, ctx);
+         out += ']';
+      } else if( plan.duplicate_fields ) {
+         // a repeated field name keeps the position of its first occurrence and the value of its last one, which the
+         // variant object takes care of
+         fc::mutable_variant_object mvo;
+         _binary_to_variant(plan, stream, mvo, ctx);
+         EOS_ASSERT( mvo.size() > 0, unpack_exception, "Unable to unpack '${p}' from stream", ("p", ctx.get_path_string()) );
+         out += fc::json::to_string( fc::variant( std::move(mvo) ) );
+      } else {
+         bool first_field = true;
+         out += '{';
+         _binary_to_json_fields(plan, stream, out, first_field, ctx);
+         EOS_ASSERT( !first_field, unpack_exception, "Unable to unpack '${p}' from stream", ("p", ctx.get_path_string()) );
+         out += '}';
+      }
+   }
+
+   void abi_serializer::_binary_to_json( const type_name& type, const bytes& binary, string& out, impl::binary_to_variant_context& ctx )const
+   {
+      auto h = ctx.enter_scope();
+      fc::datastream<const char*> ds( binary.data(), binary.size() );
+      if( const auto* plan = find_type_plan(type) ) {
+         _binary_to_json(*plan, ds, out, ctx);
+      } else {
+         out += fc::json::to_string( _binary_to_variant(type, ds, ctx) );
+      }
+   }
+
+   void abi_serializer::binary_to_json( const type_name& type, const bytes& binary, string& out, const fc::microseconds& max_serialization_time, bool short_path )const {
+      impl::binary_to_variant_context ctx(*this, max_serialization_time, type);
+      ctx.short_path = short_path;
+      _binary_to_json(type, binary, out, ctx);
+   }
+
    void abi_serializer::_variant_to_binary( const type_name& type, const fc::variant& var, fc::datastream<char *>& ds, impl::variant_to_binary_context& ctx )const
    { try {
       auto h = ctx.enter_scope();
@@ -547,10 +871,8 @@ namespace eosio { namespace chain {
                      "serialization time limit ${t}us exceeded", ("t", max_serialization_time) );
       }
 
-      fc::scoped_exit<std::function<void()>> abi_traverse_context::enter_scope() {
-         std::function<void()> callback = [old_recursion_depth=recursion_depth, this](){
-            recursion_depth = old_recursion_depth;
-         };
+      scoped_restore<size_t> abi_traverse_context::enter_scope() {
+         scoped_restore<size_t> restore( recursion_depth, recursion_depth );
 
          ++recursion_depth;
          EOS_ASSERT( recursion_depth < abi_serializer::max_recursion_depth, abi_recursion_depth_exception,
@@ -558,7 +880,7 @@ namespace eosio { namespace chain {
 
          check_deadline();
 
-         return {std::move(callback)};
+         return restore;
       }
 
       void abi_traverse_context_with_path::set_path_root( const type_name& type ) {
@@ -579,16 +901,10 @@ namespace eosio { namespace chain {
          }
       }
 
-      fc::scoped_exit<std::function<void()>> abi_traverse_context_with_path::push_to_path( const path_item& item ) {
-         std::function<void()> callback = [this](){
-            EOS_ASSERT( path.size() > 0, abi_exception,
-                        "invariant failure in variant_to_binary_context: path is empty on scope exit" );
-            path.pop_back();
-         };
-
+      scoped_path_item abi_traverse_context_with_path::push_to_path( const path_item& item ) {
          path.push_back( item );
 
-         return {std::move(callback)};
+         return scoped_path_item( path );
       }
 
       void abi_traverse_context_with_path::set_array_index_of_path_back( uint32_t i ) {
@@ -799,16 +1115,14 @@ namespace eosio { namespace chain {
          return s.str();
       }
 
-      fc::scoped_exit<std::function<void()>> variant_to_binary_context::disallow_extensions_unless( bool condition ) {
-         std::function<void()> callback = [old_allow_extensions=allow_extensions, this](){
-            allow_extensions = old_allow_extensions;
-         };
+      scoped_restore<bool> variant_to_binary_context::disallow_extensions_unless( bool condition ) {
+         scoped_restore<bool> restore( allow_extensions, allow_extensions );
 
          if( !condition ) {
             allow_extensions = false;
          }
 
-         return {std::move(callback)};
+         return restore;
       }
    }
 
@@ -0,0 +1,110 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/chain/abi_serializer_cache.hpp>
+#include <eosio/chain/account_object.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+
+namespace eosio { namespace chain {
+
+   namespace detail {
+      using namespace boost::multi_index;
+
+      struct abi_cache_entry {
+         account_name   account;
+         uint64_t       abi_sequence = 0;
+         uint64_t       last_access = 0;
+         cached_abi_ptr abi;
+      };
+
+      struct by_account;
+      struct by_last_access;
+
+      struct abi_serializer_cache_index : public multi_index_container<
+         abi_cache_entry,
+         indexed_by<
+            hashed_unique< tag<by_account>, member<abi_cache_entry, account_name, &abi_cache_entry::account>, std::hash<account_name> >,
+            ordered_unique< tag<by_last_access>, member<abi_cache_entry, uint64_t, &abi_cache_entry::last_access> >
+         >
+      > {};
+   }
+
+   abi_serializer_cache::abi_serializer_cache( uint32_t max_size )
+   :max_size( max_size )
+   ,index( new detail::abi_serializer_cache_index() )
+   {}
+
+   abi_serializer_cache::~abi_serializer_cache() {}
+
+   cached_abi_ptr abi_serializer_cache::get( const chainbase::database& db, account_name n, const fc::microseconds& max_serialization_time ) {
+      const auto* accnt = db.find<account_object, by_name>( n );
+      if( accnt == nullptr || abi_serializer::is_empty_abi( accnt->abi ) )
+         return cached_abi_ptr();
+      const uint64_t abi_sequence = db.get<account_sequence_object, by_name>( n ).abi_sequence;
+
+      std::unique_lock<std::mutex> g( mtx );
+      auto& by_account = index->get<detail::by_account>();
+      auto itr = by_account.find( n );
+      if( itr != by_account.end() ) {
+         if( itr->abi_sequence == abi_sequence ) {
+            by_account.modify( itr, [&]( auto& e ) { e.last_access = ++access_counter; } );
+            return itr->abi;
+         }
+         by_account.erase( itr );
+      }
+      g.unlock();
+
+      // build outside of the lock, this is the expensive part
+      auto result = std::make_shared<cached_abi>();
+      abi_serializer::to_abi( accnt->abi, result->abi );
+      result->serializer.set_abi( result->abi, max_serialization_time );
+
+      g.lock();
+      if( max_size == 0 )
+         return result;
+      by_account.erase( n ); // another thread may have raced us
+      purge();
+      detail::abi_cache_entry entry;
+      entry.account = n;
+      entry.abi_sequence = abi_sequence;
+      entry.last_access = ++access_counter;
+      entry.abi = result;
+      index->insert( std::move( entry ) );
+      return result;
+   }
+
+   void abi_serializer_cache::erase( account_name n ) {
+      std::lock_guard<std::mutex> g( mtx );
+      index->get<detail::by_account>().erase( n );
+   }
+
+   void abi_serializer_cache::purge() {
+      auto& by_last_access = index->get<detail::by_last_access>();
+      while( !by_last_access.empty() && by_last_access.size() >= max_size )
+         by_last_access.erase( by_last_access.begin() );
+   }
+
+   void abi_serializer_cache::set_max_size( uint32_t max ) {
+      std::lock_guard<std::mutex> g( mtx );
+      max_size = max;
+      auto& by_last_access = index->get<detail::by_last_access>();
+      while( by_last_access.size() > max_size )
+         by_last_access.erase( by_last_access.begin() );
+   }
+
+   uint32_t abi_serializer_cache::size()const {
+      std::lock_guard<std::mutex> g( mtx );
+      return index->size();
+   }
+
+   void abi_serializer_cache::clear() {
+      std::lock_guard<std::mutex> g( mtx );
+      index->clear();
+   }
+
+} } /// eosio::chain
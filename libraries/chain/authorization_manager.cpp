@@ -141,6 +141,8 @@ namespace eosio { namespace chain {
                                                                       time_point initial_creation_time
                                                                     )
    {
+      mark_permissions_modified( account );
+
       auto creation_time = initial_creation_time;
       if( creation_time == time_point() ) {
          creation_time = _control.pending_block_time();
@@ -168,6 +170,8 @@ namespace eosio { namespace chain {
                                                                       time_point initial_creation_time
                                                                     )
    {
+      mark_permissions_modified( account );
+
       auto creation_time = initial_creation_time;
       if( creation_time == time_point() ) {
          creation_time = _control.pending_block_time();
@@ -189,6 +193,7 @@ namespace eosio { namespace chain {
    }
 
    void authorization_manager::modify_permission( const permission_object& permission, const authority& auth ) {
+      mark_permissions_modified( permission.owner );
       _db.modify( permission, [&](permission_object& po) {
          po.auth = auth;
          po.last_updated = _control.pending_block_time();
@@ -201,6 +206,7 @@ namespace eosio { namespace chain {
       EOS_ASSERT( range.first == range.second, action_validate_exception,
                   "Cannot remove a permission which has children. Remove the children first.");
 
+      mark_permissions_modified( permission.owner );
       _db.get_mutable_index<permission_usage_index>().remove_object( permission.usage_id._id );
       _db.remove( permission );
    }
@@ -216,6 +222,29 @@ namespace eosio { namespace chain {
       return _db.get<permission_usage_object, by_id>( permission.usage_id ).last_used;
    }
 
+   void authorization_manager::reset_authority_cache() {
+      _authority_cache.clear();
+      _linked_permission_cache.clear();
+      _modified_accounts.clear();
+   }
+
+   void authorization_manager::mark_permissions_modified( account_name account ) {
+      _modified_accounts.insert( account );
+   }
+
+   const flat_authority& authorization_manager::get_flat_authority( const permission_level& level )const {
+      auto itr = _authority_cache.find( level );
+      if( itr != _authority_cache.end() && _modified_accounts.find( level.actor ) == _modified_accounts.end() )
+         return itr->second;
+
+      // permissions of a modified account are resolved on every lookup; authority_checker never looks up a permission
+      // again while it is still evaluating it, so the entry replaced here is not in use
+      const auto& permission = get_permission( level );
+      auto& entry = _authority_cache[level];
+      entry = flat_authority( permission.auth );
+      return entry;
+   }
+
    const permission_object*  authorization_manager::find_permission( const permission_level& level )const
    { try {
       EOS_ASSERT( !level.actor.empty() && !level.permission.empty(), invalid_permission, "Invalid permission" );
@@ -233,6 +262,14 @@ namespace eosio { namespace chain {
                                                                               action_name act_name
                                                                             )const
    {
+      const bool cacheable = _modified_accounts.find( authorizer_account ) == _modified_accounts.end();
+      auto cache_key = std::make_tuple( authorizer_account, scope, act_name );
+      if( cacheable ) {
+         auto itr = _linked_permission_cache.find( cache_key );
+         if( itr != _linked_permission_cache.end() )
+            return itr->second;
+      }
+
       try {
          // First look up a specific link for this message act_name
          auto key = boost::make_tuple(authorizer_account, scope, act_name);
@@ -244,10 +281,14 @@ namespace eosio { namespace chain {
          }
 
          // If no specific or default link found, use active permission
+         optional<permission_name> linked_permission;
          if (link != nullptr) {
-            return link->required_permission;
+            linked_permission = link->required_permission;
+         }
+         if( cacheable ) {
+            _linked_permission_cache.emplace( cache_key, linked_permission );
          }
-         return optional<permission_name>();
+         return linked_permission;
 
        //  return optional<permission_name>();
       } FC_CAPTURE_AND_RETHROW((authorizer_account)(scope)(act_name))
@@ -442,7 +483,7 @@ namespace eosio { namespace chain {
 
       auto effective_provided_delay =  (provided_delay >= delay_max_limit) ? fc::microseconds::maximum() : provided_delay;
 
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+      auto checker = make_auth_checker( [&](const permission_level& p) -> const flat_authority& { return get_flat_authority(p); },
                                         _control.get_global_properties().configuration.max_authority_depth,
                                         provided_keys,
                                         provided_permissions,
@@ -543,7 +584,7 @@ namespace eosio { namespace chain {
 
       auto delay_max_limit = fc::seconds( _control.get_global_properties().configuration.max_transaction_delay );
 
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+      auto checker = make_auth_checker( [&](const permission_level& p) -> const flat_authority& { return get_flat_authority(p); },
                                         _control.get_global_properties().configuration.max_authority_depth,
                                         provided_keys,
                                         provided_permissions,
@@ -574,7 +615,7 @@ namespace eosio { namespace chain {
                                                                        fc::microseconds provided_delay
                                                                      )const
    {
-      auto checker = make_auth_checker( [&](const permission_level& p){ return get_permission(p).auth; },
+      auto checker = make_auth_checker( [&](const permission_level& p) -> const flat_authority& { return get_flat_authority(p); },
                                         _control.get_global_properties().configuration.max_authority_depth,
                                         candidate_keys,
                                         {},
@@ -7,6 +7,20 @@
 #include <fstream>
 #include <fc/io/raw.hpp>
 
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <regex>
+#include <thread>
+
 #define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
 
@@ -22,7 +36,210 @@ namespace eosio { namespace chain {
     */
    const uint32_t block_log::max_supported_version = 2;
 
+   /**
+    * History:
+    * Version 1: zlib compressed blocks with a separate index of their positions
+    */
+   const uint32_t block_log::segment_version = 1;
+
    namespace detail {
+      namespace bip = boost::interprocess;
+      namespace bio = boost::iostreams;
+
+      static vector<char> zlib_compress_bytes( const char* data, size_t size ) {
+         vector<char> out;
+         bio::filtering_ostream comp;
+         comp.push(bio::zlib_compressor(bio::zlib::default_compression));
+         comp.push(bio::back_inserter(out));
+         bio::write(comp, data, size);
+         bio::close(comp);
+         return out;
+      }
+
+      static vector<char> zlib_decompress_bytes( const vector<char>& in ) {
+         vector<char> out;
+         bio::filtering_ostream decomp;
+         decomp.push(bio::zlib_decompressor());
+         decomp.push(bio::back_inserter(out));
+         bio::write(decomp, in.data(), in.size());
+         bio::close(decomp);
+         return out;
+      }
+
+      /**
+       * An immutable range of blocks before the start of blocks.log. A full blocks.log is sealed by renaming it to an
+       * uncompressed segment, which keeps the layout of blocks.log, and is then compressed in the background.
+       */
+      struct block_log_segment {
+         uint32_t first_block_num = 0;
+         uint32_t last_block_num = 0;
+         bool     compressed = false;
+         fc::path log_file;
+         fc::path index_file;
+
+         block_log_segment() = default;
+         block_log_segment( const fc::path& data_dir, uint32_t first, uint32_t last, bool compressed )
+         :first_block_num(first), last_block_num(last), compressed(compressed) {
+            char name[64];
+            snprintf( name, sizeof(name), "blocks-%010u-%010u", first, last );
+            log_file = data_dir / (std::string(name) + (compressed ? ".zlog" : ".log"));
+            index_file = data_dir / (std::string(name) + (compressed ? ".zindex" : ".index"));
+         }
+
+         uint32_t size()const { return last_block_num - first_block_num + 1; }
+      };
+
+      static bool parse_segment_file_name( const std::string& name, uint32_t& first, uint32_t& last, bool& compressed ) {
+         static const std::regex segment_name( "blocks-([0-9]+)-([0-9]+)\\.(zlog|log)" );
+         std::smatch m;
+         if( !std::regex_match( name, m, segment_name ) )
+            return false;
+         first = std::stoul( m[1].str() );
+         last = std::stoul( m[2].str() );
+         compressed = m[3].str() == "zlog";
+         return true;
+      }
+
+      static bool is_segment_file( const std::string& name ) {
+         static const std::regex segment_file( "blocks-[0-9]+-[0-9]+\\.(zlog|zindex|log|index)" );
+         return std::regex_match( name, segment_file );
+      }
+
+      /// writes the header of a blocks.log which starts at first_block_num and has no blocks yet
+      static void write_log_header( std::fstream& stream, uint32_t first_block_num, const genesis_state& gs ) {
+         const uint32_t version = block_log::max_supported_version;
+         stream.write((char*)&version, sizeof(version));
+         stream.write((char*)&first_block_num, sizeof(first_block_num));
+         auto data = fc::raw::pack(gs);
+         stream.write(data.data(), data.size());
+         auto totem = block_log::npos;
+         stream.write((char*)&totem, sizeof(totem));
+      }
+
+      /// the number of the first block of a blocks.log or of an uncompressed segment
+      static uint32_t read_first_block_num( const fc::path& block_file ) {
+         std::fstream block_stream;
+         block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+         block_stream.open(block_file.generic_string().c_str(), LOG_READ);
+         uint32_t version = 0;
+         block_stream.read((char*)&version, sizeof(version));
+         EOS_ASSERT( version >= block_log::min_supported_version && version <= block_log::max_supported_version, block_log_unsupported_version,
+                     "Unsupported version of block log ${f}: ${v}", ("f", block_file.generic_string())("v", version) );
+         uint32_t first_block_num = 1;
+         if (version > 1)
+            block_stream.read((char*)&first_block_num, sizeof(first_block_num));
+         return first_block_num;
+      }
+
+      /// rebuilds the index of the block positions of a blocks.log or of an uncompressed segment
+      static void construct_log_index( const fc::path& block_file, const fc::path& index_file ) {
+         std::fstream block_stream;
+         std::fstream index_stream;
+         block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+         index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+         block_stream.open(block_file.generic_string().c_str(), LOG_READ);
+         index_stream.open(index_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+         uint64_t end_pos;
+         block_stream.seekg(-sizeof(uint64_t), std::ios::end);
+         block_stream.read((char*)&end_pos, sizeof(end_pos));
+         if (end_pos == block_log::npos)
+            return; // only the totem, no blocks
+
+         uint32_t version = 0;
+         block_stream.seekg(0);
+         block_stream.read((char*)&version, sizeof(version));
+         uint64_t pos = sizeof(version);
+         if (version > 1) {
+            uint32_t first_block_num;
+            block_stream.read((char*)&first_block_num, sizeof(first_block_num));
+            pos += sizeof(first_block_num);
+         }
+
+         genesis_state gs;
+         fc::raw::unpack(block_stream, gs);
+
+         // skip the totem
+         if (version > 1) {
+            uint64_t totem;
+            block_stream.read((char*)&totem, sizeof(totem));
+         }
+
+         signed_block tmp;
+         while( pos < end_pos ) {
+            fc::raw::unpack(block_stream, tmp);
+            block_stream.read((char*)&pos, sizeof(pos));
+            index_stream.write((char*)&pos, sizeof(pos));
+         }
+      }
+
+      /**
+       * Writes the compressed segment to from the uncompressed segment from, through temporary files which are renamed
+       * into place once complete. Returns false, leaving no files behind, if stop is set before it is done.
+       */
+      static bool write_compressed_segment( const block_log_segment& from, const block_log_segment& to, const std::atomic<bool>& stop ) {
+         ilog("Compressing blocks ${f} through ${l} into block log segment ${s}",
+              ("f", from.first_block_num)("l", from.last_block_num)("s", to.log_file.generic_string()));
+
+         const fc::path tmp_log_file = to.log_file.generic_string() + ".tmp";
+         const fc::path tmp_index_file = to.index_file.generic_string() + ".tmp";
+         bool done = false;
+         try {
+            std::fstream from_log_stream;
+            std::fstream from_index_stream;
+            std::fstream log_stream;
+            std::fstream index_stream;
+            from_log_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+            from_index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+            log_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+            index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+            from_log_stream.open(from.log_file.generic_string().c_str(), LOG_READ);
+            from_index_stream.open(from.index_file.generic_string().c_str(), LOG_READ);
+            log_stream.open(tmp_log_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            index_stream.open(tmp_index_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+            vector<uint64_t> positions(from.size());
+            from_index_stream.read((char*)positions.data(), positions.size() * sizeof(uint64_t));
+            // every block is followed by its own position
+            const uint64_t blocks_end = fc::file_size(from.log_file) - sizeof(uint64_t);
+
+            log_stream.write((char*)&block_log::segment_version, sizeof(block_log::segment_version));
+            log_stream.write((char*)&from.first_block_num, sizeof(from.first_block_num));
+
+            uint64_t pos = sizeof(block_log::segment_version) + sizeof(from.first_block_num);
+            vector<char> packed;
+            for (size_t i = 0; i < positions.size() && !stop; ++i) {
+               const uint64_t end = i + 1 < positions.size() ? positions[i+1] - sizeof(uint64_t) : blocks_end;
+               EOS_ASSERT(end > positions[i], block_log_exception, "Index of block log segment ${f} is corrupt at block ${n}",
+                          ("f", from.log_file.generic_string())("n", from.first_block_num + i));
+               packed.resize(end - positions[i]);
+               from_log_stream.seekg(positions[i]);
+               from_log_stream.read(packed.data(), packed.size());
+               auto compressed = zlib_compress_bytes(packed.data(), packed.size());
+               uint32_t size = compressed.size();
+               index_stream.write((char*)&pos, sizeof(pos));
+               log_stream.write((char*)&size, sizeof(size));
+               log_stream.write(compressed.data(), compressed.size());
+               pos += sizeof(size) + size;
+            }
+            done = !stop;
+         } catch( ... ) {
+            fc::remove_all(tmp_index_file);
+            fc::remove_all(tmp_log_file);
+            throw;
+         }
+
+         if (!done) {
+            fc::remove_all(tmp_index_file);
+            fc::remove_all(tmp_log_file);
+            return false;
+         }
+         // the index is renamed first so a segment is never visible without it
+         fc::rename(tmp_index_file, to.index_file);
+         fc::rename(tmp_log_file, to.log_file);
+         return true;
+      }
+
       class block_log_impl {
          public:
             signed_block_ptr         head;
@@ -36,6 +253,142 @@ namespace eosio { namespace chain {
             bool                     genesis_written_to_block_log = false;
             uint32_t                 version = 0;
             uint32_t                 first_block_num = 0;
+            bool                     mmap_reads = false;
+            std::shared_ptr<bip::mapped_region> block_region;
+            std::shared_ptr<bip::mapped_region> index_region;
+            fc::path                 data_dir;
+            uint32_t                 segment_size = 0;
+            vector<block_log_segment> segments; ///< sorted and contiguous, all before first_block_num
+            std::fstream             segment_block_stream;
+            std::fstream             segment_index_stream;
+            uint32_t                 open_segment = 0; ///< first block number of the segment the streams are open on
+
+            /// guards segments and the segment streams, the compression thread replaces segments once compressed
+            std::mutex               segment_mutex;
+            std::condition_variable  compression_cv;
+            std::thread              compression_thread;
+            bool                     compression_running = false;
+            std::atomic<bool>        stop_compression{false};
+
+            ~block_log_impl() {
+               stop_compressing();
+            }
+
+            bool has_uncompressed_segment()const {
+               return std::any_of( segments.begin(), segments.end(), []( const auto& seg ) { return !seg.compressed; } );
+            }
+
+            /// compresses the sealed segments on a background thread, one at a time and oldest first
+            void start_compressing() {
+               {
+                  std::lock_guard<std::mutex> g( segment_mutex );
+                  if( compression_running ) {
+                     compression_cv.notify_all();
+                     return;
+                  }
+                  compression_running = true;
+               }
+               if( compression_thread.joinable() )
+                  compression_thread.join();
+               compression_thread = std::thread( [this]() { compress_segments(); } );
+            }
+
+            /// interrupts the compression thread, a partly compressed segment is started over the next time
+            void stop_compressing() {
+               {
+                  std::lock_guard<std::mutex> g( segment_mutex );
+                  stop_compression = true;
+               }
+               compression_cv.notify_all();
+               if( compression_thread.joinable() )
+                  compression_thread.join();
+               stop_compression = false;
+            }
+
+            void wait_for_compression() {
+               std::unique_lock<std::mutex> lock( segment_mutex );
+               compression_cv.wait( lock, [this]() { return !compression_running || !has_uncompressed_segment(); } );
+            }
+
+            void compress_segments() {
+               std::unique_lock<std::mutex> lock( segment_mutex );
+               while( true ) {
+                  compression_cv.wait( lock, [this]() { return stop_compression || has_uncompressed_segment(); } );
+                  if( stop_compression )
+                     break;
+                  const block_log_segment from = *std::find_if( segments.begin(), segments.end(),
+                                                                []( const auto& seg ) { return !seg.compressed; } );
+                  const block_log_segment to( data_dir, from.first_block_num, from.last_block_num, true );
+                  lock.unlock();
+
+                  bool done = false;
+                  try {
+                     done = write_compressed_segment( from, to, stop_compression );
+                  } catch( const fc::exception& e ) {
+                     elog( "Failed to compress block log segment ${f}: ${e}", ("f", from.log_file.generic_string())("e", e.to_detail_string()) );
+                  } catch( const std::exception& e ) {
+                     elog( "Failed to compress block log segment ${f}: ${e}", ("f", from.log_file.generic_string())("e", e.what()) );
+                  }
+
+                  lock.lock();
+                  // a segment which fails to compress stays readable as it is, it is tried again after the next seal
+                  if( !done )
+                     break;
+                  for( auto& seg : segments ) {
+                     if( seg.first_block_num == from.first_block_num ) {
+                        seg = to;
+                        break;
+                     }
+                  }
+                  if( open_segment == from.first_block_num )
+                     close_segment();
+                  fc::remove_all( from.log_file );
+                  fc::remove_all( from.index_file );
+                  compression_cv.notify_all();
+               }
+               compression_running = false;
+               compression_cv.notify_all();
+            }
+
+            inline void close_segment() {
+               if (segment_block_stream.is_open())
+                  segment_block_stream.close();
+               if (segment_index_stream.is_open())
+                  segment_index_stream.close();
+               open_segment = 0;
+            }
+
+            const block_log_segment* find_segment( uint32_t block_num )const {
+               auto itr = std::upper_bound( segments.begin(), segments.end(), block_num,
+                                            []( uint32_t n, const block_log_segment& seg ) { return n < seg.first_block_num; } );
+               if( itr == segments.begin() )
+                  return nullptr;
+               --itr;
+               return block_num <= itr->last_block_num ? &*itr : nullptr;
+            }
+
+            /**
+             * Returns a read only mapping of file covering at least min_size bytes. The file is only appended to,
+             * so an existing mapping is reused until a read goes past its end, at which point the whole file is
+             * mapped again. Readers holding the previous mapping keep it alive through their shared_ptr.
+             */
+            static const std::shared_ptr<bip::mapped_region>& map_file( std::shared_ptr<bip::mapped_region>& region,
+                                                                         const fc::path& file, uint64_t min_size ) {
+               if( !region || region->get_size() < min_size ) {
+                  region.reset();
+                  uint64_t size = fc::file_size( file );
+                  EOS_ASSERT( size >= min_size, block_log_exception, "read past the end of ${file}",
+                              ("file", file.generic_string())("size", size)("required", min_size) );
+                  bip::file_mapping mapping( file.generic_string().c_str(), bip::read_only );
+                  region = std::make_shared<bip::mapped_region>( mapping, bip::read_only, 0, size );
+               }
+               return region;
+            }
+
+            inline void unmap() {
+               block_region.reset();
+               index_region.reset();
+            }
 
             inline void check_block_read() {
                if (block_write) {
@@ -74,10 +427,14 @@ namespace eosio { namespace chain {
       };
    }
 
-   block_log::block_log(const fc::path& data_dir)
+   block_log::block_log(const fc::path& data_dir, bool mmap_reads, uint32_t segment_size)
    :my(new detail::block_log_impl()) {
+      my->mmap_reads = mmap_reads;
+      my->segment_size = segment_size;
       my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->segment_block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      my->segment_index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       open(data_dir);
    }
 
@@ -93,6 +450,7 @@ namespace eosio { namespace chain {
    }
 
    void block_log::open(const fc::path& data_dir) {
+      my->unmap();
       if (my->block_stream.is_open())
          my->block_stream.close();
       if (my->index_stream.is_open())
@@ -100,9 +458,26 @@ namespace eosio { namespace chain {
 
       if (!fc::is_directory(data_dir))
          fc::create_directories(data_dir);
+      my->data_dir = data_dir;
       my->block_file = data_dir / "blocks.log";
       my->index_file = data_dir / "blocks.index";
 
+      // a seal which was interrupted after blocks.log was moved into its segment is completed by the new blocks.log,
+      // an interrupted split leaves blocks.log as it was and is resumed below
+      const fc::path tmp_block_file = my->block_file.generic_string() + ".tmp";
+      if (fc::exists(tmp_block_file)) {
+         if (fc::exists(my->block_file))
+            fc::remove_all(tmp_block_file);
+         else
+            fc::rename(tmp_block_file, my->block_file);
+      }
+      for (const auto& f : { my->block_file, my->index_file }) {
+         fc::remove_all(f.generic_string() + ".split");
+         fc::remove_all(f.generic_string() + ".split.tmp");
+      }
+
+      load_segments();
+
       //ilog("Opening block log at ${path}", ("path", my->block_file.generic_string()));
       my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
       my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
@@ -151,10 +526,28 @@ namespace eosio { namespace chain {
             my->first_block_num = 1;
          }
 
-         my->head = read_head();
-         my->head_id = my->head->id();
+         auto log_head = read_log_head();
+         my->head = log_head ? log_head : read_head();
+         if (my->head)
+            my->head_id = my->head->id();
+
+         if (!my->segments.empty()) {
+            const auto& last_segment = my->segments.back();
+            // segments overlap blocks.log when a split of it was interrupted
+            EOS_ASSERT(last_segment.last_block_num + 1 >= my->first_block_num, block_log_exception,
+                       "Block log segments end at block ${s} but blocks.log starts at block ${b}",
+                       ("s", last_segment.last_block_num)("b", my->first_block_num));
+         }
 
-         if (index_size) {
+         if (!log_head) {
+            if (index_size) {
+               ilog("Log has no blocks, remove and recreate index");
+               my->index_stream.close();
+               fc::remove_all(my->index_file);
+               my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
+               my->index_write = true;
+            }
+         } else if (index_size) {
             my->check_block_read();
             my->check_index_read();
 
@@ -185,6 +578,9 @@ namespace eosio { namespace chain {
          my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
          my->index_write = true;
       }
+
+      if (my->segment_size && my->head && block_header::num_from_id(my->head_id) + 1 - my->first_block_num >= my->segment_size)
+         split_log();
    }
 
    uint64_t block_log::append(const signed_block_ptr& b) {
@@ -209,6 +605,9 @@ namespace eosio { namespace chain {
 
          flush();
 
+         if (my->segment_size && b->block_num() + 1 - my->first_block_num >= my->segment_size)
+            seal_log();
+
          return pos;
       }
       FC_LOG_AND_RETHROW()
@@ -221,6 +620,7 @@ namespace eosio { namespace chain {
 
    // 将区块log重置到创世状态
    void block_log::reset( const genesis_state& gs, const signed_block_ptr& first_block, uint32_t first_block_num ) {
+      my->unmap();
       if (my->block_stream.is_open())
          my->block_stream.close();
       if (my->index_stream.is_open())
@@ -229,6 +629,17 @@ namespace eosio { namespace chain {
       fc::remove_all( my->block_file ); // 删除block文件
       fc::remove_all( my->index_file ); // 删除区块索引
 
+      my->stop_compressing();
+      {
+         std::lock_guard<std::mutex> g( my->segment_mutex );
+         my->close_segment();
+         for (const auto& seg : my->segments) {
+            fc::remove_all( seg.log_file );
+            fc::remove_all( seg.index_file );
+         }
+         my->segments.clear();
+      }
+
       my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
       my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
       my->block_write = true;
@@ -267,11 +678,20 @@ namespace eosio { namespace chain {
    }
 
    std::pair<signed_block_ptr, uint64_t> block_log::read_block(uint64_t pos)const {
+      std::pair<signed_block_ptr,uint64_t> result;
+      result.first = std::make_shared<signed_block>();
+
+      if (my->mmap_reads) {
+         const auto& region = my->map_file(my->block_region, my->block_file, pos + 1);
+         fc::datastream<const char*> ds(static_cast<const char*>(region->get_address()) + pos, region->get_size() - pos);
+         fc::raw::unpack(ds, *result.first);
+         result.second = pos + ds.tellp() + 8;
+         return result;
+      }
+
       my->check_block_read();
 
       my->block_stream.seekg(pos);
-      std::pair<signed_block_ptr,uint64_t> result;
-      result.first = std::make_shared<signed_block>();
       fc::raw::unpack(my->block_stream, *result.first);
       result.second = uint64_t(my->block_stream.tellg()) + 8;
       return result;
@@ -280,6 +700,16 @@ namespace eosio { namespace chain {
    signed_block_ptr block_log::read_block_by_num(uint32_t block_num)const {
       try {
          signed_block_ptr b;
+         if (block_num < my->first_block_num) {
+            auto packed = read_segment_block(block_num);
+            if (!packed.empty()) {
+               b = std::make_shared<signed_block>();
+               fc::raw::unpack(packed, *b);
+               EOS_ASSERT(b->block_num() == block_num, block_log_exception,
+                         "Wrong block was read from block log segment.", ("returned", b->block_num())("expected", block_num));
+            }
+            return b;
+         }
          uint64_t pos = get_block_pos(block_num);
          if (pos != npos) {
             b = read_block(pos).first;
@@ -290,18 +720,81 @@ namespace eosio { namespace chain {
       } FC_LOG_AND_RETHROW()
    }
 
+   packed_block_span block_log::read_packed_block_by_num(uint32_t block_num)const {
+      try {
+         packed_block_span result;
+         if (block_num < my->first_block_num) {
+            auto packed = std::make_shared<vector<char>>(read_segment_block(block_num));
+            if (!packed->empty()) {
+               result.data = packed->data();
+               result.size = packed->size();
+               result.storage = std::move(packed);
+            }
+            return result;
+         }
+         uint64_t pos = get_block_pos(block_num);
+         if (pos == npos)
+            return result;
+
+         // every block is followed by its own position, so the next block starts 8 bytes after the end of this one
+         uint64_t end_pos;
+         if (block_num == block_header::num_from_id(my->head_id)) {
+            end_pos = pos + fc::raw::pack_size(*my->head);
+         } else {
+            end_pos = get_block_pos(block_num + 1) - sizeof(uint64_t);
+         }
+         EOS_ASSERT(end_pos > pos, block_log_exception, "Block log index is corrupt at block ${n}", ("n", block_num));
+         result.size = end_pos - pos;
+
+         if (my->mmap_reads) {
+            auto region = my->map_file(my->block_region, my->block_file, end_pos);
+            result.data = static_cast<const char*>(region->get_address()) + pos;
+            result.storage = std::move(region);
+         } else {
+            my->check_block_read();
+            auto buffer = std::make_shared<vector<char>>(result.size);
+            my->block_stream.seekg(pos);
+            my->block_stream.read(buffer->data(), buffer->size());
+            result.data = buffer->data();
+            result.storage = std::move(buffer);
+         }
+         return result;
+      } FC_LOG_AND_RETHROW()
+   }
+
    uint64_t block_log::get_block_pos(uint32_t block_num) const {
-      my->check_index_read();
       if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num >= my->first_block_num))
          return npos;
-      my->index_stream.seekg(sizeof(uint64_t) * (block_num - my->first_block_num));
+      uint64_t offset = sizeof(uint64_t) * (block_num - my->first_block_num);
       uint64_t pos;
+      if (my->mmap_reads) {
+         const auto& region = my->map_file(my->index_region, my->index_file, offset + sizeof(pos));
+         memcpy(&pos, static_cast<const char*>(region->get_address()) + offset, sizeof(pos));
+         return pos;
+      }
+      my->check_index_read();
+      my->index_stream.seekg(offset);
       my->index_stream.read((char*)&pos, sizeof(pos));
       return pos;
    }
 
-   // 获取 block_log 当前指示位置, 也就是 my->block_stream 的当前位置
    signed_block_ptr block_log::read_head()const {
+      auto head = read_log_head();
+      if (!head) {
+         uint32_t last_segment_block = 0;
+         {
+            std::lock_guard<std::mutex> g( my->segment_mutex );
+            if (!my->segments.empty())
+               last_segment_block = my->segments.back().last_block_num;
+         }
+         if (last_segment_block)
+            head = read_block_by_num(last_segment_block);
+      }
+      return head;
+   }
+
+   // 获取 block_log 当前指示位置, 也就是 my->block_stream 的当前位置
+   signed_block_ptr block_log::read_log_head()const {
       my->check_block_read();
 
       uint64_t pos;
@@ -325,45 +818,277 @@ namespace eosio { namespace chain {
    }
 
    uint32_t block_log::first_block_num() const {
-      return my->first_block_num;
+      std::lock_guard<std::mutex> g( my->segment_mutex );
+      return my->segments.empty() ? my->first_block_num : my->segments.front().first_block_num;
    }
 
-   void block_log::construct_index() {
-      ilog("Reconstructing Block Log Index...");
+   void block_log::wait_for_compression() {
+      my->wait_for_compression();
+   }
+
+   void block_log::load_segments() {
+      bool uncompressed = false;
+      {
+         std::lock_guard<std::mutex> g( my->segment_mutex );
+         my->close_segment();
+         my->segments.clear();
+
+         std::map<std::pair<uint32_t, uint32_t>, detail::block_log_segment> found;
+         for (boost::filesystem::directory_iterator itr(my->data_dir.generic_string()), end; itr != end; ++itr) {
+            uint32_t first = 0, last = 0;
+            bool compressed = false;
+            if (!detail::parse_segment_file_name(itr->path().filename().generic_string(), first, last, compressed))
+               continue;
+            EOS_ASSERT(first > 0 && first <= last, block_log_exception, "Invalid block log segment ${f}",
+                       ("f", itr->path().generic_string()));
+            detail::block_log_segment seg(my->data_dir, first, last, compressed);
+            auto res = found.emplace(std::make_pair(first, last), seg);
+            if (!res.second && compressed)
+               res.first->second = seg;
+         }
+
+         for (const auto& f : found) {
+            const auto& seg = f.second;
+            if (seg.compressed) {
+               // the compression finished but the uncompressed segment was not removed yet
+               detail::block_log_segment sealed(my->data_dir, seg.first_block_num, seg.last_block_num, false);
+               fc::remove_all(sealed.log_file);
+               fc::remove_all(sealed.index_file);
+            }
+            if (!my->segments.empty()) {
+               EOS_ASSERT(seg.first_block_num == my->segments.back().last_block_num + 1, block_log_exception,
+                          "Block log segments are not contiguous, block ${n} is missing", ("n", my->segments.back().last_block_num + 1));
+            }
+            if (!fc::exists(seg.index_file) || fc::file_size(seg.index_file) != sizeof(uint64_t) * seg.size()) {
+               if (seg.compressed) {
+                  construct_segment_index(seg);
+               } else {
+                  ilog("Reconstructing index of block log segment ${f}", ("f", seg.log_file.generic_string()));
+                  detail::construct_log_index(seg.log_file, seg.index_file);
+               }
+            }
+            uncompressed |= !seg.compressed;
+            my->segments.push_back(seg);
+         }
+
+         if (!my->segments.empty())
+            ilog("Block log segments contain blocks ${f} through ${l}",
+                 ("f", my->segments.front().first_block_num)("l", my->segments.back().last_block_num));
+      }
+
+      if (uncompressed)
+         my->start_compressing();
+   }
+
+   void block_log::construct_segment_index(const detail::block_log_segment& seg) {
+      ilog("Reconstructing index of block log segment ${f}", ("f", seg.log_file.generic_string()));
+
+      std::fstream log_stream;
+      std::fstream index_stream;
+      log_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+      log_stream.open(seg.log_file.generic_string().c_str(), LOG_READ);
+      index_stream.open(seg.index_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+
+      uint32_t version = 0;
+      uint32_t first_block_num = 0;
+      log_stream.read((char*)&version, sizeof(version));
+      log_stream.read((char*)&first_block_num, sizeof(first_block_num));
+      EOS_ASSERT(version > 0 && version <= segment_version, block_log_unsupported_version,
+                 "Unsupported version of block log segment ${f}: ${v}", ("f", seg.log_file.generic_string())("v", version));
+      EOS_ASSERT(first_block_num == seg.first_block_num, block_log_exception,
+                 "Block log segment ${f} starts at block ${n}", ("f", seg.log_file.generic_string())("n", first_block_num));
+
+      uint64_t end_pos = fc::file_size(seg.log_file);
+      uint64_t pos = log_stream.tellg();
+      for (uint32_t n = seg.first_block_num; n <= seg.last_block_num; ++n) {
+         EOS_ASSERT(pos < end_pos, block_log_exception, "Block log segment ${f} ends before block ${n}",
+                    ("f", seg.log_file.generic_string())("n", n));
+         index_stream.write((char*)&pos, sizeof(pos));
+         uint32_t size = 0;
+         log_stream.seekg(pos);
+         log_stream.read((char*)&size, sizeof(size));
+         pos += sizeof(size) + size;
+      }
+      EOS_ASSERT(pos == end_pos, block_log_exception, "Block log segment ${f} has trailing data", ("f", seg.log_file.generic_string()));
+   }
+
+   vector<char> block_log::read_segment_block(uint32_t block_num)const {
+      std::lock_guard<std::mutex> g( my->segment_mutex );
+      const auto* seg = my->find_segment(block_num);
+      if (!seg)
+         return vector<char>();
+
+      if (my->open_segment != seg->first_block_num) {
+         my->close_segment();
+         my->segment_block_stream.open(seg->log_file.generic_string().c_str(), LOG_READ);
+         my->segment_index_stream.open(seg->index_file.generic_string().c_str(), LOG_READ);
+         my->open_segment = seg->first_block_num;
+      }
+
+      uint64_t pos;
+      my->segment_index_stream.seekg(sizeof(uint64_t) * (block_num - seg->first_block_num));
+      my->segment_index_stream.read((char*)&pos, sizeof(pos));
+
+      if (!seg->compressed) {
+         // a segment which is not compressed yet has the layout of blocks.log, every block is followed by its position
+         uint64_t end_pos;
+         if (block_num == seg->last_block_num) {
+            my->segment_block_stream.seekg(-sizeof(uint64_t), std::ios::end);
+            end_pos = my->segment_block_stream.tellg();
+         } else {
+            my->segment_index_stream.read((char*)&end_pos, sizeof(end_pos));
+            end_pos -= sizeof(uint64_t);
+         }
+         EOS_ASSERT(end_pos > pos, block_log_exception, "Index of block log segment ${f} is corrupt at block ${n}",
+                    ("f", seg->log_file.generic_string())("n", block_num));
+         vector<char> packed(end_pos - pos);
+         my->segment_block_stream.seekg(pos);
+         my->segment_block_stream.read(packed.data(), packed.size());
+         return packed;
+      }
+
+      uint32_t size = 0;
+      my->segment_block_stream.seekg(pos);
+      my->segment_block_stream.read((char*)&size, sizeof(size));
+      vector<char> compressed(size);
+      my->segment_block_stream.read(compressed.data(), compressed.size());
+      return detail::zlib_decompress_bytes(compressed);
+   }
+
+   void block_log::seal_log() {
+      const uint32_t head_num = block_header::num_from_id(my->head_id);
+      detail::block_log_segment seg(my->data_dir, my->first_block_num, head_num, false);
+      ilog("Sealing blocks ${f} through ${l} into block log segment ${s}",
+           ("f", seg.first_block_num)("l", seg.last_block_num)("s", seg.log_file.generic_string()));
+
+      flush();
+      const auto gs = extract_genesis_state(my->data_dir);
+      const fc::path tmp_block_file = my->block_file.generic_string() + ".tmp";
+      {
+         std::fstream new_block_stream;
+         new_block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+         new_block_stream.open(tmp_block_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+         detail::write_log_header(new_block_stream, head_num + 1, gs);
+      }
+
+      my->unmap();
+      my->block_stream.close();
       my->index_stream.close();
-      fc::remove_all(my->index_file);
+      {
+         std::lock_guard<std::mutex> g( my->segment_mutex );
+         // blocks.log.tmp goes into place last, open() completes a seal interrupted before that
+         fc::rename(my->block_file, seg.log_file);
+         fc::rename(my->index_file, seg.index_file);
+         fc::rename(tmp_block_file, my->block_file);
+         my->segments.push_back(seg);
+      }
+
+      my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
       my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
+      my->block_write = true;
       my->index_write = true;
+      my->version = max_supported_version;
+      my->first_block_num = head_num + 1;
+
+      my->start_compressing();
+   }
 
-      uint64_t end_pos;
+   void block_log::split_log() {
+      const uint32_t head_num = block_header::num_from_id(my->head_id);
+      uint32_t first = my->first_block_num;
+      {
+         std::lock_guard<std::mutex> g( my->segment_mutex );
+         if (!my->segments.empty())
+            first = std::max(first, my->segments.back().last_block_num + 1);
+      }
+      ilog("Splitting blocks ${f} through ${l} of blocks.log into segments of ${s} blocks, this is done once and may take a while",
+           ("f", first)("l", head_num)("s", my->segment_size));
+
+      const auto gs = extract_genesis_state(my->data_dir);
+      flush();
+      my->unmap();
       my->check_block_read();
+      my->check_index_read();
+      const uint64_t log_end = fc::file_size(my->block_file);
+      auto block_pos = [&](uint32_t block_num) {
+         // one past the head block, so the head block ends where the others do, before the position following it
+         if (block_num > head_num)
+            return log_end;
+         uint64_t pos;
+         my->index_stream.seekg(sizeof(uint64_t) * (block_num - my->first_block_num));
+         my->index_stream.read((char*)&pos, sizeof(pos));
+         return pos;
+      };
 
-      my->block_stream.seekg(-sizeof( uint64_t), std::ios::end);
-      my->block_stream.read((char*)&end_pos, sizeof(end_pos));
-      signed_block tmp;
+      // copies blocks from through to of blocks.log into a file of the same layout, through temporary files
+      auto write_range = [&](uint32_t from, uint32_t to, const fc::path& log_file, const fc::path& index_file) {
+         const fc::path tmp_log_file = log_file.generic_string() + ".tmp";
+         const fc::path tmp_index_file = index_file.generic_string() + ".tmp";
+         {
+            std::fstream log_stream;
+            std::fstream index_stream;
+            log_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+            index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+            log_stream.open(tmp_log_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            index_stream.open(tmp_index_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            detail::write_log_header(log_stream, from, gs);
+
+            vector<char> packed;
+            uint64_t next_pos = block_pos(from);
+            for (uint32_t n = from; n <= to; ++n) {
+               const uint64_t pos = next_pos;
+               next_pos = block_pos(n + 1);
+               packed.resize(next_pos - sizeof(uint64_t) - pos);
+               my->block_stream.seekg(pos);
+               my->block_stream.read(packed.data(), packed.size());
+               const uint64_t new_pos = log_stream.tellp();
+               log_stream.write(packed.data(), packed.size());
+               log_stream.write((char*)&new_pos, sizeof(new_pos));
+               index_stream.write((char*)&new_pos, sizeof(new_pos));
+            }
+         }
+         // the log goes into place before its index, a missing index is rebuilt on open
+         fc::remove_all(index_file);
+         fc::rename(tmp_log_file, log_file);
+         fc::rename(tmp_index_file, index_file);
+      };
 
-      uint64_t pos = 0;
-      if (my->version == 1) {
-         pos = 4; // Skip version which should have already been checked.
-      } else {
-         pos = 8; // Skip version and first block offset which should have already been checked
+      for (; head_num + 1 - first >= my->segment_size; first += my->segment_size) {
+         detail::block_log_segment seg(my->data_dir, first, first + my->segment_size - 1, false);
+         write_range(seg.first_block_num, seg.last_block_num, seg.log_file, seg.index_file);
+         std::lock_guard<std::mutex> g( my->segment_mutex );
+         my->segments.push_back(seg);
       }
-      my->block_stream.seekg(pos);
 
-      genesis_state gs;
-      fc::raw::unpack(my->block_stream, gs);
+      // the blocks after the last full segment replace blocks.log, which is kept whole until then so a split which
+      // is interrupted resumes from the segments written so far
+      write_range(first, head_num, my->block_file.generic_string() + ".split", my->index_file.generic_string() + ".split");
+      my->block_stream.close();
+      my->index_stream.close();
+      fc::remove_all(my->index_file);
+      fc::rename(my->block_file.generic_string() + ".split", my->block_file);
+      fc::rename(my->index_file.generic_string() + ".split", my->index_file);
 
-      // skip the totem
-      if (my->version > 1) {
-         uint64_t totem;
-         my->block_stream.read((char*) &totem, sizeof(totem));
-      }
+      my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
+      my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
+      my->block_write = true;
+      my->index_write = true;
+      my->version = max_supported_version;
+      my->first_block_num = first;
+      ilog("blocks.log now starts at block ${f}", ("f", first));
 
-      while( pos < end_pos ) {
-         fc::raw::unpack(my->block_stream, tmp);
-         my->block_stream.read((char*)&pos, sizeof(pos));
-         my->index_stream.write((char*)&pos, sizeof(pos));
-      }
+      my->start_compressing();
+   }
+
+   void block_log::construct_index() {
+      ilog("Reconstructing Block Log Index...");
+      my->index_region.reset();
+      my->index_stream.close();
+      my->check_block_read();
+      detail::construct_log_index(my->block_file, my->index_file);
+      my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
+      my->index_write = true;
    } // construct_index
 
         // 修复块日志并备份原日志
@@ -372,6 +1097,14 @@ namespace eosio { namespace chain {
       EOS_ASSERT( fc::is_directory(data_dir) && fc::is_regular_file(data_dir / "blocks.log"), block_log_not_found,
                  "Block log not found in '${blocks_dir}'", ("blocks_dir", data_dir)          );
 
+      // blocks before blocks.log are in immutable segments, only blocks.log itself is repaired
+      if( truncate_at_block ) {
+         const uint32_t log_first_block_num = detail::read_first_block_num( data_dir / "blocks.log" );
+         EOS_ASSERT( truncate_at_block >= log_first_block_num, block_log_exception,
+                     "Cannot truncate at block ${b}, blocks before ${f} are in block log segments",
+                     ("b", truncate_at_block)("f", log_first_block_num) );
+      }
+
       auto now = fc::time_point::now();
 
       auto blocks_dir = fc::canonical( data_dir );
@@ -393,6 +1126,13 @@ namespace eosio { namespace chain {
       fc::create_directories(blocks_dir);
       auto block_log_path = blocks_dir / "blocks.log";
 
+      // segments are immutable once sealed and move back as they are, their indexes are rebuilt on open when damaged
+      for (boost::filesystem::directory_iterator itr(backup_dir.generic_string()), end; itr != end; ++itr) {
+         const auto name = itr->path().filename().generic_string();
+         if (detail::is_segment_file(name))
+            fc::rename(backup_dir / name, blocks_dir / name);
+      }
+
       ilog( "Reconstructing '${new_block_log}' from backed up block log", ("new_block_log", block_log_path) );
 
       std::fstream  old_block_stream;
@@ -459,12 +1199,14 @@ namespace eosio { namespace chain {
          }
 
          auto id = tmp.id();
-         if( block_header::num_from_id(previous) + 1 != block_header::num_from_id(id) ) {
-            elog( "Block ${num} (${id}) skips blocks. Previous block in block log is block ${prev_num} (${previous})",
-                  ("num", block_header::num_from_id(id))("id", id)
+         // the first block of a partial log or of the log after the last segment links back to a block outside of it
+         const uint32_t expected_num = previous == block_id_type() ? first_block_num : block_header::num_from_id(previous) + 1;
+         if( expected_num != block_header::num_from_id(id) ) {
+            elog( "Block ${num} (${id}) skips blocks. Expected block ${expected_num} after block ${prev_num} (${previous})",
+                  ("num", block_header::num_from_id(id))("id", id)("expected_num", expected_num)
                   ("prev_num", block_header::num_from_id(previous))("previous", previous) );
          }
-         if( previous != tmp.previous ) {
+         if( previous != block_id_type() && previous != tmp.previous ) {
             elog( "Block ${num} (${id}) does not link back to previous block. "
                   "Expected previous: ${expected}. Actual previous: ${actual}.",
                   ("num", block_header::num_from_id(id))("id", id)("expected", previous)("actual", tmp.previous) );
@@ -26,6 +26,9 @@
 #include <boost/asio/thread_pool.hpp>
 #include <boost/asio/post.hpp>
 
+#include <deque>
+#include <mutex>
+
 
 namespace eosio { namespace chain {
 
@@ -136,6 +139,7 @@ struct controller_impl {
    bool                           trusted_producer_light_validation = false;
    uint32_t                       snapshot_head_block = 0;
    optional<boost::asio::thread_pool>  thread_pool;
+   abi_serializer_cache           abi_cache;
 
    typedef pair<scope_name,action_name>                   handler_key;
    map< account_name, map<handler_key, apply_handler> >   apply_handlers;
@@ -190,14 +194,15 @@ struct controller_impl {
     reversible_blocks( cfg.blocks_dir/config::reversible_blocks_dir_name,
         cfg.read_only ? database::read_only : database::read_write,
         cfg.reversible_cache_size ),
-    blog( cfg.blocks_dir ),
+    blog( cfg.blocks_dir, cfg.blocks_log_mmap, cfg.blocks_log_segment_size ),
     fork_db( cfg.state_dir ),
-    wasmif( cfg.wasm_runtime ),
+    wasmif( cfg.wasm_runtime, cfg.wasm_code_cache_dir, cfg.wasm_code_cache_max_entries ),
     resource_limits( db ),
     authorization( s, db ),
     conf( cfg ),
     chain_id( cfg.genesis.compute_chain_id() ),
-    read_mode( cfg.read_mode )
+    read_mode( cfg.read_mode ),
+    abi_cache( cfg.abi_serializer_cache_size )
    {
 
 // 设置前置处理器的宏定义
@@ -281,6 +286,8 @@ struct controller_impl {
          blog.append(s->block);
       }
 
+      wasmif.save_code_cache_use_counts();
+
       const auto& ubi = reversible_blocks.get_index<reversible_block_index,by_num>();
       auto objitr = ubi.begin();
       while( objitr != ubi.end() && objitr->blocknum <= s->block_num ) {
@@ -295,7 +302,7 @@ struct controller_impl {
             // when applying a snapshot, head may not be present
             // when not applying a snapshot, make sure this is the next block
             if (!head || s->block_num == head->block_num + 1) {
-               apply_block(s->block, controller::block_status::complete);
+               apply_block(s, controller::block_status::complete);
                head = s;
             } else {
                // otherwise, assert the one odd case where initializing a chain
@@ -321,11 +328,15 @@ struct controller_impl {
             ("s", start_block_num)("n", blog_head->block_num()) );
 
       auto start = fc::time_point::now();
-      while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
-         replay_push_block( next, controller::block_status::irreversible );
-         if( next->block_num() % 100 == 0 ) {
-            std::cerr << std::setw(10) << next->block_num() << " of " << blog_head->block_num() <<"\r";
-            if( shutdown() ) break;
+      if( conf.replay_lookahead_blocks > 0 ) {
+         replay_irreversible_pipelined( blog_head->block_num(), shutdown );
+      } else {
+         while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
+            replay_push_block( next, controller::block_status::irreversible );
+            if( next->block_num() % 100 == 0 ) {
+               std::cerr << std::setw(10) << next->block_num() << " of " << blog_head->block_num() <<"\r";
+               if( shutdown() ) break;
+            }
          }
       }
       std::cerr<< "\n";
@@ -350,11 +361,74 @@ struct controller_impl {
       replaying = false;
       replay_head_time.reset();
    }
+   /**
+    *  Replays the irreversible blocks of the block log while up to conf.replay_lookahead_blocks blocks ahead of head
+    *  are read, unpacked and header validated on the thread pool. Each look-ahead task reads its block (block log
+    *  reads are serialized), starts signature recovery of the block's transactions, and then builds its block_state
+    *  on top of the block_state of the preceding task. Tasks are posted in block order so a task only ever waits on
+    *  a task that was started before it.
+    */
+   void replay_irreversible_pipelined( uint32_t blog_head_num, const std::function<bool()>& shutdown ) {
+      const bool skip_validate_signee = !conf.force_all_checks;
+      const bool recover_keys = conf.force_all_checks;
+
+      std::mutex blog_mtx;
+      std::deque<std::shared_future<block_state_ptr>> lookahead;
+      uint32_t next_block_num = head->block_num + 1;
+
+      std::promise<block_state_ptr> head_promise;
+      head_promise.set_value( head );
+      std::shared_future<block_state_ptr> prev_future = head_promise.get_future().share();
+
+      // outstanding tasks reference blog_mtx, make sure they are done before leaving this scope
+      auto drain_lookahead = fc::make_scoped_exit([&lookahead](){
+         for( const auto& f : lookahead )
+            f.wait();
+      });
+
+      auto schedule_next = [&]() {
+         uint32_t block_num = next_block_num++;
+         prev_future = async_thread_pool( [this, block_num, prev_future, &blog_mtx, skip_validate_signee, recover_keys]() {
+            signed_block_ptr b;
+            {
+               std::lock_guard<std::mutex> g( blog_mtx );
+               b = blog.read_block_by_num( block_num );
+            }
+            EOS_ASSERT( b, block_log_exception, "unable to read block ${n} from block log", ("n", block_num) );
+            auto trxs = start_recover_keys( b, recover_keys );
+            auto prev = prev_future.get();
+            auto bsp = std::make_shared<block_state>( *prev, move( b ), skip_validate_signee );
+            bsp->cached_trxs = move( trxs );
+            return bsp;
+         } ).share();
+         lookahead.push_back( prev_future );
+      };
+
+      while( next_block_num <= blog_head_num && lookahead.size() < conf.replay_lookahead_blocks )
+         schedule_next();
+
+      while( !lookahead.empty() ) {
+         block_state_ptr bsp = lookahead.front().get();
+         lookahead.pop_front();
+         if( next_block_num <= blog_head_num )
+            schedule_next();
+
+         replay_push_block( bsp, controller::block_status::irreversible );
+         if( bsp->block_num % 100 == 0 ) {
+            std::cerr << std::setw(10) << bsp->block_num << " of " << blog_head_num <<"\r";
+            if( shutdown() ) break;
+         }
+      }
+   }
+
    // [5 启动chain_plugin] 初始化controller
    void init(std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot) {
 
       thread_pool.emplace( conf.thread_pool_size );
 
+      // before a replay, which applies the same popular contracts
+      wasmif.warm_up_code_cache( conf.wasm_code_cache_warmup );
+
       bool report_integrity_hash = !!snapshot;
       if (snapshot) {
          EOS_ASSERT( !head, fork_database_exception, "" );
@@ -456,8 +530,20 @@ struct controller_impl {
    }
 
    void add_contract_tables_to_snapshot( const snapshot_writer_ptr& snapshot ) const {
-      snapshot->write_section("contract_tables", [this]( auto& section ) {
-         index_utils<table_id_multi_index>::walk(db, [this, &section]( const table_id_object& table_row ){
+      // the tables are split into parts that are serialized on the thread pool, cut by position rather than by id
+      // because removed tables leave gaps in the ids
+      const auto& table_idx = db.get_index<table_id_multi_index, by_id>();
+      vector<table_id_object::id_type> part_begins;
+      size_t table_count = 0;
+      for( const auto& t : table_idx ) {
+         if( table_count++ % config::snapshot_contract_tables_per_part == 0 )
+            part_begins.push_back( t.id );
+      }
+      const auto end_id = table_idx.empty() ? table_id_object::id_type(0) : table_id_object::id_type( table_idx.rbegin()->id._id + 1 );
+
+      auto fill_part = [this, &part_begins, end_id]( size_t part, snapshot_writer::section_writer& section ) {
+         auto part_end = part + 1 < part_begins.size() ? part_begins[part + 1] : end_id;
+         index_utils<table_id_multi_index>::walk_range<by_id>(db, part_begins[part], part_end, [this, &section]( const table_id_object& table_row ){
             // add a row for the table
             section.add_row(table_row, db);
 
@@ -478,6 +564,10 @@ struct controller_impl {
                });
             });
          });
+      };
+
+      snapshot->write_section_parts("contract_tables", part_begins.size(), fill_part, [this]( std::function<void()> f ) {
+         return async_thread_pool( std::move(f) );
       });
    }
 
@@ -1141,6 +1231,8 @@ struct controller_impl {
          pending.emplace(maybe_session());
       }
 
+      authorization.reset_authority_cache();
+
       pending->_block_status = s;
       pending->_producer_block_id = producer_block_id;
       pending->_pending_block_state = std::make_shared<block_state>( *head, when ); // promotes pending schedule (if any) to active
@@ -1208,29 +1300,43 @@ struct controller_impl {
       static_cast<signed_block_header&>(*p->block) = p->header;
    } /// sign_block
 
-   void apply_block( const signed_block_ptr& b, controller::block_status s ) { try {
+   /**
+    *  Creates the transaction metadata of every packed transaction in the block and, if recover_keys is set,
+    *  starts recovery of their signing keys on the thread pool. Safe to call from a thread pool thread.
+    */
+   std::vector<transaction_metadata_ptr> start_recover_keys( const signed_block_ptr& b, bool recover_keys ) {
+      std::vector<transaction_metadata_ptr> packed_transactions;
+      packed_transactions.reserve( b->transactions.size() );
+      for( const auto& receipt : b->transactions ) {
+         if( receipt.trx.contains<packed_transaction>()) {
+            auto& pt = receipt.trx.get<packed_transaction>();
+            auto mtrx = std::make_shared<transaction_metadata>( pt );
+            if( recover_keys ) {
+               std::weak_ptr<transaction_metadata> mtrx_wp = mtrx;
+               mtrx->signing_keys_future = async_thread_pool( [chain_id = this->chain_id, mtrx_wp]() {
+                  auto mtrx = mtrx_wp.lock();
+                  return mtrx ?
+                         std::make_pair( chain_id, mtrx->packed_trx.get_signature_keys( chain_id ) ) :
+                         std::make_pair( chain_id, flat_set<public_key_type>() );
+               } );
+            }
+            packed_transactions.emplace_back( std::move( mtrx ) );
+         }
+      }
+      return packed_transactions;
+   }
+
+   void apply_block( const block_state_ptr& bsp, controller::block_status s ) { try {
       try {
+         const signed_block_ptr& b = bsp->block;
          EOS_ASSERT( b->block_extensions.size() == 0, block_validate_exception, "no supported extensions" );
          auto producer_block_id = b->id();
          start_block( b->timestamp, b->confirmed, s , producer_block_id);
 
-         std::vector<transaction_metadata_ptr> packed_transactions;
-         packed_transactions.reserve( b->transactions.size() );
-         for( const auto& receipt : b->transactions ) {
-            if( receipt.trx.contains<packed_transaction>()) {
-               auto& pt = receipt.trx.get<packed_transaction>();
-               auto mtrx = std::make_shared<transaction_metadata>( pt );
-               if( !self.skip_auth_check() ) {
-                  std::weak_ptr<transaction_metadata> mtrx_wp = mtrx;
-                  mtrx->signing_keys_future = async_thread_pool( [chain_id = this->chain_id, mtrx_wp]() {
-                     auto mtrx = mtrx_wp.lock();
-                     return mtrx ?
-                            std::make_pair( chain_id, mtrx->trx.get_signature_keys( chain_id ) ) :
-                            std::make_pair( chain_id, decltype( mtrx->trx.get_signature_keys( chain_id ) ){} );
-                  } );
-               }
-               packed_transactions.emplace_back( std::move( mtrx ) );
-            }
+         std::vector<transaction_metadata_ptr> packed_transactions = move( bsp->cached_trxs );
+         bsp->cached_trxs.clear();
+         if( packed_transactions.empty() ) {
+            packed_transactions = start_recover_keys( b, !self.skip_auth_check() );
          }
 
          transaction_trace_ptr trace;
@@ -1305,9 +1411,17 @@ struct controller_impl {
       auto prev = fork_db.get_block( b->previous );
       EOS_ASSERT( prev, unlinkable_block_exception, "unlinkable block ${id}", ("id", id)("previous", b->previous) );
 
-      return async_thread_pool( [b, prev]() {
+      // light validation of a complete block skips authorization checks, the keys would not be used
+      const bool recover_keys = conf.block_validation_mode != validation_mode::LIGHT && !conf.trusted_producers.count( b->producer );
+
+      // signing keys of the block's transactions are recovered on the thread pool as soon as the block arrives,
+      // apply_block picks the transaction metadata up from cached_trxs
+      return async_thread_pool( [this, b, prev, recover_keys]() {
+         auto trxs = start_recover_keys( b, recover_keys );
          const bool skip_validate_signee = false;
-         return std::make_shared<block_state>( *prev, move( b ), skip_validate_signee );
+         auto bsp = std::make_shared<block_state>( *prev, move( b ), skip_validate_signee );
+         bsp->cached_trxs = move( trxs );
+         return bsp;
       } );
    }
 
@@ -1338,6 +1452,22 @@ struct controller_impl {
    }
 
    void replay_push_block( const signed_block_ptr& b, controller::block_status s ) {
+      replay_push_block( b, s, [&]() {
+         const bool skip_validate_signee = !conf.force_all_checks;
+         return fork_db.add( b, skip_validate_signee );
+      });
+   }
+
+   /// replays a block whose block_state was already constructed, e.g. by replay_irreversible_pipelined
+   void replay_push_block( const block_state_ptr& bsp, controller::block_status s ) {
+      EOS_ASSERT( bsp, block_validate_exception, "trying to push empty block state" );
+      replay_push_block( bsp->block, s, [&]() {
+         return fork_db.add( bsp, false );
+      });
+   }
+
+   template<typename AddToForkDb>
+   void replay_push_block( const signed_block_ptr& b, controller::block_status s, AddToForkDb&& add_to_fork_db ) {
       self.validate_db_available_size();
       self.validate_reversible_available_size();
 
@@ -1348,8 +1478,7 @@ struct controller_impl {
          EOS_ASSERT( (s == controller::block_status::irreversible || s == controller::block_status::validated),
                      block_validate_exception, "invalid block status for replay" );
          emit( self.pre_accepted_block, b );
-         const bool skip_validate_signee = !conf.force_all_checks;
-         auto new_header_state = fork_db.add( b, skip_validate_signee );
+         auto new_header_state = add_to_fork_db();
 
          emit( self.accepted_block_header, new_header_state );
 
@@ -1370,7 +1499,7 @@ struct controller_impl {
 
       if( new_head->header.previous == head->id ) { // 如果 fork_db 的上一个块id与主链当前块id一致
          try {
-            apply_block( new_head->block, s );
+            apply_block( new_head, s );
             fork_db.mark_in_current_chain( new_head, true );
             fork_db.set_validity( new_head, true );
             head = new_head;
@@ -1395,7 +1524,7 @@ struct controller_impl {
          for( auto ritr = branches.first.rbegin(); ritr != branches.first.rend(); ++ritr ) {
             optional<fc::exception> except;
             try {
-               apply_block( (*ritr)->block, (*ritr)->validated ? controller::block_status::validated : controller::block_status::complete );
+               apply_block( *ritr, (*ritr)->validated ? controller::block_status::validated : controller::block_status::complete );
                head = *ritr;
                fork_db.mark_in_current_chain( *ritr, true );
                (*ritr)->validated = true;
@@ -1420,7 +1549,7 @@ struct controller_impl {
 
                // re-apply good blocks
                for( auto ritr = branches.second.rbegin(); ritr != branches.second.rend(); ++ritr ) {
-                  apply_block( (*ritr)->block, controller::block_status::validated /* we previously validated these blocks*/ );
+                  apply_block( *ritr, controller::block_status::validated /* we previously validated these blocks*/ );
                   head = *ritr;
                   fork_db.mark_in_current_chain( *ritr, true );
                }
@@ -1517,6 +1646,7 @@ struct controller_impl {
          }
 
          if( static_cast<authority>(permission.auth) != auth ) { // TODO: use a more efficient way to check that authority has not changed
+            authorization.mark_permissions_modified( permission.owner );
             db.modify(permission, [&]( auto& po ) {
                po.auth = auth;
             });
@@ -1958,6 +2088,18 @@ signed_block_ptr controller::fetch_block_by_number( uint32_t block_num )const  {
    return my->blog.read_block_by_num(block_num);
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
+packed_block_span controller::fetch_packed_block_by_number( uint32_t block_num )const  { try {
+   return my->blog.read_packed_block_by_num(block_num);
+} FC_CAPTURE_AND_RETHROW( (block_num) ) }
+
+cached_abi_ptr controller::get_cached_abi( account_name n, const fc::microseconds& max_serialization_time )const {
+   return my->abi_cache.get( my->db, n, max_serialization_time );
+}
+
+void controller::invalidate_cached_abi( account_name n ) {
+   my->abi_cache.erase( n );
+}
+
 block_state_ptr controller::fetch_block_state_by_id( block_id_type id )const {
    auto state = my->fork_db.get_block(id);
    return state;
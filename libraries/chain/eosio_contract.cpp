@@ -196,6 +196,8 @@ void apply_eosio_setabi(apply_context& context) {
    db.modify( account_sequence, [&]( auto& aso ) {
       aso.abi_sequence += 1;
    });
+   // cached abis are only matched by abi_sequence, which another fork may have used for another abi
+   context.control.invalidate_cached_abi( act.account );
 
    if (new_size != old_size) {
       context.add_ram_usage( act.account, new_size - old_size );
@@ -321,6 +323,7 @@ void apply_eosio_linkauth(apply_context& context) {
 
       auto link_key = boost::make_tuple(requirement.account, requirement.code, requirement.type);
       auto link = db.find<permission_link_object, by_action_name>(link_key);
+      context.control.get_mutable_authorization_manager().mark_permissions_modified( requirement.account );
 
       if( link ) {
          EOS_ASSERT(link->required_permission != requirement.requirement, action_validate_exception,
@@ -356,6 +359,7 @@ void apply_eosio_unlinkauth(apply_context& context) {
    auto link_key = boost::make_tuple(unlink.account, unlink.code, unlink.type);
    auto link = db.find<permission_link_object, by_action_name>(link_key);
    EOS_ASSERT(link != nullptr, action_validate_exception, "Attempting to unlink authority, but no link found");
+   context.control.get_mutable_authorization_manager().mark_permissions_modified( unlink.account );
    context.add_ram_usage(
       link->account,
       -(int64_t)(config::billable_size_v<permission_link_object>)
@@ -8,6 +8,10 @@
 #include <eosio/chain/exceptions.hpp>
 #include <fc/variant_object.hpp>
 #include <fc/scoped_exit.hpp>
+#include <fc/io/json.hpp>
+
+#include <memory>
+#include <unordered_map>
 
 namespace eosio { namespace chain {
 
@@ -20,6 +24,7 @@ using namespace fc;
 namespace impl {
    struct abi_from_variant;
    struct abi_to_variant;
+   struct abi_to_json;
 
    struct abi_traverse_context;
    struct abi_traverse_context_with_path;
@@ -34,6 +39,10 @@ namespace impl {
 struct abi_serializer {
    abi_serializer(){ configure_built_in_types(); }
    abi_serializer( const abi_def& abi, const fc::microseconds& max_serialization_time );
+   abi_serializer( const abi_serializer& other );
+   abi_serializer( abi_serializer&& other ) = default;
+   abi_serializer& operator=( const abi_serializer& other );
+   abi_serializer& operator=( abi_serializer&& other ) = default;
    void set_abi(const abi_def& abi, const fc::microseconds& max_serialization_time);
 
    type_name resolve_type(const type_name& t)const;
@@ -56,6 +65,12 @@ struct abi_serializer {
    fc::variant binary_to_variant( const type_name& type, const bytes& binary, const fc::microseconds& max_serialization_time, bool short_path = false )const;
    fc::variant binary_to_variant( const type_name& type, fc::datastream<const char*>& binary, const fc::microseconds& max_serialization_time, bool short_path = false )const;
 
+   /**
+    * Append the json of the value of type found in binary to out. Produces the same text as
+    * fc::json::to_string( binary_to_variant( type, binary, ... ) ) without building the intermediate fc::variant tree.
+    */
+   void        binary_to_json( const type_name& type, const bytes& binary, string& out, const fc::microseconds& max_serialization_time, bool short_path = false )const;
+
    bytes       variant_to_binary( const type_name& type, const fc::variant& var, const fc::microseconds& max_serialization_time, bool short_path = false )const;
    void        variant_to_binary( const type_name& type, const fc::variant& var, fc::datastream<char*>& ds, const fc::microseconds& max_serialization_time, bool short_path = false )const;
 
@@ -65,6 +80,13 @@ struct abi_serializer {
    template<typename T, typename Resolver>
    static void from_variant( const fc::variant& v, T& o, Resolver resolver, const fc::microseconds& max_serialization_time );
 
+   /**
+    * Append the json of o to out. Produces the same text as fc::json::to_string of the variant to_variant builds, without
+    * building the variant tree of the abi-decoded parts.
+    */
+   template<typename T, typename Resolver>
+   static void to_json( const T& o, string& out, Resolver resolver, const fc::microseconds& max_serialization_time );
+
    template<typename Vec>
    static bool is_empty_abi(const Vec& abi_vec)
    {
@@ -101,6 +123,48 @@ private:
    map<type_name, pair<unpack_function, pack_function>> built_in_types;
    void configure_built_in_types();
 
+   struct type_plan;
+
+   struct field_plan {
+      const type_plan* type = nullptr;
+      bool             extension = false; ///< the field type has the binary extension suffix '$'
+      string           json_name;         ///< the field name quoted and escaped for binary_to_json
+   };
+
+   /**
+    *  A type of the abi with its typedefs, array/optional suffixes and built-in pack functions resolved once
+    *  by set_abi, so binary_to_variant follows pointers instead of looking up and parsing type names.
+    */
+   struct type_plan {
+      type_name                                   rtype; ///< the type after resolving typedefs
+      bool                                        is_array = false;
+      bool                                        is_optional = false;
+      const pair<unpack_function, pack_function>* built_in = nullptr; ///< set if the fundamental type is built in
+      const type_plan*                            element = nullptr;  ///< fundamental type of a non built-in array or optional
+      bool                                        is_variant = false;
+      map<type_name, variant_def>::const_iterator variant_itr;
+      vector<const type_plan*>                    variant_types;
+      bool                                        is_struct = false;
+      map<type_name, struct_def>::const_iterator  struct_itr;
+      const type_plan*                            base = nullptr;
+      vector<field_plan>                          fields;
+      bool                                        duplicate_fields = false; ///< the struct and its bases repeat a field name
+   };
+
+   std::unordered_map<type_name, std::unique_ptr<type_plan>> type_plans;
+   void build_type_plans();
+   const type_plan* find_type_plan( const type_name& type )const;
+   bool has_duplicate_fields( const struct_def& st )const;
+
+   fc::variant _binary_to_variant( const type_plan& plan, fc::datastream<const char*>& stream, impl::binary_to_variant_context& ctx )const;
+   void        _binary_to_variant( const type_plan& plan, fc::datastream<const char*>& stream,
+                                   fc::mutable_variant_object& obj, impl::binary_to_variant_context& ctx )const;
+
+   void        _binary_to_json( const type_plan& plan, fc::datastream<const char*>& stream, string& out, impl::binary_to_variant_context& ctx )const;
+   void        _binary_to_json_fields( const type_plan& plan, fc::datastream<const char*>& stream, string& out, bool& first_field,
+                                       impl::binary_to_variant_context& ctx )const;
+   void        _binary_to_json( const type_name& type, const bytes& binary, string& out, impl::binary_to_variant_context& ctx )const;
+
    fc::variant _binary_to_variant( const type_name& type, const bytes& binary, impl::binary_to_variant_context& ctx )const;
    fc::variant _binary_to_variant( const type_name& type, fc::datastream<const char*>& binary, impl::binary_to_variant_context& ctx )const;
    void        _binary_to_variant( const type_name& type, fc::datastream<const char*>& stream,
@@ -117,11 +181,29 @@ private:
 
    friend struct impl::abi_from_variant;
    friend struct impl::abi_to_variant;
+   friend struct impl::abi_to_json;
    friend struct impl::abi_traverse_context_with_path;
 };
 
 namespace impl {
 
+   /**
+    * Restores a value when it goes out of scope. Used instead of fc::scoped_exit<std::function<void()>> because it is
+    * created for every node visited by the serializer and must not allocate.
+    */
+   template<typename T>
+   class scoped_restore {
+   public:
+      scoped_restore( T& value, T old ) : value(&value), old(std::move(old)) {}
+      scoped_restore( scoped_restore&& other ) : value(other.value), old(std::move(other.old)) { other.value = nullptr; }
+      scoped_restore( const scoped_restore& ) = delete;
+      ~scoped_restore() { if( value ) *value = std::move(old); }
+
+   private:
+      T* value;
+      T  old;
+   };
+
    struct abi_traverse_context {
       abi_traverse_context( fc::microseconds max_serialization_time )
       : max_serialization_time( max_serialization_time ), deadline( fc::time_point::now() + max_serialization_time ), recursion_depth(0)
@@ -133,7 +215,7 @@ namespace impl {
 
       void check_deadline()const;
 
-      fc::scoped_exit<std::function<void()>> enter_scope();
+      scoped_restore<size_t> enter_scope();
 
    protected:
       fc::microseconds max_serialization_time;
@@ -175,6 +257,18 @@ namespace impl {
 
    using path_item = static_variant<empty_path_item, array_index_path_item, field_path_item, variant_path_item>;
 
+   /// pops the path item pushed by abi_traverse_context_with_path::push_to_path when it goes out of scope
+   class scoped_path_item {
+   public:
+      explicit scoped_path_item( vector<path_item>& path ) : path(&path) {}
+      scoped_path_item( scoped_path_item&& other ) : path(other.path) { other.path = nullptr; }
+      scoped_path_item( const scoped_path_item& ) = delete;
+      ~scoped_path_item() { if( path && !path->empty() ) path->pop_back(); }
+
+   private:
+      vector<path_item>* path;
+   };
+
    struct abi_traverse_context_with_path : public abi_traverse_context {
       abi_traverse_context_with_path( const abi_serializer& abis, fc::microseconds max_serialization_time, const type_name& type )
       : abi_traverse_context( max_serialization_time ), abis(abis)
@@ -196,7 +290,7 @@ namespace impl {
 
       void set_path_root( const type_name& type );
 
-      fc::scoped_exit<std::function<void()>> push_to_path( const path_item& item );
+      scoped_path_item push_to_path( const path_item& item );
 
       void set_array_index_of_path_back( uint32_t i );
       void hint_array_type_if_in_array();
@@ -222,7 +316,7 @@ namespace impl {
    struct variant_to_binary_context : public abi_traverse_context_with_path {
       using abi_traverse_context_with_path::abi_traverse_context_with_path;
 
-      fc::scoped_exit<std::function<void()>> disallow_extensions_unless( bool condition );
+      scoped_restore<bool> disallow_extensions_unless( bool condition );
 
       bool extensions_allowed()const { return allow_extensions; }
 
@@ -380,7 +474,7 @@ namespace impl {
 
          try {
             auto abi = resolver(act.account);
-            if (abi.valid()) {
+            if (abi) {
                auto type = abi->get_action_type(act.name);
                if (!type.empty()) {
                   try {
@@ -467,6 +561,161 @@ namespace impl {
          abi_traverse_context& _ctx;
    };
 
+   /**
+    * Writes the json text of the value abi_to_variant would build. Types without ABI information are small and are
+    * written through their own variant, the rest is written member by member.
+    */
+   struct abi_to_json {
+      template<typename M, typename Resolver, not_require_abi_t<M> = 1>
+      static void add( string& out, const M& v, Resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         out += fc::json::to_string( fc::variant(v) );
+      }
+
+      template<typename M, typename Resolver, require_abi_t<M> = 1>
+      static void add( string& out, const M& v, Resolver resolver, abi_traverse_context& ctx );
+
+      template<typename M, typename Resolver, require_abi_t<M> = 1>
+      static void add( string& out, const vector<M>& v, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         out += '[';
+         for( size_t i = 0; i < v.size(); ++i ) {
+            if( i > 0 )
+               out += ',';
+            add(out, v[i], resolver, ctx);
+         }
+         out += ']';
+      }
+
+      template<typename Resolver>
+      struct add_static_variant
+      {
+         string& out;
+         Resolver& resolver;
+         abi_traverse_context& ctx;
+
+         add_static_variant( string& o, Resolver& r, abi_traverse_context& ctx )
+               :out(o), resolver(r), ctx(ctx) {}
+
+         typedef void result_type;
+         template<typename T> void operator()( T& v )const
+         {
+            add(out, v, resolver, ctx);
+         }
+      };
+
+      template<typename Resolver, typename... Args>
+      static void add( string& out, const fc::static_variant<Args...>& v, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         add_static_variant<Resolver> adder(out, resolver, ctx);
+         v.visit(adder);
+      }
+
+      template<typename Resolver>
+      static void add( string& out, const action& act, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         bool first = true;
+         out += '{';
+         add_member(out, first, "account", act.account, resolver, ctx);
+         add_member(out, first, "name", act.name, resolver, ctx);
+         add_member(out, first, "authorization", act.authorization, resolver, ctx);
+
+         const auto data_pos = out.size();
+         try {
+            auto abi = resolver(act.account);
+            if (abi) {
+               auto type = abi->get_action_type(act.name);
+               if (!type.empty()) {
+                  binary_to_variant_context _ctx(*abi, ctx, type);
+                  _ctx.short_path = true;
+                  out += ",\"data\":";
+                  abi->_binary_to_json( type, act.data, out, _ctx );
+                  add_member(out, first, "hex_data", act.data, resolver, ctx);
+                  out += '}';
+                  return;
+               }
+            }
+         } catch(...) {
+            // any failure to serialize data, then leave as not serialized
+            out.resize(data_pos);
+         }
+         add_member(out, first, "data", act.data, resolver, ctx);
+         out += '}';
+      }
+
+      template<typename Resolver>
+      static void add( string& out, const packed_transaction& ptrx, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         const auto& trx = ptrx.get_unpacked_transaction();
+         bool first = true;
+         out += '{';
+         add_member(out, first, "id", trx.id(), resolver, ctx);
+         add_member(out, first, "signatures", ptrx.signatures, resolver, ctx);
+         add_member(out, first, "compression", ptrx.compression, resolver, ctx);
+         add_member(out, first, "packed_context_free_data", ptrx.packed_context_free_data, resolver, ctx);
+         add_member(out, first, "context_free_data", ptrx.get_context_free_data(), resolver, ctx);
+         add_member(out, first, "packed_trx", ptrx.packed_trx, resolver, ctx);
+         add_member(out, first, "transaction", trx, resolver, ctx);
+         out += '}';
+      }
+
+      /// writes "name":value, the names of reflected members need no escaping
+      template<typename M, typename Resolver>
+      static void add_member( string& out, bool& first, const char* name, const M& v, Resolver resolver, abi_traverse_context& ctx )
+      {
+         if( !first )
+            out += ',';
+         first = false;
+         out += '"';
+         out += name;
+         out += "\":";
+         add(out, v, resolver, ctx);
+      }
+
+      /// a null shared_ptr of a type with ABI information is left out, as abi_to_variant does
+      template<typename M, typename Resolver, require_abi_t<M> = 1>
+      static void add_member( string& out, bool& first, const char* name, const std::shared_ptr<M>& v, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         if( !v ) return;
+         add_member(out, first, name, *v, resolver, ctx);
+      }
+   };
+
+   /**
+    * Reflection visitor that writes the members of a type with ABI information to a json object
+    */
+   template<typename T, typename Resolver>
+   class abi_to_json_visitor
+   {
+      public:
+         abi_to_json_visitor( string& _out, bool& _first, const T& _val, Resolver _resolver, abi_traverse_context& _ctx )
+         :_out(_out)
+         ,_first(_first)
+         ,_val(_val)
+         ,_resolver(_resolver)
+         ,_ctx(_ctx)
+         {}
+
+         template<typename Member, class Class, Member (Class::*member) >
+         void operator()( const char* name )const
+         {
+            abi_to_json::add_member( _out, _first, name, (_val.*member), _resolver, _ctx );
+         }
+
+      private:
+         string& _out;
+         bool& _first;
+         const T& _val;
+         Resolver _resolver;
+         abi_traverse_context& _ctx;
+   };
+
    struct abi_from_variant {
       /**
        * template which overloads extract for types which are not relvant to ABI information
@@ -545,7 +794,7 @@ namespace impl {
                valid_empty_data = act.data.empty();
             } else if ( data.is_object() ) {
                auto abi = resolver(act.account);
-               if (abi.valid()) {
+               if (abi) {
                   auto type = abi->get_action_type(act.name);
                   if (!type.empty()) {
                      variant_to_binary_context _ctx(*abi, ctx, type);
@@ -655,6 +904,16 @@ namespace impl {
       mvo(name, std::move(member_mvo));
    }
 
+   template<typename M, typename Resolver, require_abi_t<M>>
+   void abi_to_json::add( string& out, const M& v, Resolver resolver, abi_traverse_context& ctx )
+   {
+      auto h = ctx.enter_scope();
+      bool first = true;
+      out += '{';
+      fc::reflector<M>::visit( impl::abi_to_json_visitor<M, Resolver>( out, first, v, resolver, ctx ) );
+      out += '}';
+   }
+
    template<typename M, typename Resolver, require_abi_t<M>>
    void abi_from_variant::extract( const variant& v, M& o, Resolver resolver, abi_traverse_context& ctx )
    {
@@ -672,6 +931,12 @@ void abi_serializer::to_variant( const T& o, variant& vo, Resolver resolver, con
    vo = std::move(mvo["_"]);
 } FC_RETHROW_EXCEPTIONS(error, "Failed to serialize type", ("object",o))
 
+template<typename T, typename Resolver>
+void abi_serializer::to_json( const T& o, string& out, Resolver resolver, const fc::microseconds& max_serialization_time ) try {
+   impl::abi_traverse_context ctx(max_serialization_time);
+   impl::abi_to_json::add(out, o, resolver, ctx);
+} FC_RETHROW_EXCEPTIONS(error, "Failed to serialize type", ("object",o))
+
 template<typename T, typename Resolver>
 void abi_serializer::from_variant( const variant& v, T& o, Resolver resolver, const fc::microseconds& max_serialization_time ) try {
    impl::abi_traverse_context ctx(max_serialization_time);
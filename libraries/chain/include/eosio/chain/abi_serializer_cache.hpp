@@ -0,0 +1,68 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/types.hpp>
+#include <eosio/chain/config.hpp>
+
+#include <mutex>
+
+namespace eosio { namespace chain {
+
+   namespace detail { struct abi_serializer_cache_index; }
+
+   /**
+    *  The unpacked abi of a contract account together with an abi_serializer built from it.
+    */
+   struct cached_abi {
+      abi_def        abi;
+      abi_serializer serializer;
+   };
+   using cached_abi_ptr = std::shared_ptr<const cached_abi>;
+
+   /**
+    *  Keeps fully built abi_serializers of contract accounts so that readers do not have to unpack and
+    *  validate the abi of an account on every request.
+    *
+    *  Entries are keyed by (account, abi_sequence). A lookup only compares the abi_sequence, so setabi must erase the
+    *  entry of its account: a fork may reuse the same abi_sequence for another abi, but it gets there by running setabi.
+    *  The least recently used entry is dropped once max_size accounts are cached.
+    *
+    *  Lookups read chainbase and must be made from the thread that owns the database; the returned
+    *  serializers are immutable and may be used from any thread.
+    */
+   class abi_serializer_cache {
+      public:
+         explicit abi_serializer_cache( uint32_t max_size = config::default_abi_serializer_cache_size );
+         ~abi_serializer_cache();
+
+         /**
+          * @return the cached abi of account n, or an empty pointer if the account does not exist or has no abi
+          * @throws if the abi of the account can not be built within max_serialization_time
+          */
+         cached_abi_ptr get( const chainbase::database& db, account_name n, const fc::microseconds& max_serialization_time );
+
+         /// shares ownership with the cached_abi, for use as an abi_serializer resolver result
+         static std::shared_ptr<const abi_serializer> serializer( const cached_abi_ptr& abi ) {
+            return abi ? std::shared_ptr<const abi_serializer>( abi, &abi->serializer ) : std::shared_ptr<const abi_serializer>();
+         }
+
+         /// drops the entry of account n, for setabi
+         void     erase( account_name n );
+
+         void     set_max_size( uint32_t max_size );
+         uint32_t size()const;
+         void     clear();
+
+      private:
+         void purge();
+
+         uint32_t                                                  max_size;
+         uint64_t                                                  access_counter = 0;
+         std::unique_ptr<detail::abi_serializer_cache_index>       index;
+         mutable std::mutex                                        mtx;
+   };
+
+} } /// eosio::chain
@@ -10,6 +10,7 @@
 #include <sstream>
 #include <algorithm>
 #include <set>
+#include <memory>
 
 namespace chainbase { class database; }
 
@@ -18,16 +19,143 @@ namespace eosio { namespace chain {
 class controller;
 class transaction_context;
 
+/**
+ * Open addressing hash table, with linear probing, from the objects handed out as iterators to those iterators.
+ * Clearing it keeps its slots for the next action.
+ */
+template<typename T>
+class object_iterator_map {
+   public:
+      object_iterator_map() { rehash( 32 ); }
+
+      /// Returns the iterator of obj, or -1 if it has none
+      int find( const T* obj )const {
+         for( size_t i = home( obj ); _slots[i].obj; i = (i + 1) & _mask ) {
+            if( _slots[i].obj == obj )
+               return _slots[i].iterator;
+         }
+         return -1;
+      }
+
+      /// Precondition: obj has no iterator
+      void insert( const T* obj, int iterator ) {
+         if( (_size + 1) * 2 > _slots.size() )
+            rehash( _slots.size() * 2 );
+         size_t i = home( obj );
+         while( _slots[i].obj )
+            i = (i + 1) & _mask;
+         _slots[i] = slot{ obj, iterator };
+         ++_size;
+      }
+
+      void erase( const T* obj ) {
+         size_t i = home( obj );
+         for( ; _slots[i].obj != obj; i = (i + 1) & _mask ) {
+            if( !_slots[i].obj )
+               return;
+         }
+         // shift back the entries that probed past the freed slot, so that no lookup stops early on it
+         for( size_t j = (i + 1) & _mask; _slots[j].obj; j = (j + 1) & _mask ) {
+            size_t k = home( _slots[j].obj );
+            if( i <= j ? (i < k && k <= j) : (i < k || k <= j) )
+               continue;
+            _slots[i] = _slots[j];
+            i = j;
+         }
+         _slots[i] = slot();
+         --_size;
+      }
+
+      /// Empties the map. objects holds every object in the map, possibly with others or nulls; when they are few
+      /// compared to the capacity only their slots are cleared, so a map grown by one large action stays cheap to clear
+      void clear( const vector<const T*>& objects ) {
+         if( !_size )
+            return;
+         if( objects.size() * 4 < _slots.size() ) {
+            for( const T* obj : objects ) {
+               if( obj )
+                  erase( obj );
+            }
+         }
+         if( _size ) {
+            std::fill( _slots.begin(), _slots.end(), slot() );
+            _size = 0;
+         }
+      }
+
+      size_t capacity()const { return _slots.size(); }
+
+   private:
+      struct slot {
+         const T* obj      = nullptr;
+         int      iterator = -1;
+      };
+
+      size_t home( const T* obj )const {
+         // fibonacci hashing, the low bits of object addresses are mostly alignment
+         return (reinterpret_cast<uintptr_t>(obj) * 11400714819323198485ull) >> _shift;
+      }
+
+      void rehash( size_t capacity ) {
+         vector<slot> old( capacity );
+         old.swap( _slots );
+         _mask = capacity - 1;
+         _shift = 64;
+         for( size_t c = capacity; c > 1; c >>= 1 )
+            --_shift;
+         _size = 0;
+         for( const auto& s : old ) {
+            if( s.obj )
+               insert( s.obj, s.iterator );
+         }
+      }
+
+      vector<slot>   _slots;
+      size_t         _size  = 0;
+      size_t         _mask  = 0;
+      uint32_t       _shift = 64;
+};
+
 class apply_context {
    private:
       template<typename T>
       class iterator_cache {
          public:
-            iterator_cache(){
-               _end_iterator_to_table.reserve(8);
-               _iterator_to_object.reserve(32);
+            /// The storage of an action's iterators, kept for the next action instead of being reallocated
+            struct storage {
+               flat_map<table_id_object::id_type, pair<const table_id_object*, int>> table_cache;
+               vector<const table_id_object*>                  end_iterator_to_table;
+               vector<const T*>                                iterator_to_object;
+               object_iterator_map<T>                          object_to_iterator;
+
+               storage() {
+                  end_iterator_to_table.reserve(8);
+                  iterator_to_object.reserve(32);
+               }
+
+               void clear() {
+                  table_cache.clear();
+                  end_iterator_to_table.clear();
+                  object_to_iterator.clear( iterator_to_object );
+                  iterator_to_object.clear();
+               }
+            };
+
+            iterator_cache()
+            :_storage( acquire_storage() )
+            ,_table_cache( _storage->table_cache )
+            ,_end_iterator_to_table( _storage->end_iterator_to_table )
+            ,_iterator_to_object( _storage->iterator_to_object )
+            ,_object_to_iterator( _storage->object_to_iterator )
+            {}
+
+            ~iterator_cache() {
+               release_storage( std::move(_storage) );
             }
 
+            iterator_cache( const iterator_cache& ) = delete;
+            iterator_cache& operator=( const iterator_cache& ) = delete;
+
             /// Returns end iterator of the table.
             int cache_table( const table_id_object& tobj ) {
                auto itr = _table_cache.find(tobj.id);
@@ -79,21 +207,47 @@ class apply_context {
             }
 
             int add( const T& obj ) {
-               auto itr = _object_to_iterator.find( &obj );
-               if( itr != _object_to_iterator.end() )
-                    return itr->second;
+               auto existing = _object_to_iterator.find( &obj );
+               if( existing >= 0 )
+                    return existing;
 
                _iterator_to_object.push_back( &obj );
-               _object_to_iterator[&obj] = _iterator_to_object.size() - 1;
+               _object_to_iterator.insert( &obj, _iterator_to_object.size() - 1 );
 
                return _iterator_to_object.size() - 1;
             }
 
          private:
-            map<table_id_object::id_type, pair<const table_id_object*, int>> _table_cache;
-            vector<const table_id_object*>                  _end_iterator_to_table;
-            vector<const T*>                                _iterator_to_object;
-            map<const T*,int>                               _object_to_iterator;
+            /// storage grown past this many iterators by one action is freed rather than kept
+            static constexpr size_t max_pooled_iterators = 64*1024;
+
+            /// one storage per apply_context alive, that is per level of inline action nesting
+            static vector<std::unique_ptr<storage>>& storage_pool() {
+               static thread_local vector<std::unique_ptr<storage>> pool;
+               return pool;
+            }
+
+            static std::unique_ptr<storage> acquire_storage() {
+               auto& pool = storage_pool();
+               if( pool.empty() )
+                  return std::make_unique<storage>();
+               auto s = std::move( pool.back() );
+               pool.pop_back();
+               return s;
+            }
+
+            static void release_storage( std::unique_ptr<storage> s ) {
+               if( s->iterator_to_object.capacity() > max_pooled_iterators || s->object_to_iterator.capacity() > 2*max_pooled_iterators )
+                  return;
+               s->clear();
+               storage_pool().push_back( std::move(s) );
+            }
+
+            std::unique_ptr<storage>                         _storage;
+            decltype(storage::table_cache)&                  _table_cache;
+            vector<const table_id_object*>&                  _end_iterator_to_table;
+            vector<const T*>&                                _iterator_to_object;
+            object_iterator_map<T>&                          _object_to_iterator;
 
             /// Precondition: std::numeric_limits<int>::min() < ei < -1
             /// Iterator of -1 is reserved for invalid iterators (i.e. when the appropriate table has not yet been created).
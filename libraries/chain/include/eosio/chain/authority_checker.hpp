@@ -47,6 +47,29 @@ namespace detail {
 
 } /// namespace detail
 
+   /**
+    * @brief An authority with its wait, key and account permissions already merged into the order in which
+    * authority_checker evaluates them
+    *
+    * Checking against a flat_authority skips building that order on every check, so it can be resolved once and kept.
+    */
+   struct flat_authority {
+      flat_authority() = default;
+
+      template<typename AuthorityType>
+      explicit flat_authority( const AuthorityType& authority )
+      :threshold( authority.threshold )
+      {
+         permissions.reserve( authority.waits.size() + authority.keys.size() + authority.accounts.size() );
+         permissions.insert( authority.waits.begin(), authority.waits.end() );
+         permissions.insert( authority.keys.begin(), authority.keys.end() );
+         permissions.insert( authority.accounts.begin(), authority.accounts.end() );
+      }
+
+      uint32_t                      threshold = 0;
+      detail::meta_permission_set   permissions;
+   };
+
    /**
     * @brief This class determines whether a set of signing keys are sufficient to satisfy an authority or not
     *
@@ -93,7 +116,7 @@ namespace detail {
             permission_satisfied
          };
 
-         typedef map<permission_level, permission_cache_status> permission_cache_type;
+         typedef flat_map<permission_level, permission_cache_status> permission_cache_type;
 
          bool satisfied( const permission_level& permission,
                          fc::microseconds override_provided_delay,
@@ -180,21 +203,19 @@ namespace detail {
 
          template<typename AuthorityType>
          bool satisfied( const AuthorityType& authority, permission_cache_type& cached_permissions, uint16_t depth ) {
+            // Sort key permissions and account permissions together into a single set of meta_permissions
+            return satisfied( flat_authority( authority ), cached_permissions, depth );
+         }
+
+         bool satisfied( const flat_authority& authority, permission_cache_type& cached_permissions, uint16_t depth ) {
             // Save the current used keys; if we do not satisfy this authority, the newly used keys aren't actually used
             auto KeyReverter = fc::make_scoped_exit([this, keys = _used_keys] () mutable {
                _used_keys = keys;
             });
 
-            // Sort key permissions and account permissions together into a single set of meta_permissions
-            detail::meta_permission_set permissions;
-
-            permissions.insert(authority.waits.begin(), authority.waits.end());
-            permissions.insert(authority.keys.begin(), authority.keys.end());
-            permissions.insert(authority.accounts.begin(), authority.accounts.end());
-
             // Check all permissions, from highest weight to lowest, seeing if provided authorization factors satisfies them or not
             weight_tally_visitor visitor(*this, cached_permissions, depth);
-            for( const auto& permission : permissions )
+            for( const auto& permission : authority.permissions )
                // If we've got enough weight, to satisfy the authority, return!
                if( permission.visit(visitor) >= authority.threshold ) {
                   KeyReverter.cancel();
@@ -238,14 +259,12 @@ namespace detail {
                if( !status ) {
                   if( recursion_depth < checker.recursion_depth_limit ) {
                      bool r = false;
-                     typename permission_cache_type::iterator itr = cached_permissions.end();
 
                      bool propagate_error = false;
                      try {
                         auto&& auth = checker.permission_to_authority( permission.permission );
                         propagate_error = true;
-                        auto res = cached_permissions.emplace( permission.permission, being_evaluated );
-                        itr = res.first;
+                        cached_permissions.emplace( permission.permission, being_evaluated );
                         r = checker.satisfied( std::forward<decltype(auth)>(auth), cached_permissions, recursion_depth + 1 );
                      } catch( const permission_query_exception& ) {
                         if( propagate_error )
@@ -254,6 +273,8 @@ namespace detail {
                            return total_weight; // if the permission doesn't exist, continue without it
                      }
 
+                     // looked up again, the nested checks may have inserted into the flat_map and moved the entry
+                     auto itr = cached_permissions.find( permission.permission );
                      if( r ) {
                         total_weight += permission.weight;
                         itr->second = permission_satisfied;
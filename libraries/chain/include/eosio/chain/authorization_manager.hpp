@@ -6,6 +6,7 @@
 
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/permission_object.hpp>
+#include <eosio/chain/authority_checker.hpp>
 #include <eosio/chain/snapshot.hpp>
 
 #include <utility>
@@ -53,6 +54,21 @@ namespace eosio { namespace chain {
 
          fc::time_point get_permission_last_used( const permission_object& permission )const;
 
+         /**
+          * @brief Drops the authorities and permission links resolved during the previous block
+          *
+          * Called when a block is started. Changes to permissions may have been undone since they were resolved.
+          */
+         void reset_authority_cache();
+
+         /**
+          * @brief Stops resolving the permissions and permission links of an account from the cache until the next block
+          *
+          * Called on any change to the permissions or permission links of the account. Within a block, such a change may
+          * be undone along with a failed transaction, so the account is not cached again before the next block.
+          */
+         void mark_permissions_modified( account_name account );
+
          const permission_object*  find_permission( const permission_level& level )const;
          const permission_object&  get_permission( const permission_level& level )const;
 
@@ -132,6 +148,14 @@ namespace eosio { namespace chain {
                                                              scope_name code_account,
                                                              action_name type
                                                            )const;
+
+         const flat_authority& get_flat_authority( const permission_level& level )const;
+
+         using linked_permission_key = std::tuple<account_name, scope_name, action_name>;
+
+         mutable map<permission_level, flat_authority>                         _authority_cache;
+         mutable map<linked_permission_key, optional<permission_name>>         _linked_permission_cache;
+         flat_set<account_name>                                                _modified_accounts;
    };
 
 } } /// namespace eosio::chain
@@ -9,7 +9,7 @@
 
 namespace eosio { namespace chain {
 
-   namespace detail { class block_log_impl; }
+   namespace detail { class block_log_impl; struct block_log_segment; }
 
    /* The block log is an external append only log of the blocks with a header. Blocks should only
     * be written to the log after they irreverisble as the log is append only. The log is a doubly
@@ -34,11 +34,43 @@ namespace eosio { namespace chain {
     *
     * The main file is the only file that needs to persist. The index file can be reconstructed during a
     * linear scan of the main file.
+    *
+    * When a segment size is configured, every time blocks.log holds that many blocks it is sealed: blocks.log and
+    * blocks.index are renamed to blocks-<first>-<last>.log and .index, and a new blocks.log starting at the following
+    * block takes their place. A background thread then compresses each sealed segment into blocks-<first>-<last>.zlog
+    * and removes the uncompressed files. An existing blocks.log which already holds more blocks than the segment size
+    * is split into segments of that size once, when it is first opened with it. Each block in a compressed segment is
+    * compressed on its own so it can be read at random:
+    *
+    * +---------+-----------------+--------------+--------------------+-----+--------------+-------------------------+
+    * | Version | First Block Num | Size Block 1 | Compressed Block 1 | ... | Size Block N | Compressed Block N      |
+    * +---------+-----------------+--------------+--------------------+-----+--------------+-------------------------+
+    *
+    * Each compressed segment has its own blocks-<first>-<last>.zindex file of block positions. The index of any
+    * segment is rebuilt from that segment alone if it is missing. Reads of blocks before the start of blocks.log are
+    * served from the segments transparently, whether or not they are compressed yet.
     */
 
+   /**
+    * A view of the packed bytes of a single block. It shares ownership of the storage it points into, so it stays
+    * valid after the block log remaps or resets its files.
+    */
+   struct packed_block_span {
+      std::shared_ptr<const void> storage;
+      const char*                 data = nullptr;
+      size_t                      size = 0;
+
+      explicit operator bool()const { return data != nullptr; }
+   };
+
    class block_log {
       public:
-         block_log(const fc::path& data_dir);
+         /**
+          * @param mmap_reads if true, blocks.log and blocks.index are memory mapped and blocks are read straight
+          *                   from the mapping instead of through seeks on the file streams
+          * @param segment_size number of blocks after which blocks.log is sealed into a segment, 0 keeps all blocks in blocks.log
+          */
+         block_log(const fc::path& data_dir, bool mmap_reads = false, uint32_t segment_size = 0);
          block_log(block_log&& other);
          ~block_log();
 
@@ -52,6 +84,12 @@ namespace eosio { namespace chain {
             return read_block_by_num(block_header::num_from_id(id));
          }
 
+         /**
+          * Return the packed bytes of the block without unpacking it, or an empty span if it does not exist.
+          * In mmap read mode the span points directly into the mapping of blocks.log.
+          */
+         packed_block_span read_packed_block_by_num(uint32_t block_num)const;
+
          /**
           * Return offset of block in file, or block_log::npos if it does not exist.
           */
@@ -60,10 +98,14 @@ namespace eosio { namespace chain {
          const signed_block_ptr& head()const;
          uint32_t                first_block_num() const;
 
+         /// blocks until every sealed segment is compressed or compression has stopped on an error
+         void                    wait_for_compression();
+
          static const uint64_t npos = std::numeric_limits<uint64_t>::max();
 
          static const uint32_t min_supported_version;
          static const uint32_t max_supported_version;
+         static const uint32_t segment_version;
 
          static fc::path repair_log( const fc::path& data_dir, uint32_t truncate_at_block = 0 );
 
@@ -73,6 +115,13 @@ namespace eosio { namespace chain {
          void open(const fc::path& data_dir);
          void construct_index();
 
+         signed_block_ptr read_log_head()const;
+         void load_segments();
+         void construct_segment_index(const detail::block_log_segment& seg);
+         vector<char> read_segment_block(uint32_t block_num)const;
+         void seal_log();
+         void split_log();
+
          std::unique_ptr<detail::block_log_impl> my;
    };
 
@@ -25,6 +25,10 @@ namespace eosio { namespace chain {
       /// this data is redundant with the data stored in block, but facilitates
       /// recapturing transactions when we pop a block
       vector<transaction_metadata_ptr>                    trxs;
+
+      /// metadata for the packed transactions of block, created ahead of apply_block so that unpacking and
+      /// signature recovery can be done on the controller thread pool; consumed (and cleared) by apply_block
+      vector<transaction_metadata_ptr>                    cached_trxs;
    };
 
    using block_state_ptr = std::shared_ptr<block_state>;
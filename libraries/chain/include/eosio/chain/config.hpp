@@ -80,6 +80,11 @@ const static uint32_t   default_max_inline_action_size         = 4 * 1024;   //
 const static uint16_t   default_max_inline_action_depth        = 4;
 const static uint16_t   default_max_auth_depth                 = 6;
 const static uint16_t   default_controller_thread_pool_size    = 2;
+const static uint16_t   default_replay_lookahead_blocks        = 16;
+const static uint32_t   default_sig_recovery_cache_size        = 10000;
+
+/// contract tables are written to snapshots in parts of this many tables
+const static uint32_t   snapshot_contract_tables_per_part      = 256;
 
 const static uint32_t   min_net_usage_delta_between_base_and_max_for_trx  = 10*1024;
 // Should be large enough to allow recovery from badly set blockchain parameters without a hard fork
@@ -96,6 +101,9 @@ const static uint32_t   hashing_checktime_block_size       = 10*1024;  /// call
 
 const static eosio::chain::wasm_interface::vm_type default_wasm_runtime = eosio::chain::wasm_interface::vm_type::wabt;
 const static uint32_t   default_abi_serializer_max_time_ms = 15*1000; ///< default deadline for abi serialization methods
+const static uint32_t   default_abi_serializer_cache_size = 1024; ///< default number of contract abis kept built by the abi_serializer_cache
+const static uint32_t   default_wasm_code_cache_max_entries = 1024; ///< default number of contracts kept in the wasm code cache directory
+const static uint32_t   wasm_code_cache_save_interval_ms = 60*1000; ///< use counts of the wasm code cache are saved at most this often
 
 /**
  *  The number of sequential blocks produced by a single producer
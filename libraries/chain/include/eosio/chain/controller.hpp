@@ -1,10 +1,12 @@
 #pragma once
 #include <eosio/chain/block_state.hpp>
+#include <eosio/chain/block_log.hpp>
 #include <eosio/chain/trace.hpp>
 #include <eosio/chain/genesis_state.hpp>
 #include <boost/signals2/signal.hpp>
 
 #include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/abi_serializer_cache.hpp>
 #include <eosio/chain/account_object.hpp>
 #include <eosio/chain/snapshot.hpp>
 
@@ -64,7 +66,11 @@ namespace eosio { namespace chain {
             uint64_t                 reversible_cache_size  =  chain::config::default_reversible_cache_size;
             uint64_t                 reversible_guard_size  =  chain::config::default_reversible_guard_size;
             uint16_t                 thread_pool_size       =  chain::config::default_controller_thread_pool_size;
+            uint16_t                 replay_lookahead_blocks = chain::config::default_replay_lookahead_blocks;
             bool                     read_only              =  false;
+            bool                     blocks_log_mmap        =  false;
+            uint32_t                 blocks_log_segment_size =  0;
+            uint32_t                 abi_serializer_cache_size = chain::config::default_abi_serializer_cache_size;
             bool                     force_all_checks       =  false;
             bool                     disable_replay_opts    =  false;
             bool                     contracts_console      =  false;
@@ -72,6 +78,9 @@ namespace eosio { namespace chain {
 
             genesis_state            genesis;
             wasm_interface::vm_type  wasm_runtime = chain::config::default_wasm_runtime;
+            path                     wasm_code_cache_dir;  ///< empty to prepare contract code again after every restart
+            uint32_t                 wasm_code_cache_warmup = 0;
+            uint32_t                 wasm_code_cache_max_entries = chain::config::default_wasm_code_cache_max_entries;
 
             db_read_mode             read_mode              = db_read_mode::SPECULATIVE;
             validation_mode          block_validation_mode  = validation_mode::FULL;
@@ -194,6 +203,11 @@ namespace eosio { namespace chain {
          block_id_type last_irreversible_block_id() const;
 
          signed_block_ptr fetch_block_by_number( uint32_t block_num )const;
+         /**
+          * Returns the packed bytes of an irreversible block directly from the block log, or an empty span if the
+          * block is not (yet) in the block log.
+          */
+         packed_block_span fetch_packed_block_by_number( uint32_t block_num )const;
          signed_block_ptr fetch_block_by_id( block_id_type id )const;
 
          block_state_ptr fetch_block_state_by_number( uint32_t block_num )const;
@@ -277,11 +291,26 @@ namespace eosio { namespace chain {
             return optional<abi_serializer>();
          }
 
+         /**
+          * @return the abi of account n together with a serializer built from it, shared with later callers until the
+          *         account's abi changes, or an empty pointer if the account does not exist or has no abi
+          */
+         cached_abi_ptr get_cached_abi( account_name n, const fc::microseconds& max_serialization_time )const;
+         /// drops the cached abi of account n, called by setabi
+         void           invalidate_cached_abi( account_name n );
+
          template<typename T>
          fc::variant to_variant_with_abi( const T& obj, const fc::microseconds& max_serialization_time ) {
             fc::variant pretty_output;
             abi_serializer::to_variant( obj, pretty_output,
-                                        [&]( account_name n ){ return get_abi_serializer( n, max_serialization_time ); },
+                                        [&]( account_name n ) -> std::shared_ptr<const abi_serializer> {
+                                           if( n.good() ) {
+                                              try {
+                                                 return abi_serializer_cache::serializer( get_cached_abi( n, max_serialization_time ) );
+                                              } FC_CAPTURE_AND_LOG((n))
+                                           }
+                                           return std::shared_ptr<const abi_serializer>();
+                                        },
                                         max_serialization_time);
             return pretty_output;
          }
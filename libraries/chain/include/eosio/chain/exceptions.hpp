@@ -460,6 +460,10 @@ namespace eosio { namespace chain {
                                     3170007, "The configured snapshot directory does not exist" )
       FC_DECLARE_DERIVED_EXCEPTION( snapshot_exists_exception,  producer_exception,
                                     3170008, "The requested snapshot already exists" )
+      FC_DECLARE_DERIVED_EXCEPTION( incoming_transaction_dropped,  producer_exception,
+                                    3170009, "Incoming transaction dropped from the full transaction queue" )
+      FC_DECLARE_DERIVED_EXCEPTION( account_failure_throttled,  producer_exception,
+                                    3170010, "Transaction rejected while its account spends too much time in failed transactions" )
 
    FC_DECLARE_DERIVED_EXCEPTION( reversible_blocks_exception,           chain_exception,
                                  3180000, "Reversible Blocks exception" )
@@ -8,6 +8,8 @@
 #include <eosio/chain/exceptions.hpp>
 #include <fc/variant_object.hpp>
 #include <boost/core/demangle.hpp>
+#include <functional>
+#include <future>
 #include <ostream>
 
 namespace eosio { namespace chain {
@@ -148,12 +150,33 @@ namespace eosio { namespace chain {
             write_section(detail::snapshot_section_traits<T>::section_name(), f);
          }
 
+         using section_part_filler = std::function<void(size_t part, section_writer& section)>;
+         using task_runner         = std::function<std::future<void>(std::function<void()>)>;
+
+         /**
+          * Write a section whose rows are added by part_count calls to fill, one for each part.  The parts may be
+          * filled concurrently on tasks started through run, so fill must only read shared state.  The rows of the
+          * parts are written in part order.
+          */
+         void write_section_parts(const std::string& section_name, size_t part_count, const section_part_filler& fill, const task_runner& run) {
+            write_start_section(section_name);
+            write_parts(part_count, fill, run);
+            write_end_section();
+         }
+
       virtual ~snapshot_writer(){};
 
       protected:
          virtual void write_start_section( const std::string& section_name ) = 0;
          virtual void write_row( const detail::abstract_snapshot_row_writer& row_writer ) = 0;
          virtual void write_end_section() = 0;
+
+         /// fills the parts one after another on the calling thread
+         virtual void write_parts( size_t part_count, const section_part_filler& fill, const task_runner& run );
+
+         static section_writer make_section_writer( snapshot_writer& writer ) {
+            return section_writer(writer);
+         }
    };
 
    using snapshot_writer_ptr = std::shared_ptr<snapshot_writer>;
@@ -338,6 +361,10 @@ namespace eosio { namespace chain {
 
          static const uint32_t magic_number = 0x30510550;
 
+      protected:
+         /// fills the parts concurrently into memory and copies them to the stream in order
+         void write_parts( size_t part_count, const section_part_filler& fill, const task_runner& run ) override;
+
       private:
          detail::ostream_wrapper snapshot;
          std::streampos          header_pos;
@@ -375,6 +402,10 @@ namespace eosio { namespace chain {
          void write_end_section( ) override;
          void finalize();
 
+      protected:
+         /// serializes the parts concurrently and hashes their rows in order, as if they were written one by one
+         void write_parts( size_t part_count, const section_part_filler& fill, const task_runner& run ) override;
+
       private:
          fc::sha256::encoder&  enc;
 
@@ -120,6 +120,11 @@ namespace eosio { namespace chain {
          set_transaction(t, std::move(t.context_free_data), _compression);
       }
 
+      packed_transaction( const packed_transaction& other );
+      packed_transaction( packed_transaction&& ) = default;
+      packed_transaction& operator=( const packed_transaction& other );
+      packed_transaction& operator=( packed_transaction&& ) = default;
+
       uint32_t get_unprunable_size()const;
       uint32_t get_prunable_size()const;
 
@@ -130,19 +135,33 @@ namespace eosio { namespace chain {
       bytes                                   packed_context_free_data;
       bytes                                   packed_trx;
 
-      time_point_sec     expiration()const;
-      transaction_id_type id()const;
+      time_point_sec     expiration()const; // thread safe
+      transaction_id_type id()const; // thread safe, computed once
       transaction_id_type get_uncached_id()const; // thread safe
       bytes              get_raw_transaction()const; // thread safe
       vector<bytes>      get_context_free_data()const;
       transaction        get_transaction()const;
+      const transaction& get_unpacked_transaction()const; // thread safe, unpacked once
       signed_transaction get_signed_transaction()const;
+      digest_type        sig_digest( const chain_id_type& chain_id )const; // thread safe, computed once per chain id
+      flat_set<public_key_type> get_signature_keys( const chain_id_type& chain_id, bool allow_duplicate_keys = false, bool use_cache = true )const;
       void               set_transaction(const transaction& t, compression_type _compression = none);
       void               set_transaction(const transaction& t, const vector<bytes>& cfd, compression_type _compression = none);
 
    private:
-      mutable optional<transaction>           unpacked_trx; // <-- intermediate buffer used to retrieve values
-      void local_unpack()const;
+      struct unpacked_transaction {
+         transaction         trx;
+         transaction_id_type id;
+      };
+      struct signing_digest {
+         chain_id_type       chain_id;
+         digest_type         digest;
+      };
+
+      /// values derived from the packed fields, published once with atomic_compare_exchange and then never modified
+      mutable std::shared_ptr<const unpacked_transaction> unpacked_trx;
+      mutable std::shared_ptr<const signing_digest>       sig_digest_cache;
+      const unpacked_transaction& local_unpack()const;
    };
 
    using packed_transaction_ptr = std::shared_ptr<packed_transaction>;
@@ -186,6 +205,19 @@ namespace eosio { namespace chain {
 
    uint128_t transaction_id_to_sender_id( const transaction_id_type& tid );
 
+   /**
+    *  Keys recovered from signatures are kept in a process wide cache, shared by every thread recovering
+    *  the signing keys of transactions
+    */
+   struct recovery_cache_stats {
+      uint64_t hits = 0;
+      uint64_t misses = 0;
+      size_t   size = 0;
+   };
+
+   void                 set_recovery_cache_capacity( size_t capacity );
+   recovery_cache_stats get_recovery_cache_stats();
+
 } } /// namespace eosio::chain
 
 FC_REFLECT( eosio::chain::transaction_header, (expiration)(ref_block_num)(ref_block_prefix)
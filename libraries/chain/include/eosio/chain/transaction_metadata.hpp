@@ -34,7 +34,7 @@ class transaction_metadata {
 
       explicit transaction_metadata( const packed_transaction& ptrx )
       :trx( ptrx.get_signed_transaction() ), packed_trx(ptrx) {
-         id = trx.id();
+         id = packed_trx.id();
          //raw_packed = fc::raw::pack( static_cast<const transaction&>(trx) );
          signed_id = digest_type::hash(packed_trx);
       }
@@ -48,7 +48,7 @@ class transaction_metadata {
                   return signing_keys->second;
                }
             }
-            signing_keys = std::make_pair( chain_id, trx.get_signature_keys( chain_id ));
+            signing_keys = std::make_pair( chain_id, packed_trx.get_signature_keys( chain_id ));
          }
          return signing_keys->second;
       }
@@ -0,0 +1,72 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+#include <eosio/chain/types.hpp>
+
+#include <fc/time.hpp>
+
+#include <boost/filesystem/path.hpp>
+
+namespace eosio { namespace chain {
+
+   /**
+    *  Keeps contract code as it is after the eosio injections in a directory, one file per code_id, so that a
+    *  restarted node does not have to parse and inject the code again before it can instantiate it.
+    *
+    *  It also counts how often each code is applied, so the most used ones can be instantiated at startup. The directory
+    *  holds at most max_entries codes, storing another one evicts the least used; counts are only kept for the codes
+    *  in the directory.
+    */
+   class wasm_code_cache {
+      public:
+         /// bump when the file layout changes, files of other versions are removed
+         static const uint32_t format_version = 2;
+         /// the nodeos version and a hash of the injection sources, files written by another build are removed
+         static const string   build_version;
+
+         struct entry {
+            vector<uint8_t> code;           ///< the code after the injections
+            vector<uint8_t> initial_memory;
+         };
+
+         wasm_code_cache( const boost::filesystem::path& dir, uint32_t max_entries );
+         ~wasm_code_cache();
+
+         /// @return the entry of code_id, or nothing if it is missing or its file is corrupt
+         optional<entry> load( const digest_type& code_id )const;
+         void            store( const digest_type& code_id, const entry& e );
+
+         /// consecutive uses of the same code are counted together and only added to the counts when the code changes
+         void record_use( const digest_type& code_id ) {
+            if( code_id != pending_code_id ) {
+               add_pending_uses();
+               pending_code_id = code_id;
+            }
+            ++pending_uses;
+         }
+
+         /// @return up to count code_ids of the cached code that has been applied the most, most used first
+         vector<digest_type> most_used( size_t count );
+
+         /// saves the counts if the last save is older than config::wasm_code_cache_save_interval_ms
+         void save_use_counts_periodically();
+         void save_use_counts();
+
+      private:
+         boost::filesystem::path entry_path( const digest_type& code_id )const;
+         void add_pending_uses();
+         void evict( const digest_type& keep );
+
+         boost::filesystem::path      dir;
+         uint32_t                     max_entries = 0;
+         map<digest_type, uint64_t>   use_counts;        ///< one for each code in dir
+         digest_type                  pending_code_id;
+         uint64_t                     pending_uses = 0;
+         fc::time_point               last_save;
+   };
+
+} } /// eosio::chain
+
+FC_REFLECT( eosio::chain::wasm_code_cache::entry, (code)(initial_memory) )
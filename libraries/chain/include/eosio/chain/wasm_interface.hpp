@@ -56,9 +56,20 @@ namespace eosio { namespace chain {
             wabt
          };
 
-         wasm_interface(vm_type vm);
+         /**
+          * @param code_cache_dir if not empty, contract code is kept there after the eosio injections, so it
+          *                       does not have to be prepared again after a restart
+          * @param code_cache_max_entries the number of contracts kept in code_cache_dir, the least used are removed
+          */
+         wasm_interface(vm_type vm, const path& code_cache_dir, uint32_t code_cache_max_entries);
          ~wasm_interface();
 
+         //instantiates the count most applied contracts found in the code cache ahead of their first use
+         void warm_up_code_cache(uint32_t count);
+
+         //saves the use counts of the code cache if they have not been saved for a while
+         void save_code_cache_use_counts();
+
          //validates code -- does a WASM validation pass and checks the wasm against EOSIO specific constraints
          static void validate(const controller& control, const bytes& code);
 
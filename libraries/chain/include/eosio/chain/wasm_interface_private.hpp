@@ -5,6 +5,7 @@
 #include <eosio/chain/webassembly/wabt.hpp>
 #include <eosio/chain/webassembly/runtime_interface.hpp>
 #include <eosio/chain/wasm_eosio_injection.hpp>
+#include <eosio/chain/wasm_code_cache.hpp>
 #include <eosio/chain/transaction_context.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <fc/scoped_exit.hpp>
@@ -23,13 +24,16 @@ using namespace Runtime;
 namespace eosio { namespace chain {
 
    struct wasm_interface_impl {
-      wasm_interface_impl(wasm_interface::vm_type vm) {
+      wasm_interface_impl(wasm_interface::vm_type vm, const path& code_cache_dir, uint32_t code_cache_max_entries) {
          if(vm == wasm_interface::vm_type::wavm)
             runtime_interface = std::make_unique<webassembly::wavm::wavm_runtime>();
          else if(vm == wasm_interface::vm_type::wabt)
             runtime_interface = std::make_unique<webassembly::wabt_runtime::wabt_runtime>();
          else
             EOS_THROW(wasm_exception, "wasm_interface_impl fall through");
+
+         if(!code_cache_dir.empty())
+            code_cache = std::make_unique<wasm_code_cache>(code_cache_dir, code_cache_max_entries);
       }
 
       std::vector<uint8_t> parse_initial_memory(const Module& module) {
@@ -50,48 +54,92 @@ namespace eosio { namespace chain {
          return mem_image;
       }
 
+      // parses the code and applies the eosio injections
+      wasm_code_cache::entry prepare_code( const shared_string& code ) {
+         IR::Module module;
+         try {
+            Serialization::MemoryInputStream stream((const U8*)code.data(), code.size());
+            WASM::serialize(stream, module);
+            module.userSections.clear();
+         } catch(const Serialization::FatalSerializationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+
+         wasm_injections::wasm_binary_injection injector(module);
+         injector.inject();
+
+         wasm_code_cache::entry prepared;
+         try {
+            Serialization::ArrayOutputStream outstream;
+            WASM::serialize(outstream, module);
+            prepared.code = outstream.getBytes();
+         } catch(const Serialization::FatalSerializationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+         prepared.initial_memory = parse_initial_memory(module);
+         return prepared;
+      }
+
+      std::unique_ptr<wasm_instantiated_module_interface>& instantiate( const digest_type& code_id, wasm_code_cache::entry&& prepared ) {
+         auto instance = runtime_interface->instantiate_module((const char*)prepared.code.data(), prepared.code.size(), std::move(prepared.initial_memory));
+         return instantiation_cache.emplace(code_id, std::move(instance)).first->second;
+      }
+
       std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module( const digest_type& code_id,
                                                                                     const shared_string& code,
                                                                                     transaction_context& trx_context )
       {
+         if(code_cache)
+            code_cache->record_use(code_id);
+
          auto it = instantiation_cache.find(code_id); // 寻找智能合约的code缓存
-         if(it == instantiation_cache.end()) { // 如果不存在缓存
-            auto timer_pause = fc::make_scoped_exit([&](){
-               trx_context.resume_billing_timer();
-            });
-            trx_context.pause_billing_timer();
-            IR::Module module;
-            try {
-               Serialization::MemoryInputStream stream((const U8*)code.data(), code.size());
-               WASM::serialize(stream, module);
-               module.userSections.clear();
-            } catch(const Serialization::FatalSerializationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         if(it != instantiation_cache.end())
+            return it->second;
+
+         // 如果不存在缓存
+         auto timer_pause = fc::make_scoped_exit([&](){
+            trx_context.resume_billing_timer();
+         });
+         trx_context.pause_billing_timer();
+
+         optional<wasm_code_cache::entry> prepared;
+         if(code_cache)
+            prepared = code_cache->load(code_id);
+         if(!prepared) {
+            prepared = prepare_code(code);
+            if(code_cache) {
+               try {
+                  code_cache->store(code_id, *prepared);
+               } FC_LOG_AND_DROP()
             }
+         }
+         // wasm初始化运行时模块，并添加缓存
+         return instantiate(code_id, std::move(*prepared));
+      }
 
-            wasm_injections::wasm_binary_injection injector(module);
-            injector.inject();
-
-            std::vector<U8> bytes;
+      void warm_up_code_cache( uint32_t count ) {
+         if(!code_cache)
+            return;
+         for(const auto& code_id : code_cache->most_used(count)) {
+            if(instantiation_cache.count(code_id))
+               continue;
+            auto prepared = code_cache->load(code_id);
+            if(!prepared)
+               continue;
             try {
-               Serialization::ArrayOutputStream outstream;
-               WASM::serialize(outstream, module);
-               bytes = outstream.getBytes();
-            } catch(const Serialization::FatalSerializationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               EOS_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            }
-            // wasm初始化运行时模块，并添加缓存
-            it = instantiation_cache.emplace(code_id, runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module))).first;
+               instantiate(code_id, std::move(*prepared));
+            } FC_LOG_AND_DROP()
          }
-         return it->second;
+         ilog("instantiated ${n} contracts from the wasm code cache", ("n", instantiation_cache.size()));
       }
 
       std::unique_ptr<wasm_runtime_interface> runtime_interface;
       map<digest_type, std::unique_ptr<wasm_instantiated_module_interface>> instantiation_cache;
+      std::unique_ptr<wasm_code_cache> code_cache;
    };
 
 #define _REGISTER_INTRINSIC_EXPLICIT(CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
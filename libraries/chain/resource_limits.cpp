@@ -116,6 +116,9 @@ void resource_limits_manager::update_account_usage(const flat_set<account_name>&
    const auto& config = _db.get<resource_limits_config_object>();
    for( const auto& a : accounts ) {
       const auto& usage = _db.get<resource_usage_object,by_owner>( a );
+      // adding nothing in the period already last updated leaves the averages as they are, skip the modify and its undo copy
+      if( usage.net_usage.last_ordinal == time_slot && usage.cpu_usage.last_ordinal == time_slot )
+         continue;
       _db.modify( usage, [&]( auto& bu ){
           bu.net_usage.add( 0, time_slot, config.account_net_usage_average_window );
           bu.cpu_usage.add( 0, time_slot, config.account_cpu_usage_average_window );
@@ -313,6 +316,12 @@ void resource_limits_manager::process_account_limit_updates() {
       value = pending_value;
    };
 
+   // nothing to apply, do not modify the state object every block
+   const auto& first_pending = by_owner_index.lower_bound(boost::make_tuple(true));
+   if (first_pending == by_owner_index.end() || first_pending->pending != true) {
+      return;
+   }
+
    const auto& state = _db.get<resource_limits_state_object>();
    _db.modify(state, [&](resource_limits_state_object& rso){
       while(!by_owner_index.empty()) {
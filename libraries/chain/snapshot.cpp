@@ -2,8 +2,66 @@
 #include <eosio/chain/exceptions.hpp>
 #include <fc/scoped_exit.hpp>
 
+#include <deque>
+#include <sstream>
+
 namespace eosio { namespace chain {
 
+namespace {
+   /// collects the rows of one part of a section in memory
+   class buffered_part_writer : public snapshot_writer {
+      public:
+         void write_start_section( const std::string& ) override {}
+         void write_row( const detail::abstract_snapshot_row_writer& row_writer ) override {
+            row_writer.write(wrapper);
+            row_count++;
+         }
+         void write_end_section( ) override {}
+
+         std::stringstream       buffer;
+         detail::ostream_wrapper wrapper{buffer};
+         uint64_t                row_count = 0;
+   };
+
+   /**
+    * Fills the parts on tasks started through run, with at most max_parts_in_flight of them held at once, and
+    * hands each finished part to consume in part order.
+    */
+   template<typename PartWriter, typename FillPart, typename Consume>
+   void write_parts_in_order( size_t part_count, const snapshot_writer::task_runner& run, FillPart fill_part, Consume consume ) {
+      const size_t max_parts_in_flight = 16;
+      std::deque<std::pair<std::shared_ptr<PartWriter>, std::future<void>>> in_flight;
+      size_t next_part = 0;
+      try {
+         while( next_part < part_count || !in_flight.empty() ) {
+            if( next_part < part_count && in_flight.size() < max_parts_in_flight ) {
+               auto part_writer = std::make_shared<PartWriter>();
+               auto part = next_part++;
+               in_flight.emplace_back( part_writer, run( [part_writer, part, &fill_part]() { fill_part( part, *part_writer ); } ) );
+               continue;
+            }
+            in_flight.front().second.get();
+            consume( *in_flight.front().first );
+            in_flight.pop_front();
+         }
+      } catch( ... ) {
+         // the parts still running refer to fill_part
+         for( auto& p : in_flight ) {
+            if( p.second.valid() )
+               p.second.wait();
+         }
+         throw;
+      }
+   }
+}
+
+void snapshot_writer::write_parts( size_t part_count, const section_part_filler& fill, const task_runner& ) {
+   auto section = section_writer(*this);
+   for( size_t part = 0; part < part_count; ++part ) {
+      fill(part, section);
+   }
+}
+
 variant_snapshot_writer::variant_snapshot_writer(fc::mutable_variant_object& snapshot)
 : snapshot(snapshot)
 {
@@ -178,6 +236,22 @@ void ostream_snapshot_writer::write_end_section( ) {
    row_count = 0;
 }
 
+void ostream_snapshot_writer::write_parts( size_t part_count, const section_part_filler& fill, const task_runner& run ) {
+   write_parts_in_order<buffered_part_writer>( part_count, run,
+      [&fill]( size_t part, buffered_part_writer& part_writer ) {
+         auto section = make_section_writer(part_writer);
+         fill(part, section);
+      },
+      [this]( buffered_part_writer& part_writer ) {
+         // inserting an empty buffer would set failbit on the snapshot stream
+         if( part_writer.row_count == 0 ) {
+            return;
+         }
+         snapshot.inner << part_writer.buffer.rdbuf();
+         row_count += part_writer.row_count;
+      });
+}
+
 void ostream_snapshot_writer::finalize() {
    uint64_t end_marker = std::numeric_limits<uint64_t>::max();
 
@@ -354,6 +428,19 @@ void integrity_hash_snapshot_writer::write_end_section( ) {
    // no-op for structural details
 }
 
+void integrity_hash_snapshot_writer::write_parts( size_t part_count, const section_part_filler& fill, const task_runner& run ) {
+   // the hash covers the packed rows in order, so it does not depend on where the parts are cut
+   write_parts_in_order<buffered_part_writer>( part_count, run,
+      [&fill]( size_t part, buffered_part_writer& part_writer ) {
+         auto section = make_section_writer(part_writer);
+         fill(part, section);
+      },
+      [this]( buffered_part_writer& part_writer ) {
+         const auto rows = part_writer.buffer.str();
+         enc.write( rows.data(), rows.size() );
+      });
+}
+
 void integrity_hash_snapshot_writer::finalize() {
    // no-op for structural details
 }
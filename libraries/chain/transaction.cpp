@@ -6,6 +6,10 @@
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/multi_index_container.hpp>
@@ -25,7 +29,7 @@ namespace eosio { namespace chain {
 using namespace boost::multi_index;
 
 struct cached_pub_key {
-   transaction_id_type trx_id;
+   digest_type digest;
    public_key_type pub_key;
    signature_type sig;
    cached_pub_key(const cached_pub_key&) = delete;
@@ -48,6 +52,83 @@ typedef multi_index_container<
    >
 > recovery_cache_type;
 
+/**
+ *  Process wide cache of the keys recovered from (signature, digest) pairs, shared by every thread that recovers keys.
+ *  Entries are spread by signature over shards, each an LRU list behind its own mutex, so threads rarely contend.
+ */
+class sharded_recovery_cache {
+   public:
+      bool find( const signature_type& sig, const digest_type& digest, public_key_type& key ) {
+         auto& s = shard_for( sig );
+         std::lock_guard<std::mutex> g( s.mtx );
+         auto& by_sig_idx = s.entries.get<by_sig>();
+         auto it = by_sig_idx.find( sig );
+         if( it == by_sig_idx.end() || it->digest != digest ) {
+            misses.fetch_add( 1, std::memory_order_relaxed );
+            return false;
+         }
+         s.entries.relocate( s.entries.end(), s.entries.project<0>( it ) );
+         key = it->pub_key;
+         hits.fetch_add( 1, std::memory_order_relaxed );
+         return true;
+      }
+
+      void insert( const signature_type& sig, const digest_type& digest, const public_key_type& key ) {
+         auto& s = shard_for( sig );
+         const size_t capacity = shard_capacity.load( std::memory_order_relaxed );
+         std::lock_guard<std::mutex> g( s.mtx );
+         auto& by_sig_idx = s.entries.get<by_sig>();
+         auto it = by_sig_idx.find( sig );
+         if( it != by_sig_idx.end() )
+            by_sig_idx.erase( it );
+         s.entries.emplace_back( cached_pub_key{digest, key, sig} );
+         while( s.entries.size() > capacity )
+            s.entries.pop_front();
+      }
+
+      void set_capacity( size_t capacity ) {
+         shard_capacity.store( (capacity + shard_count - 1) / shard_count, std::memory_order_relaxed );
+      }
+
+      recovery_cache_stats stats() {
+         recovery_cache_stats result;
+         result.hits = hits.load( std::memory_order_relaxed );
+         result.misses = misses.load( std::memory_order_relaxed );
+         for( auto& s : shards ) {
+            std::lock_guard<std::mutex> g( s.mtx );
+            result.size += s.entries.size();
+         }
+         return result;
+      }
+
+   private:
+      static constexpr size_t shard_count = 16;
+
+      struct shard {
+         std::mutex          mtx;
+         recovery_cache_type entries;
+      };
+
+      shard& shard_for( const signature_type& sig ) {
+         return shards[ boost::hash<signature_type>()( sig ) % shard_count ];
+      }
+
+      std::array<shard, shard_count> shards;
+      std::atomic<size_t>            shard_capacity{ (config::default_sig_recovery_cache_size + shard_count - 1) / shard_count };
+      std::atomic<uint64_t>          hits{0};
+      std::atomic<uint64_t>          misses{0};
+};
+
+static sharded_recovery_cache recovery_cache;
+
+void set_recovery_cache_capacity( size_t capacity ) {
+   recovery_cache.set_capacity( capacity );
+}
+
+recovery_cache_stats get_recovery_cache_stats() {
+   return recovery_cache.stats();
+}
+
 void transaction_header::set_reference_block( const block_id_type& reference_block ) {
    ref_block_num    = fc::endian_reverse_u32(reference_block._hash[0]);
    ref_block_prefix = reference_block._hash[1];
@@ -81,25 +162,17 @@ digest_type transaction::sig_digest( const chain_id_type& chain_id, const vector
    return enc.result();
 }
 
-flat_set<public_key_type> transaction::get_signature_keys( const vector<signature_type>& signatures,
-      const chain_id_type& chain_id, const vector<bytes>& cfd, bool allow_duplicate_keys, bool use_cache )const
-{ try {
-   using boost::adaptors::transformed;
-
-   constexpr size_t recovery_cache_size = 1000;
-   static thread_local recovery_cache_type recovery_cache;
-   const digest_type digest = sig_digest(chain_id, cfd);
-
+/// recovers the keys of signatures over digest, the signing digest of a transaction
+static flat_set<public_key_type> recover_signature_keys( const vector<signature_type>& signatures, const digest_type& digest,
+                                                         bool allow_duplicate_keys, bool use_cache )
+{
    flat_set<public_key_type> recovered_pub_keys;
    for(const signature_type& sig : signatures) {
       public_key_type recov;
       if( use_cache ) {
-         recovery_cache_type::index<by_sig>::type::iterator it = recovery_cache.get<by_sig>().find( sig );
-         if( it == recovery_cache.get<by_sig>().end() || it->trx_id != id()) {
+         if( !recovery_cache.find( sig, digest, recov ) ) {
             recov = public_key_type( sig, digest );
-            recovery_cache.emplace_back(cached_pub_key{id(), recov, sig} ); //could fail on dup signatures; not a problem
-         } else {
-            recov = it->pub_key;
+            recovery_cache.insert( sig, digest, recov );
          }
       } else {
          recov = public_key_type( sig, digest );
@@ -112,12 +185,13 @@ flat_set<public_key_type> transaction::get_signature_keys( const vector<signatur
                );
    }
 
-   if( use_cache ) {
-      while ( recovery_cache.size() > recovery_cache_size )
-         recovery_cache.erase( recovery_cache.begin() );
-   }
-
    return recovered_pub_keys;
+}
+
+flat_set<public_key_type> transaction::get_signature_keys( const vector<signature_type>& signatures,
+      const chain_id_type& chain_id, const vector<bytes>& cfd, bool allow_duplicate_keys, bool use_cache )const
+{ try {
+   return recover_signature_keys( signatures, sig_digest(chain_id, cfd), allow_duplicate_keys, use_cache );
 } FC_CAPTURE_AND_RETHROW() }
 
 
@@ -149,6 +223,28 @@ uint32_t packed_transaction::get_prunable_size()const {
    return static_cast<uint32_t>(size);
 }
 
+packed_transaction::packed_transaction( const packed_transaction& other )
+:signatures(other.signatures)
+,compression(other.compression)
+,packed_context_free_data(other.packed_context_free_data)
+,packed_trx(other.packed_trx)
+,unpacked_trx(std::atomic_load(&other.unpacked_trx))
+,sig_digest_cache(std::atomic_load(&other.sig_digest_cache))
+{
+}
+
+packed_transaction& packed_transaction::operator=( const packed_transaction& other ) {
+   if( this != &other ) {
+      signatures = other.signatures;
+      compression = other.compression;
+      packed_context_free_data = other.packed_context_free_data;
+      packed_trx = other.packed_trx;
+      unpacked_trx = std::atomic_load(&other.unpacked_trx);
+      sig_digest_cache = std::atomic_load(&other.sig_digest_cache);
+   }
+   return *this;
+}
+
 digest_type packed_transaction::packed_digest()const {
    digest_type::encoder prunable;
    fc::raw::pack( prunable, signatures );
@@ -288,14 +384,12 @@ vector<bytes> packed_transaction::get_context_free_data()const
 
 time_point_sec packed_transaction::expiration()const
 {
-   local_unpack();
-   return unpacked_trx->expiration;
+   return local_unpack().trx.expiration;
 }
 
 transaction_id_type packed_transaction::id()const
 {
-   local_unpack();
-   return get_transaction().id();
+   return local_unpack().id;
 }
 
 transaction_id_type packed_transaction::get_uncached_id()const
@@ -304,30 +398,60 @@ transaction_id_type packed_transaction::get_uncached_id()const
    return fc::raw::unpack<transaction>( raw ).id();
 }
 
-void packed_transaction::local_unpack()const
+const packed_transaction::unpacked_transaction& packed_transaction::local_unpack()const
 {
-   if (!unpacked_trx) {
+   auto cached = std::atomic_load(&unpacked_trx);
+   if (!cached) {
+      auto unpacked = std::make_shared<unpacked_transaction>();
       try {
          switch(compression) {
          case none:
-            unpacked_trx = unpack_transaction(packed_trx);
+            unpacked->trx = unpack_transaction(packed_trx);
             break;
          case zlib:
-            unpacked_trx = zlib_decompress_transaction(packed_trx);
+            unpacked->trx = zlib_decompress_transaction(packed_trx);
             break;
          default:
             EOS_THROW(unknown_transaction_compression, "Unknown transaction compression algorithm");
          }
       } FC_CAPTURE_AND_RETHROW((compression)(packed_trx))
+      unpacked->id = unpacked->trx.id();
+      // another thread may have unpacked it meanwhile; everyone keeps the first one published
+      std::shared_ptr<const unpacked_transaction> desired = std::move(unpacked);
+      if( std::atomic_compare_exchange_strong(&unpacked_trx, &cached, desired) ) {
+         cached = std::move(desired);
+      }
    }
+   return *cached;
 }
 
 transaction packed_transaction::get_transaction()const
 {
-   local_unpack();
-   return transaction(*unpacked_trx);
+   return local_unpack().trx;
 }
 
+const transaction& packed_transaction::get_unpacked_transaction()const
+{
+   return local_unpack().trx;
+}
+
+digest_type packed_transaction::sig_digest( const chain_id_type& chain_id )const
+{
+   auto cached = std::atomic_load(&sig_digest_cache);
+   if( !cached || cached->chain_id != chain_id ) {
+      auto computed = std::make_shared<const signing_digest>(
+            signing_digest{ chain_id, local_unpack().trx.sig_digest( chain_id, get_context_free_data() ) } );
+      std::atomic_store(&sig_digest_cache, computed);
+      return computed->digest;
+   }
+   return cached->digest;
+}
+
+flat_set<public_key_type> packed_transaction::get_signature_keys( const chain_id_type& chain_id, bool allow_duplicate_keys, bool use_cache )const
+{ try {
+   return recover_signature_keys( signatures, sig_digest(chain_id), allow_duplicate_keys, use_cache );
+} FC_CAPTURE_AND_RETHROW() }
+
 signed_transaction packed_transaction::get_signed_transaction() const
 {
    try {
@@ -359,6 +483,8 @@ void packed_transaction::set_transaction(const transaction& t, packed_transactio
    } FC_CAPTURE_AND_RETHROW((_compression)(t))
    packed_context_free_data.clear();
    compression = _compression;
+   unpacked_trx.reset();
+   sig_digest_cache.reset();
 }
 
 void packed_transaction::set_transaction(const transaction& t, const vector<bytes>& cfd, packed_transaction::compression_type _compression)
@@ -378,6 +504,8 @@ void packed_transaction::set_transaction(const transaction& t, const vector<byte
       }
    } FC_CAPTURE_AND_RETHROW((_compression)(t))
    compression = _compression;
+   unpacked_trx.reset();
+   sig_digest_cache.reset();
 }
 
 
@@ -363,6 +363,11 @@ namespace bacc = boost::accumulators;
       }
 
       auto& rl = control.get_mutable_resource_limits_manager();
+      for( const auto& d : pending_ram_deltas ) {
+         rl.add_pending_ram_usage( d.first, d.second );
+      }
+      pending_ram_deltas.clear();
+
       for( auto a : validate_ram_usage ) {
          rl.verify_account_ram_usage( a );
       }
@@ -525,8 +530,8 @@ namespace bacc = boost::accumulators;
    }
 
    void transaction_context::add_ram_usage( account_name account, int64_t ram_delta ) {
-      auto& rl = control.get_mutable_resource_limits_manager();
-      rl.add_pending_ram_usage( account, ram_delta );
+      // summed per account and applied once in finalize, rather than modifying the usage object on every table operation
+      pending_ram_deltas[account] += ram_delta;
       if( ram_delta > 0 ) {
          validate_ram_usage.insert( account );
       }
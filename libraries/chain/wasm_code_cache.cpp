@@ -0,0 +1,208 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/chain/wasm_code_cache.hpp>
+#include <eosio/chain/config.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include <fc/io/raw.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <fstream>
+
+namespace eosio { namespace chain {
+
+   namespace bfs = boost::filesystem;
+
+   namespace {
+      const char* const use_counts_file_name = "use_counts.bin";
+      const char* const version_file_name = "version.bin";
+
+      bool read_file( const bfs::path& p, vector<char>& out ) {
+         std::ifstream in( p.generic_string(), std::ios::in | std::ios::binary );
+         if( !in )
+            return false;
+         in.seekg( 0, std::ios::end );
+         out.resize( in.tellg() );
+         in.seekg( 0 );
+         in.read( out.data(), out.size() );
+         return !!in;
+      }
+
+      // written next to the target and renamed over it, so a crash never leaves a partial file behind
+      void write_file( const bfs::path& p, const vector<char>& data ) {
+         auto tmp = p;
+         tmp += ".tmp";
+         {
+            std::ofstream out( tmp.generic_string(), std::ios::out | std::ios::binary | std::ios::trunc );
+            out.write( data.data(), data.size() );
+            EOS_ASSERT( !!out, chain_exception, "unable to write ${p}", ("p", tmp.generic_string()) );
+         }
+         bfs::rename( tmp, p );
+      }
+   }
+
+   wasm_code_cache::wasm_code_cache( const bfs::path& dir, uint32_t max_entries )
+   :dir(dir)
+   ,max_entries(max_entries)
+   ,last_save(fc::time_point::now())
+   {
+      if( !bfs::exists( dir ) )
+         bfs::create_directories( dir );
+
+      // code injected by another build may differ from what this one would run, so none of it is kept
+      const auto version = fc::raw::pack( std::make_pair( format_version, build_version ) );
+      vector<char> data;
+      if( !read_file( dir / version_file_name, data ) || data != version ) {
+         vector<bfs::path> stale;
+         for( bfs::directory_iterator itr( dir ), end; itr != end; ++itr ) {
+            if( itr->path().extension() == ".wasm" || itr->path().filename() == use_counts_file_name )
+               stale.push_back( itr->path() );
+         }
+         if( !stale.empty() )
+            ilog( "discarding wasm code cache ${d} written by another build", ("d", dir.generic_string()) );
+         for( const auto& p : stale )
+            bfs::remove( p );
+         write_file( dir / version_file_name, version );
+      }
+
+      for( bfs::directory_iterator itr( dir ), end; itr != end; ++itr ) {
+         const auto& p = itr->path();
+         const auto stem = p.stem().generic_string();
+         if( p.extension() != ".wasm" || stem.size() != 2 * sizeof(digest_type) )
+            continue;
+         try {
+            use_counts.emplace( digest_type( stem ), 0 );
+         } FC_LOG_AND_DROP()
+      }
+
+      if( read_file( dir / use_counts_file_name, data ) ) {
+         try {
+            vector<std::pair<digest_type, uint64_t>> counts;
+            fc::raw::unpack( data, counts );
+            for( const auto& c : counts ) {
+               auto itr = use_counts.find( c.first );
+               if( itr != use_counts.end() )
+                  itr->second = c.second;
+            }
+         } catch( const fc::exception& e ) {
+            wlog( "ignoring corrupt wasm code cache use counts: ${e}", ("e", e.to_string()) );
+         }
+      }
+
+      // the limit may have been lowered since the last run
+      evict( digest_type() );
+   }
+
+   wasm_code_cache::~wasm_code_cache() {
+      try {
+         save_use_counts();
+      } FC_LOG_AND_DROP()
+   }
+
+   bfs::path wasm_code_cache::entry_path( const digest_type& code_id )const {
+      return dir / (code_id.str() + ".wasm");
+   }
+
+   optional<wasm_code_cache::entry> wasm_code_cache::load( const digest_type& code_id )const {
+      const auto p = entry_path( code_id );
+      vector<char> data;
+      if( !read_file( p, data ) )
+         return {};
+      try {
+         fc::datastream<const char*> ds( data.data(), data.size() );
+         uint32_t version = 0;
+         string build;
+         digest_type id, checksum;
+         vector<char> packed;
+         fc::raw::unpack( ds, version );
+         EOS_ASSERT( version == format_version, chain_exception, "unsupported format version ${v}", ("v", version) );
+         fc::raw::unpack( ds, build );
+         EOS_ASSERT( build == build_version, chain_exception, "written by build ${b}", ("b", build) );
+         fc::raw::unpack( ds, id );
+         fc::raw::unpack( ds, checksum );
+         fc::raw::unpack( ds, packed );
+         EOS_ASSERT( id == code_id && checksum == digest_type::hash( packed.data(), packed.size() ), chain_exception,
+                     "checksum mismatch" );
+         return fc::raw::unpack<entry>( packed );
+      } catch( const fc::exception& e ) {
+         wlog( "removing wasm code cache file ${p}: ${e}", ("p", p.generic_string())("e", e.to_string()) );
+      }
+      boost::system::error_code ec;
+      bfs::remove( p, ec );
+      return {};
+   }
+
+   void wasm_code_cache::store( const digest_type& code_id, const entry& e ) {
+      const auto packed = fc::raw::pack( e );
+      const auto checksum = digest_type::hash( packed.data(), packed.size() );
+      auto data = fc::raw::pack( format_version );
+      for( const auto& part : { fc::raw::pack( build_version ), fc::raw::pack( code_id ), fc::raw::pack( checksum ), fc::raw::pack( packed ) } )
+         data.insert( data.end(), part.begin(), part.end() );
+      write_file( entry_path( code_id ), data );
+      use_counts.emplace( code_id, 0 );
+      evict( code_id );
+   }
+
+   void wasm_code_cache::evict( const digest_type& keep ) {
+      add_pending_uses();
+      while( use_counts.size() > max_entries ) {
+         auto least_used = use_counts.end();
+         for( auto itr = use_counts.begin(); itr != use_counts.end(); ++itr ) {
+            if( itr->first != keep && ( least_used == use_counts.end() || itr->second < least_used->second ) )
+               least_used = itr;
+         }
+         if( least_used == use_counts.end() )
+            break;
+         boost::system::error_code ec;
+         bfs::remove( entry_path( least_used->first ), ec );
+         use_counts.erase( least_used );
+      }
+   }
+
+   void wasm_code_cache::add_pending_uses() {
+      if( !pending_uses )
+         return;
+      // uses of code which is not in the directory, because it failed to store or was evicted, are not counted
+      auto itr = use_counts.find( pending_code_id );
+      if( itr != use_counts.end() )
+         itr->second += pending_uses;
+      pending_uses = 0;
+   }
+
+   vector<digest_type> wasm_code_cache::most_used( size_t count ) {
+      add_pending_uses();
+      vector<std::pair<uint64_t, digest_type>> by_count;
+      by_count.reserve( use_counts.size() );
+      for( const auto& c : use_counts )
+         by_count.emplace_back( c.second, c.first );
+      count = std::min( count, by_count.size() );
+      std::partial_sort( by_count.begin(), by_count.begin() + count, by_count.end(),
+                         []( const auto& a, const auto& b ) { return a.first > b.first; } );
+
+      vector<digest_type> result;
+      result.reserve( count );
+      for( size_t i = 0; i < count; ++i )
+         result.push_back( by_count[i].second );
+      return result;
+   }
+
+   void wasm_code_cache::save_use_counts_periodically() {
+      const auto now = fc::time_point::now();
+      if( now - last_save < fc::milliseconds( config::wasm_code_cache_save_interval_ms ) )
+         return;
+      try {
+         save_use_counts();
+      } FC_LOG_AND_DROP()
+      last_save = now;
+   }
+
+   void wasm_code_cache::save_use_counts() {
+      add_pending_uses();
+      vector<std::pair<digest_type, uint64_t>> counts( use_counts.begin(), use_counts.end() );
+      write_file( dir / use_counts_file_name, fc::raw::pack( counts ) );
+   }
+
+} } /// eosio::chain
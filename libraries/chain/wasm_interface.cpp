@@ -27,7 +27,8 @@ namespace eosio { namespace chain {
    using namespace webassembly;
    using namespace webassembly::common;
 
-   wasm_interface::wasm_interface(vm_type vm) : my( new wasm_interface_impl(vm) ) {}
+   wasm_interface::wasm_interface(vm_type vm, const path& code_cache_dir, uint32_t code_cache_max_entries)
+   : my( new wasm_interface_impl(vm, code_cache_dir, code_cache_max_entries) ) {}
 
    wasm_interface::~wasm_interface() {}
 
@@ -58,6 +59,15 @@ namespace eosio { namespace chain {
       my->get_instantiated_module(code_id, code, context.trx_context)->apply(context);  // 调用合约的apply方法, 这就是智能合约中有一个apply函数的原因
    }
 
+   void wasm_interface::warm_up_code_cache(uint32_t count) {
+      my->warm_up_code_cache(count);
+   }
+
+   void wasm_interface::save_code_cache_use_counts() {
+      if(my->code_cache)
+         my->code_cache->save_use_counts_periodically();
+   }
+
    void wasm_interface::exit() {
       my->runtime_interface->immediately_exit_currently_running_module();
    }
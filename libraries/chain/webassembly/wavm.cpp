@@ -12,8 +12,15 @@
 #include "Runtime/Linker.h"
 #include "Runtime/Intrinsics.h"
 
+#include <algorithm>
 #include <mutex>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 using namespace IR;
 using namespace Runtime;
 
@@ -21,12 +28,150 @@ namespace eosio { namespace chain { namespace webassembly { namespace wavm {
 
 running_instance_context the_running_instance_context;
 
+#if defined(__linux__) && defined(SYS_memfd_create)
+/**
+ * The initial linear memory of a module, mapped copy-on-write from an anonymous file over the start of the sandbox
+ * memory. Pages an action only reads are shared with the file, pages it writes get private copies, and resetting the
+ * memory drops the private copies; so while the same module keeps running a reset costs the pages touched by the last
+ * action instead of the whole initial memory.
+ *
+ * The sandbox memory is shared by all modules and only one image is mapped over it at a time. The files of the most
+ * recently mapped images stay open, so switching back to one of them only maps it again; the others are written again
+ * when they are next mapped.
+ */
+class memory_image {
+   public:
+      /// how many image files are kept open
+      static constexpr size_t max_open_files = 16;
+
+      memory_image(const std::vector<uint8_t>& initial_memory, size_t num_bytes) :
+         _initial_memory(initial_memory), _num_bytes(num_bytes) {}
+
+      ~memory_image() {
+         if(mapped == this)
+            unmap();
+         close_file();
+      }
+
+      memory_image(const memory_image&) = delete;
+      memory_image& operator=(const memory_image&) = delete;
+
+      bool valid()const { return _num_bytes && _initial_memory.size() <= _num_bytes; }
+
+      /// unmaps whichever image is mapped over the sandbox memory
+      static void release() {
+         if(mapped)
+            mapped->unmap();
+      }
+
+      /// resets the sandbox memory to this image, false if it could not be mapped and the caller must reset the memory
+      bool reset(MemoryInstance* memory, MemoryType& memory_type) {
+         U8* base = getMemoryBaseAddress(memory);
+         if(mapped == this && mapped_base == base) {
+            // pages grown by the last action are past the image, shrinking decommits them and growMemory clears them
+            // again when an action grows into them
+            const Uptr num_pages = getMemoryNumPages(memory);
+            if(num_pages > memory_type.size.min && shrinkMemory(memory, num_pages - memory_type.size.min) == -1)
+               causeException(Exception::Cause::outOfMemory);
+            return madvise(base, _num_bytes, MADV_DONTNEED) == 0;
+         }
+
+         release();
+         // the image covers all of the initial pages, so they are not cleared before it is mapped over them
+         resetMemory(memory, memory_type, false);
+         const int fd = open_file();
+         if(fd < 0)
+            return false;
+         if(mmap(base, _num_bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, fd, 0) == MAP_FAILED)
+            return false;
+         mapped = this;
+         mapped_base = base;
+         return true;
+      }
+
+   private:
+      /// the file holding this image, most recently used first in open_files; -1 on failure
+      int open_file() {
+         auto it = std::find_if(open_files.begin(), open_files.end(),
+                                [this](const open_file_t& f) { return f.image == this; });
+         if(it != open_files.end()) {
+            std::rotate(open_files.begin(), it, it + 1);
+            return open_files.front().fd;
+         }
+         const int fd = create_file();
+         if(fd < 0)
+            return -1;
+         if(open_files.size() >= max_open_files) {
+            // a mapping keeps its file alive, so closing the descriptor of the mapped image is fine too
+            close(open_files.back().fd);
+            open_files.pop_back();
+         }
+         open_files.insert(open_files.begin(), open_file_t{this, fd});
+         return fd;
+      }
+
+      void close_file() {
+         auto it = std::find_if(open_files.begin(), open_files.end(),
+                                [this](const open_file_t& f) { return f.image == this; });
+         if(it != open_files.end()) {
+            close(it->fd);
+            open_files.erase(it);
+         }
+      }
+
+      /// a file holding the initial memory, -1 on failure
+      int create_file()const {
+         int fd = syscall(SYS_memfd_create, "wasm_memory_image", 0);
+         if(fd < 0)
+            return -1;
+         // the file is sparse, bytes past the data segments read as zero
+         bool written = ftruncate(fd, _num_bytes) == 0;
+         for(size_t offset = 0; written && offset < _initial_memory.size();) {
+            ssize_t n = pwrite(fd, _initial_memory.data() + offset, _initial_memory.size() - offset, offset);
+            written = n > 0;
+            offset += written ? n : 0;
+         }
+         if(written)
+            return fd;
+         close(fd);
+         return -1;
+      }
+
+      /// puts back the anonymous pages the sandbox memory expects, the image range is always committed
+      void unmap() {
+         if(mmap(mapped_base, _num_bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0) == MAP_FAILED)
+            Errors::fatal("failed to restore wasm memory pages");
+         mapped = nullptr;
+         mapped_base = nullptr;
+      }
+
+      struct open_file_t {
+         const memory_image* image;
+         int                 fd;
+      };
+
+      const std::vector<uint8_t>& _initial_memory;
+      size_t                      _num_bytes;
+
+      static memory_image*             mapped;
+      static U8*                       mapped_base;
+      static std::vector<open_file_t>  open_files;
+};
+
+memory_image*                          memory_image::mapped = nullptr;
+U8*                                    memory_image::mapped_base = nullptr;
+std::vector<memory_image::open_file_t> memory_image::open_files;
+#endif
+
 class wavm_instantiated_module : public wasm_instantiated_module_interface {
    public:
       wavm_instantiated_module(ModuleInstance* instance, std::unique_ptr<Module> module, std::vector<uint8_t> initial_mem) :
          _initial_memory(initial_mem),
          _instance(instance),
          _module(std::move(module))
+#if defined(__linux__) && defined(SYS_memfd_create)
+         ,_memory_image(_initial_memory, _module->memories.defs.size() ? _module->memories.defs[0].type.size.min << IR::numBytesPerPageLog2 : 0)
+#endif
       {}
 
       void apply(apply_context& context) override {
@@ -49,12 +194,12 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
             //The memory instance is reused across all wavm_instantiated_modules, but for wasm instances
             // that didn't declare "memory", getDefaultMemory() won't see it
             MemoryInstance* default_mem = getDefaultMemory(_instance);
-            if(default_mem) {
+            if(default_mem && !reset_to_memory_image(default_mem)) {
                //reset memory resizes the sandbox'ed memory to the module's init memory size and then
                // (effectively) memzeros it all
                resetMemory(default_mem, _module->memories.defs[0].type);
 
-               char* memstart = &memoryRef<char>(getDefaultMemory(_instance), 0);
+               char* memstart = &memoryRef<char>(default_mem, 0);
                memcpy(memstart, _initial_memory.data(), _initial_memory.size());
             }
 
@@ -74,11 +219,24 @@ class wavm_instantiated_module : public wasm_instantiated_module_interface {
       }
 
 
+      bool reset_to_memory_image(MemoryInstance* default_mem) {
+#if defined(__linux__) && defined(SYS_memfd_create)
+         if(_memory_image.valid() && _memory_image.reset(default_mem, _module->memories.defs[0].type))
+            return true;
+         // another module's image must not show through the pages resetMemory recommits
+         memory_image::release();
+#endif
+         return false;
+      }
+
       std::vector<uint8_t>     _initial_memory;
       //naked pointer because ModuleInstance is opaque
       //_instance is deleted via WAVM's object garbage collection when wavm_rutime is deleted
       ModuleInstance*          _instance;
       std::unique_ptr<Module>  _module;
+#if defined(__linux__) && defined(SYS_memfd_create)
+      memory_image             _memory_image;
+#endif
 };
 
 
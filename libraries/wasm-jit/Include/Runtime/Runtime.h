@@ -212,7 +212,8 @@ namespace Runtime
 
 	RUNTIME_API void runInstanceStartFunc(ModuleInstance* moduleInstance);
 	RUNTIME_API void resetGlobalInstances(ModuleInstance* moduleInstance);
-	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType);
+	// Resizes the memory to newMemoryType's initial size. Without clearPages the caller must overwrite the memory itself.
+	RUNTIME_API void resetMemory(MemoryInstance* memory, IR::MemoryType& newMemoryType, bool clearPages = true);
 
 	// Gets an object exported by a ModuleInstance by name.
 	RUNTIME_API ObjectInstance* getInstanceExport(ModuleInstance* moduleInstance,const std::string& name);
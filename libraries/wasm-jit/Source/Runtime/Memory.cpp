@@ -88,17 +88,7 @@ namespace Runtime
 		return Uptr(memory->type.size.max);
 	}
 
-	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType) {
-		memory->type.size.min = 1;
-		if(shrinkMemory(memory, memory->numPages - 1) == -1)
-			causeException(Exception::Cause::outOfMemory);
-		memset(memory->baseAddress, 0, 1<<IR::numBytesPerPageLog2);
-		memory->type = newMemoryType;
-		if(growMemory(memory, memory->type.size.min - 1) == -1)
-			causeException(Exception::Cause::outOfMemory);
-   }
-
-	Iptr growMemory(MemoryInstance* memory,Uptr numNewPages)
+	static Iptr commitMemoryPages(MemoryInstance* memory,Uptr numNewPages,bool clearPages)
 	{
 		const Uptr previousNumPages = memory->numPages;
 		if(numNewPages > 0)
@@ -114,12 +104,27 @@ namespace Runtime
 			{
 				return -1;
 			}
-			memset(memory->baseAddress + (memory->numPages << IR::numBytesPerPageLog2), 0, numNewPages << IR::numBytesPerPageLog2);
+			if(clearPages) { memset(memory->baseAddress + (memory->numPages << IR::numBytesPerPageLog2), 0, numNewPages << IR::numBytesPerPageLog2); }
 			memory->numPages += numNewPages;
 		}
 		return previousNumPages;
 	}
 
+	void resetMemory(MemoryInstance* memory, MemoryType& newMemoryType, bool clearPages) {
+		memory->type.size.min = 1;
+		if(shrinkMemory(memory, memory->numPages - 1) == -1)
+			causeException(Exception::Cause::outOfMemory);
+		if(clearPages) { memset(memory->baseAddress, 0, 1<<IR::numBytesPerPageLog2); }
+		memory->type = newMemoryType;
+		if(commitMemoryPages(memory, memory->type.size.min - 1, clearPages) == -1)
+			causeException(Exception::Cause::outOfMemory);
+   }
+
+	Iptr growMemory(MemoryInstance* memory,Uptr numNewPages)
+	{
+		return commitMemoryPages(memory, numNewPages, true);
+	}
+
 	Iptr shrinkMemory(MemoryInstance* memory,Uptr numPagesToShrink)
 	{
 		const Uptr previousNumPages = memory->numPages;
@@ -80,6 +80,12 @@ namespace fc {
 const fc::string logger_name("bnet_plugin");
 fc::logger plugin_logger;
 std::string peer_log_format;
+/**
+ * websocket permessage-deflate offered and accepted by every session, negotiated in the websocket handshake.
+ * Once negotiated every message of the session is compressed: Boost.Beast has no minimum message size for
+ * permessage-deflate and no public way to send a single message uncompressed.
+ */
+ws::permessage_deflate deflate_options;
 
 #define peer_dlog( PEER, FORMAT, ... ) \
   FC_MULTILINE_MACRO_BEGIN \
@@ -325,6 +331,7 @@ namespace eosio {
             _session_num = next_session_id();
             set_socket_options();
             _ws->binary(true);
+            _ws->set_option( deflate_options );
             wlog( "open session ${n}",("n",_session_num) );
         }
 
@@ -343,6 +350,7 @@ namespace eosio {
         {
            _session_num = next_session_id();
            _ws->binary(true);
+           _ws->set_option( deflate_options );
            wlog( "open session ${n}",("n",_session_num) );
         }
 
@@ -555,8 +563,7 @@ namespace eosio {
            for( const auto& receipt : s->block->transactions ) {
               if( receipt.trx.which() == 1 ) {
                  const auto& pt = receipt.trx.get<packed_transaction>();
-                 // get id via get_uncached_id() as packed_transaction.id() mutates internal transaction state
-                 const auto& tid = pt.get_uncached_id();
+                 const auto& tid = pt.id();
                  auto itr = _transaction_status.find( tid );
                  if( itr != _transaction_status.end() )
                     _transaction_status.erase(itr);
@@ -1014,8 +1021,7 @@ namespace eosio {
            for( const auto& receipt : b->transactions ) {
               if( receipt.trx.which() == 1 ) {
                  const auto& pt = receipt.trx.get<packed_transaction>();
-                 // get id via get_uncached_id() as packed_transaction.id() mutates internal transaction state
-                 const auto& id = pt.get_uncached_id();
+                 const auto& id = pt.id();
                  mark_transaction_known_by_peer(id);
               }
            }
@@ -1301,6 +1307,8 @@ namespace eosio {
          ("bnet-threads", bpo::value<uint32_t>(), "the number of threads to use to process network messages" )
          ("bnet-connect", bpo::value<vector<string>>()->composing(), "remote endpoint of other node to connect to; Use multiple bnet-connect options as needed to compose a network" )
          ("bnet-no-trx", bpo::bool_switch()->default_value(false), "this peer will request no pending transactions from other nodes" )
+         ("bnet-compression", bpo::value<bool>()->default_value(true), "offer and accept websocket permessage-deflate compression, used with the peers that also enable it. "
+           "All messages to such peers are compressed, there is no minimum message size because Boost.Beast cannot send single messages uncompressed" )
          ("bnet-peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
            "Available Variables:\n"
@@ -1344,6 +1352,12 @@ namespace eosio {
          }
          my->_request_trx = !options.at( "bnet-no-trx" ).as<bool>();
 
+         if( options.at( "bnet-compression" ).as<bool>() ) {
+            deflate_options.client_enable = true;
+            deflate_options.server_enable = true;
+            deflate_options.compLevel = 1; // messages are compressed on the session threads, favor speed
+         }
+
       } FC_LOG_AND_RETHROW()
    }
 
@@ -1552,8 +1566,7 @@ namespace eosio {
       // ilog( "recv trx ${n}", ("n", id) );
       if( p->expiration() < fc::time_point::now() ) return;
 
-      // get id via get_uncached_id() as packed_transaction.id() mutates internal transaction state
-      const auto& id = p->get_uncached_id();
+      const auto& id = p->id();
 
       if( mark_transaction_known_by_peer( id ) )
         return;
@@ -48,6 +48,49 @@ struct async_result_visitor : public fc::visitor<std::string> {
           } \
        }}
 
+// writes the result of a call as json
+struct json_serializer {
+   template<typename T>
+   std::string operator()(const T& v) const {
+      return fc::json::to_string(v);
+   }
+};
+
+// for the _unserialized calls, which only copy what they need out of the chain state and write their own json
+struct to_json_serializer {
+   template<typename T>
+   std::string operator()(const T& v) const {
+      return v.to_json();
+   }
+};
+
+// the request is parsed and the response serialized on an http thread, only main_thread_call runs on the application thread
+#define CALL_ON_MAIN_THREAD(api_name, api_handle, api_namespace, call_name, main_thread_call, serializer, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle](string, string body, url_response_callback cb) mutable { \
+      try { \
+         if (body.empty()) body = "{}"; \
+         auto params = fc::json::from_string(body).as<api_namespace::call_name ## _params>(); \
+         app().get_io_service().post([api_handle, params = std::move(params), body = std::move(body), cb]() mutable { \
+            try { \
+               api_handle.validate(); \
+               auto result = api_handle.main_thread_call(params); \
+               app().get_plugin<http_plugin>().post_http_thread_pool([result = std::move(result), body = std::move(body), cb]() { \
+                  try { \
+                     cb(http_response_code, serializer()(result)); \
+                  } catch (...) { \
+                     http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+                  } \
+               }); \
+            } catch (...) { \
+               http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+            } \
+         }); \
+      } catch (...) { \
+         http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+      } \
+   }}
+
 #define CALL_ASYNC(api_name, api_handle, api_namespace, call_name, call_result, http_response_code) \
 {std::string("/v1/" #api_name "/" #call_name), \
    [api_handle](string, string body, url_response_callback cb) mutable { \
@@ -68,7 +111,8 @@ struct async_result_visitor : public fc::visitor<std::string> {
    }\
 }
 
-#define CHAIN_RO_CALL(call_name, http_response_code) CALL(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
+#define CHAIN_RO_CALL(call_name, http_response_code) CALL_ON_MAIN_THREAD(chain, ro_api, chain_apis::read_only, call_name, call_name, json_serializer, http_response_code)
+#define CHAIN_RO_CALL_UNSERIALIZED(call_name, http_response_code) CALL_ON_MAIN_THREAD(chain, ro_api, chain_apis::read_only, call_name, call_name ## _unserialized, to_json_serializer, http_response_code)
 #define CHAIN_RW_CALL(call_name, http_response_code) CALL(chain, rw_api, chain_apis::read_write, call_name, http_response_code)
 #define CHAIN_RO_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, ro_api, chain_apis::read_only, call_name, call_result, http_response_code)
 #define CHAIN_RW_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, rw_api, chain_apis::read_write, call_name, call_result, http_response_code)
@@ -82,9 +126,9 @@ void chain_api_plugin::plugin_startup() {
    auto& _http_plugin = app().get_plugin<http_plugin>();
    ro_api.set_shorten_abi_errors( !_http_plugin.verbose_errors() );
 
-   _http_plugin.add_api({
+   _http_plugin.add_async_api({
       CHAIN_RO_CALL(get_info, 200l), // /v1/chain/get_info
-      CHAIN_RO_CALL(get_block, 200), // /v1/chain/get_block
+      CHAIN_RO_CALL_UNSERIALIZED(get_block, 200), // /v1/chain/get_block
       CHAIN_RO_CALL(get_block_header_state, 200), // /v1/chain/get_block_header_state
       CHAIN_RO_CALL(get_account, 200), // /v1/chain/get_account
       CHAIN_RO_CALL(get_code, 200), // /v1/chain/get_code
@@ -92,17 +136,20 @@ void chain_api_plugin::plugin_startup() {
       CHAIN_RO_CALL(get_abi, 200), // /v1/chain/get_abi
       CHAIN_RO_CALL(get_raw_code_and_abi, 200), // /v1/chain/get_raw_code_and_abi
       CHAIN_RO_CALL(get_raw_abi, 200),
-      CHAIN_RO_CALL(get_table_rows, 200), // /v1/chain/get_table_rows
+      CHAIN_RO_CALL_UNSERIALIZED(get_table_rows, 200), // /v1/chain/get_table_rows
       CHAIN_RO_CALL(get_table_by_scope, 200),
       CHAIN_RO_CALL(get_currency_balance, 200), // /v1/chain/get_currency_balance
       CHAIN_RO_CALL(get_currency_stats, 200), // /v1/chain/get_currency_stats
       CHAIN_RO_CALL(get_producers, 200), // /v1/chain/get_producers
       CHAIN_RO_CALL(get_producer_schedule, 200), // /v1/chain/get_producer_schedule
       CHAIN_RO_CALL(get_scheduled_transactions, 200), // /v1/chain/get_scheduled_transactions
-      CHAIN_RO_CALL(abi_json_to_bin, 200), // /v1/chain/abi_json_to_bin
-      CHAIN_RO_CALL(abi_bin_to_json, 200), // /v1/chain/abi_bin_to_json
+      CHAIN_RO_CALL_UNSERIALIZED(abi_json_to_bin, 200), // /v1/chain/abi_json_to_bin
+      CHAIN_RO_CALL_UNSERIALIZED(abi_bin_to_json, 200), // /v1/chain/abi_bin_to_json
       CHAIN_RO_CALL(get_required_keys, 200), // /v1/chain/get_required_keys
-      CHAIN_RO_CALL(get_transaction_id, 200), // /v1/chain/get_transaction_id
+      CHAIN_RO_CALL(get_transaction_id, 200) // /v1/chain/get_transaction_id
+   });
+
+   _http_plugin.add_api({
       CHAIN_RW_CALL_ASYNC(push_block, chain_apis::read_write::push_block_results, 202), // /v1/chain/push_block
       CHAIN_RW_CALL_ASYNC(push_transaction, chain_apis::read_write::push_transaction_results, 202), // /v1/chain/push_transaction
       CHAIN_RW_CALL_ASYNC(push_transactions, chain_apis::read_write::push_transactions_results, 202) // /v1/chain/push_transactions
@@ -210,8 +210,22 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
    cfg.add_options()
          ("blocks-dir", bpo::value<bfs::path>()->default_value("blocks"),
           "the location of the blocks directory (absolute path or relative to application data dir)")
+         ("blocks-log-mmap", bpo::bool_switch()->default_value(false),
+          "memory map blocks.log and blocks.index and serve block reads directly from the mapping")
+         ("blocks-log-segment-size", bpo::value<uint32_t>()->default_value(0),
+          "seal blocks.log into a segment file every this many irreversible blocks, sealed segments are compressed in the background. An existing larger blocks.log is split into segments of this size at startup (0 to disable)")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
          ("wasm-runtime", bpo::value<eosio::chain::wasm_interface::vm_type>()->value_name("wavm/wabt"), "Override default WASM runtime")
+         ("wasm-code-cache-dir", bpo::value<bfs::path>(),
+          "the location of the directory where contract code is kept ready for instantiation across restarts (absolute path or relative to application data dir), disabled if not set")
+         ("wasm-code-cache-warmup", bpo::value<uint32_t>()->default_value(0),
+          "Number of the most applied contracts of the wasm code cache to instantiate at startup")
+         ("wasm-code-cache-max-entries", bpo::value<uint32_t>()->default_value(config::default_wasm_code_cache_max_entries),
+          "Number of contracts kept in the wasm code cache directory, the least applied ones are removed first")
+         ("signature-recovery-cache-size", bpo::value<uint32_t>()->default_value(config::default_sig_recovery_cache_size),
+          "Number of keys recovered from transaction signatures to keep, shared by all threads")
+         ("abi-serializer-cache-size", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_cache_size),
+          "Number of contract abis to keep built for api reads, 0 to disable the cache")
          ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_ms),
           "Override default maximum ABI serialization time allowed in ms")
          ("chain-state-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024  * 1024)), "Maximum size (in MiB) of the chain state database")
@@ -220,6 +234,8 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
          ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
          ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in controller thread pool")
+         ("replay-lookahead-blocks", bpo::value<uint16_t>()->default_value(config::default_replay_lookahead_blocks),
+          "Number of blocks read, unpacked and header validated on the controller thread pool ahead of the block being applied during replay (0 to disable)")
          ("contracts-console", bpo::bool_switch()->default_value(false),
           "print contract's output to console")
          ("actor-whitelist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
@@ -402,12 +418,26 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( options.count( "wasm-runtime" ))
          my->wasm_runtime = options.at( "wasm-runtime" ).as<vm_type>();
 
+      if( options.count( "wasm-code-cache-dir" )) {
+         auto ccd = options.at( "wasm-code-cache-dir" ).as<bfs::path>();
+         if( ccd.is_relative())
+            my->chain_config->wasm_code_cache_dir = app().data_dir() / ccd;
+         else
+            my->chain_config->wasm_code_cache_dir = ccd;
+      }
+      my->chain_config->wasm_code_cache_warmup = options.at( "wasm-code-cache-warmup" ).as<uint32_t>();
+      my->chain_config->wasm_code_cache_max_entries = options.at( "wasm-code-cache-max-entries" ).as<uint32_t>();
+
       if(options.count("abi-serializer-max-time-ms"))
          my->abi_serializer_max_time_ms = fc::microseconds(options.at("abi-serializer-max-time-ms").as<uint32_t>() * 1000);
 
       my->chain_config->blocks_dir = my->blocks_dir;
       my->chain_config->state_dir = app().data_dir() / config::default_state_dir_name;
       my->chain_config->read_only = my->readonly;
+      my->chain_config->blocks_log_mmap = options.at( "blocks-log-mmap" ).as<bool>();
+      my->chain_config->blocks_log_segment_size = options.at( "blocks-log-segment-size" ).as<uint32_t>();
+      my->chain_config->abi_serializer_cache_size = options.at( "abi-serializer-cache-size" ).as<uint32_t>();
+      set_recovery_cache_capacity( options.at( "signature-recovery-cache-size" ).as<uint32_t>() );
 
       if( options.count( "chain-state-db-size-mb" ))
          my->chain_config->state_size = options.at( "chain-state-db-size-mb" ).as<uint64_t>() * 1024 * 1024;
@@ -428,6 +458,9 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                      "chain-threads ${num} must be greater than 0", ("num", my->chain_config->thread_pool_size) );
       }
 
+      if( options.count( "replay-lookahead-blocks" ))
+         my->chain_config->replay_lookahead_blocks = options.at( "replay-lookahead-blocks" ).as<uint16_t>();
+
       if( my->wasm_runtime )
          my->chain_config->wasm_runtime = *my->wasm_runtime;
 
@@ -742,6 +775,9 @@ void chain_plugin::plugin_shutdown() {
    my->applied_transaction_connection.reset();
    my->accepted_confirmation_connection.reset();
    my->chain.reset();
+
+   auto stats = get_recovery_cache_stats();
+   ilog( "signature recovery cache: ${h} hits, ${m} misses, ${s} entries", ("h", stats.hits)("m", stats.misses)("s", stats.size) );
 }
 
 chain_apis::read_write::read_write(controller& db, const fc::microseconds& abi_serializer_max_time)
@@ -1139,6 +1175,17 @@ abi_def get_abi( const controller& db, const name& account ) {
    return abi;
 }
 
+cached_abi_ptr get_cached_abi( const controller& db, const name& account, const fc::microseconds& abi_serializer_max_time ) {
+   const account_object *code_accnt = db.db().find<account_object, by_name>(account);
+   EOS_ASSERT(code_accnt != nullptr, chain::account_query_exception, "Fail to retrieve account for ${account}", ("account", account) );
+   auto abi = db.get_cached_abi( account, abi_serializer_max_time );
+   if( !abi ) {
+      static const cached_abi_ptr empty_abi = std::make_shared<const cached_abi>();
+      return empty_abi;
+   }
+   return abi;
+}
+
 string get_table_type( const abi_def& abi, const name& table_name ) {
    for( const auto& t : abi.tables ) {
       if( t.name == table_name ){
@@ -1148,65 +1195,130 @@ string get_table_type( const abi_def& abi, const name& table_name ) {
    EOS_ASSERT( false, chain::contract_table_query_exception, "Table ${table} is not specified in the ABI", ("table",table_name) );
 }
 
-read_only::get_table_rows_result read_only::get_table_rows( const read_only::get_table_rows_params& p )const {
-   const abi_def abi = eosio::chain_apis::get_abi( db, p.code );
-
+template <typename RowFn>
+bool read_only::walk_table_rows( const read_only::get_table_rows_params& p, const abi_def& abi, RowFn&& on_row )const {
    bool primary = false;
    auto table_with_index = get_table_index_name( p, primary );
    if( primary ) {
       EOS_ASSERT( p.table == table_with_index, chain::contract_table_query_exception, "Invalid table name ${t}", ( "t", p.table ));
       auto table_type = get_table_type( abi, p.table );
       if( table_type == KEYi64 || p.key_type == "i64" || p.key_type == "name" ) {
-         return get_table_rows_ex<key_value_index>(p,abi);
+         return walk_table_rows_ex<key_value_index>(p, on_row);
       }
       EOS_ASSERT( false, chain::contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type)("abi",abi));
    } else {
       EOS_ASSERT( !p.key_type.empty(), chain::contract_table_query_exception, "key type required for non-primary index" );
 
       if (p.key_type == chain_apis::i64 || p.key_type == "name") {
-         return get_table_rows_by_seckey<index64_index, uint64_t>(p, abi, [](uint64_t v)->uint64_t {
+         return walk_table_rows_by_seckey<index64_index, uint64_t>(p, abi, [](uint64_t v)->uint64_t {
             return v;
-         });
+         }, on_row);
       }
       else if (p.key_type == chain_apis::i128) {
-         return get_table_rows_by_seckey<index128_index, uint128_t>(p, abi, [](uint128_t v)->uint128_t {
+         return walk_table_rows_by_seckey<index128_index, uint128_t>(p, abi, [](uint128_t v)->uint128_t {
             return v;
-         });
+         }, on_row);
       }
       else if (p.key_type == chain_apis::i256) {
          if ( p.encode_type == chain_apis::hex) {
             using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-            return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+            return walk_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function(), on_row);
          }
          using  conv = keytype_converter<chain_apis::i256>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return walk_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function(), on_row);
       }
       else if (p.key_type == chain_apis::float64) {
-         return get_table_rows_by_seckey<index_double_index, double>(p, abi, [](double v)->float64_t {
+         return walk_table_rows_by_seckey<index_double_index, double>(p, abi, [](double v)->float64_t {
             float64_t f = *(float64_t *)&v;
             return f;
-         });
+         }, on_row);
       }
       else if (p.key_type == chain_apis::float128) {
-         return get_table_rows_by_seckey<index_long_double_index, double>(p, abi, [](double v)->float128_t{
+         return walk_table_rows_by_seckey<index_long_double_index, double>(p, abi, [](double v)->float128_t{
             float64_t f = *(float64_t *)&v;
             float128_t f128;
             f64_to_f128M(f, &f128);
             return f128;
-         });
+         }, on_row);
       }
       else if (p.key_type == chain_apis::sha256) {
          using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return walk_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function(), on_row);
       }
       else if(p.key_type == chain_apis::ripemd160) {
          using  conv = keytype_converter<chain_apis::ripemd160,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return walk_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function(), on_row);
       }
       EOS_ASSERT(false, chain::contract_table_query_exception,  "Unsupported secondary index type: ${t}", ("t", p.key_type));
    }
 }
 
+read_only::get_table_rows_result read_only::get_table_rows( const read_only::get_table_rows_params& p )const {
+   const auto cached = eosio::chain_apis::get_cached_abi( db, p.code, abi_serializer_max_time );
+   const abi_serializer& abis = cached->serializer;
+   const auto table_type = abis.get_table_type(p.table);
+   const bool show_payer = p.show_payer && *p.show_payer;
+
+   read_only::get_table_rows_result result;
+   result.more = walk_table_rows( p, cached->abi, [&]( const vector<char>& data, account_name payer ) {
+      fc::variant data_var;
+      if( p.json ) {
+         data_var = abis.binary_to_variant( table_type, data, abi_serializer_max_time, shorten_abi_errors );
+      } else {
+         data_var = fc::variant( data );
+      }
+
+      if( show_payer ) {
+         result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", payer) );
+      } else {
+         result.rows.emplace_back( std::move(data_var) );
+      }
+   });
+   return result;
+}
+
+read_only::get_table_rows_unserialized_result read_only::get_table_rows_unserialized( const read_only::get_table_rows_params& p )const {
+   read_only::get_table_rows_unserialized_result result;
+   result.abi = eosio::chain_apis::get_cached_abi( db, p.code, abi_serializer_max_time );
+   result.table_type = result.abi->serializer.get_table_type(p.table);
+   result.json = p.json;
+   result.show_payer = p.show_payer && *p.show_payer;
+   result.abi_serializer_max_time = abi_serializer_max_time;
+   result.shorten_abi_errors = shorten_abi_errors;
+
+   result.more = walk_table_rows( p, result.abi->abi, [&]( const vector<char>& data, account_name payer ) {
+      result.rows.emplace_back( data, payer );
+   });
+   return result;
+}
+
+string read_only::get_table_rows_unserialized_result::to_json()const {
+   string out = "{\"rows\":[";
+   bool first_row = true;
+   for( const auto& row : rows ) {
+      if( !first_row )
+         out += ',';
+      first_row = false;
+
+      if( show_payer )
+         out += "{\"data\":";
+      if( json ) {
+         abi->serializer.binary_to_json( table_type, row.first, out, abi_serializer_max_time, shorten_abi_errors );
+      } else {
+         out += fc::json::to_string( fc::variant( row.first ) );
+      }
+      if( show_payer ) {
+         out += ",\"payer\":\"";
+         out += row.second.to_string();
+         out += "\"}";
+      }
+   }
+   out += "],\"more\":";
+   out += more ? "true" : "false";
+   out += '}';
+   return out;
+}
+
 read_only::get_table_by_scope_result read_only::get_table_by_scope( const read_only::get_table_by_scope_params& p )const {
    read_only::get_table_by_scope_result result;
    const auto& d = db.db();
@@ -1329,9 +1441,10 @@ fc::variant get_global_row( const database& db, const abi_def& abi, const abi_se
 }
 
 read_only::get_producers_result read_only::get_producers( const read_only::get_producers_params& p ) const {
-   const abi_def abi = eosio::chain_apis::get_abi(db, config::system_account_name);
+   const auto cached = eosio::chain_apis::get_cached_abi(db, config::system_account_name, abi_serializer_max_time);
+   const abi_def& abi = cached->abi;
    const auto table_type = get_table_type(abi, N(producers));
-   const abi_serializer abis{ abi, abi_serializer_max_time };
+   const abi_serializer& abis = cached->serializer;
    EOS_ASSERT(table_type == KEYi64, chain::contract_table_query_exception, "Invalid table type ${type} for table producers", ("type",table_type));
 
    const auto& d = db.db();
@@ -1393,16 +1506,8 @@ read_only::get_producer_schedule_result read_only::get_producer_schedule( const
 template<typename Api>
 struct resolver_factory {
    static auto make(const Api* api, const fc::microseconds& max_serialization_time) {
-      return [api, max_serialization_time](const account_name &name) -> optional<abi_serializer> {
-         const auto* accnt = api->db.db().template find<account_object, by_name>(name);
-         if (accnt != nullptr) {
-            abi_def abi;
-            if (abi_serializer::to_abi(accnt->abi, abi)) {
-               return abi_serializer(abi, max_serialization_time);
-            }
-         }
-
-         return optional<abi_serializer>();
+      return [api, max_serialization_time](const account_name &name) -> std::shared_ptr<const abi_serializer> {
+         return abi_serializer_cache::serializer( api->db.get_cached_abi(name, max_serialization_time) );
       };
    }
 };
@@ -1486,7 +1591,7 @@ read_only::get_scheduled_transactions( const read_only::get_scheduled_transactio
    return result;
 }
 
-fc::variant read_only::get_block(const read_only::get_block_params& params) const {
+signed_block_ptr read_only::find_block(const read_only::get_block_params& params) const {
    signed_block_ptr block;
    EOS_ASSERT(!params.block_num_or_id.empty() && params.block_num_or_id.size() <= 64, chain::block_id_type_exception, "Invalid Block number or ID, must be greater than 0 and less than 64 characters" );
    try {
@@ -1498,6 +1603,11 @@ fc::variant read_only::get_block(const read_only::get_block_params& params) cons
    } EOS_RETHROW_EXCEPTIONS(chain::block_id_type_exception, "Invalid block ID: ${block_num_or_id}", ("block_num_or_id", params.block_num_or_id))
 
    EOS_ASSERT( block, unknown_block_exception, "Could not find block: ${block}", ("block", params.block_num_or_id));
+   return block;
+}
+
+fc::variant read_only::get_block(const read_only::get_block_params& params) const {
+   signed_block_ptr block = find_block(params);
 
    fc::variant pretty_output;
    abi_serializer::to_variant(*block, pretty_output, make_resolver(this, abi_serializer_max_time), abi_serializer_max_time);
@@ -1510,6 +1620,57 @@ fc::variant read_only::get_block(const read_only::get_block_params& params) cons
            ("ref_block_prefix", ref_block_prefix);
 }
 
+read_only::get_block_unserialized_result read_only::get_block_unserialized(const read_only::get_block_params& params) const {
+   read_only::get_block_unserialized_result result;
+   result.block = find_block(params);
+   result.abi_serializer_max_time = abi_serializer_max_time;
+
+   // the abis are looked up in the chain state, so every account the actions may need is resolved here
+   auto resolver = make_resolver(this, abi_serializer_max_time);
+   auto add_abis = [&]( const vector<action>& actions ) {
+      for( const auto& act : actions ) {
+         if( result.abis.count( act.account ) )
+            continue;
+         try {
+            result.abis.emplace( act.account, resolver( act.account ) );
+         } catch( ... ) {
+            // an abi that fails to load leaves the data unserialized, as in get_block
+            result.abis.emplace( act.account, nullptr );
+         }
+      }
+   };
+   for( const auto& receipt : result.block->transactions ) {
+      if( receipt.trx.contains<packed_transaction>() ) {
+         const auto& trx = receipt.trx.get<packed_transaction>().get_unpacked_transaction();
+         add_abis( trx.context_free_actions );
+         add_abis( trx.actions );
+      }
+   }
+   return result;
+}
+
+string read_only::get_block_unserialized_result::to_json()const {
+   auto resolver = [this]( const account_name& name ) -> std::shared_ptr<const abi_serializer> {
+      auto itr = abis.find( name );
+      return itr == abis.end() ? nullptr : itr->second;
+   };
+
+   string out;
+   abi_serializer::to_json( *block, out, resolver, abi_serializer_max_time );
+   uint32_t ref_block_prefix = block->id()._hash[1];
+
+   // the block is an object with members, the extra fields go before its closing brace
+   out.pop_back();
+   out += ",\"id\":";
+   out += fc::json::to_string( fc::variant( block->id() ) );
+   out += ",\"block_num\":";
+   out += fc::json::to_string( fc::variant( block->block_num() ) );
+   out += ",\"ref_block_prefix\":";
+   out += fc::json::to_string( fc::variant( ref_block_prefix ) );
+   out += '}';
+   return out;
+}
+
 fc::variant read_only::get_block_header_state(const get_block_header_state_params& params) const {
    block_state_ptr b;
    optional<uint64_t> block_num;
@@ -1727,11 +1888,8 @@ read_only::get_account_results read_only::get_account( const get_account_params&
       ++perm;
    }
 
-   const auto& code_account = db.db().get<account_object,by_name>( config::system_account_name );
-
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( auto cached = db.get_cached_abi( config::system_account_name, abi_serializer_max_time ) ) {
+      const abi_serializer& abis = cached->serializer;
 
       const auto token_code = N(eosio.token);
 
@@ -1810,41 +1968,70 @@ static variant action_abi_to_variant( const abi_def& abi, type_name action_type
    return v;
 };
 
-read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::abi_json_to_bin_params& params )const try {
-   abi_json_to_bin_result result;
+read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::abi_json_to_bin_params& params )const {
+   return abi_json_to_bin_unserialized( params ).convert();
+}
+
+read_only::abi_json_to_bin_unserialized_result read_only::abi_json_to_bin_unserialized( const read_only::abi_json_to_bin_params& params )const try {
+   abi_json_to_bin_unserialized_result result;
    const auto code_account = db.db().find<account_object,by_name>( params.code );
    EOS_ASSERT(code_account != nullptr, contract_query_exception, "Contract can't be found ${contract}", ("contract", params.code));
 
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account->abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
-      auto action_type = abis.get_action_type(params.action);
-      EOS_ASSERT(!action_type.empty(), action_validate_exception, "Unknown action ${action} in contract ${contract}", ("action", params.action)("contract", params.code));
-      try {
-         result.binargs = abis.variant_to_binary( action_type, params.args, abi_serializer_max_time, shorten_abi_errors );
-      } EOS_RETHROW_EXCEPTIONS(chain::invalid_action_args_exception,
-                                "'${args}' is invalid args for action '${action}' code '${code}'. expected '${proto}'",
-                                ("args", params.args)("action", params.action)("code", params.code)("proto", action_abi_to_variant(abi, action_type)))
-   } else {
-      EOS_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
-   }
+   result.abi = db.get_cached_abi( params.code, abi_serializer_max_time );
+   EOS_ASSERT(result.abi, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
+   result.params = params;
+   result.abi_serializer_max_time = abi_serializer_max_time;
+   result.shorten_abi_errors = shorten_abi_errors;
+   return result;
+} FC_RETHROW_EXCEPTIONS( warn, "code: ${code}, action: ${action}, args: ${args}",
+                         ("code", params.code)( "action", params.action )( "args", params.args ))
+
+read_only::abi_json_to_bin_result read_only::abi_json_to_bin_unserialized_result::convert()const try {
+   abi_json_to_bin_result result;
+   const abi_serializer& abis = abi->serializer;
+   auto action_type = abis.get_action_type(params.action);
+   EOS_ASSERT(!action_type.empty(), action_validate_exception, "Unknown action ${action} in contract ${contract}", ("action", params.action)("contract", params.code));
+   try {
+      result.binargs = abis.variant_to_binary( action_type, params.args, abi_serializer_max_time, shorten_abi_errors );
+   } EOS_RETHROW_EXCEPTIONS(chain::invalid_action_args_exception,
+                             "'${args}' is invalid args for action '${action}' code '${code}'. expected '${proto}'",
+                             ("args", params.args)("action", params.action)("code", params.code)("proto", action_abi_to_variant(abi->abi, action_type)))
    return result;
 } FC_RETHROW_EXCEPTIONS( warn, "code: ${code}, action: ${action}, args: ${args}",
                          ("code", params.code)( "action", params.action )( "args", params.args ))
 
+string read_only::abi_json_to_bin_unserialized_result::to_json()const {
+   return fc::json::to_string( convert() );
+}
+
 read_only::abi_bin_to_json_result read_only::abi_bin_to_json( const read_only::abi_bin_to_json_params& params )const {
+   return abi_bin_to_json_unserialized( params ).convert();
+}
+
+read_only::abi_bin_to_json_unserialized_result read_only::abi_bin_to_json_unserialized( const read_only::abi_bin_to_json_params& params )const {
+   abi_bin_to_json_unserialized_result result;
+   const auto code_account = db.db().find<account_object,by_name>( params.code );
+   EOS_ASSERT(code_account != nullptr, contract_query_exception, "Contract can't be found ${contract}", ("contract", params.code));
+
+   result.abi = db.get_cached_abi( params.code, abi_serializer_max_time );
+   EOS_ASSERT(result.abi, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
+   result.params = params;
+   result.abi_serializer_max_time = abi_serializer_max_time;
+   result.shorten_abi_errors = shorten_abi_errors;
+   return result;
+}
+
+read_only::abi_bin_to_json_result read_only::abi_bin_to_json_unserialized_result::convert()const {
    abi_bin_to_json_result result;
-   const auto& code_account = db.db().get<account_object,by_name>( params.code );
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
-      result.args = abis.binary_to_variant( abis.get_action_type( params.action ), params.binargs, abi_serializer_max_time, shorten_abi_errors );
-   } else {
-      EOS_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
-   }
+   const abi_serializer& abis = abi->serializer;
+   result.args = abis.binary_to_variant( abis.get_action_type( params.action ), params.binargs, abi_serializer_max_time, shorten_abi_errors );
    return result;
 }
 
+string read_only::abi_bin_to_json_unserialized_result::to_json()const {
+   return fc::json::to_string( convert() );
+}
+
 read_only::get_required_keys_result read_only::get_required_keys( const get_required_keys_params& params )const {
    transaction pretty_input;
    auto resolver = make_resolver(this, abi_serializer_max_time);
@@ -42,6 +42,9 @@ namespace eosio {
    using chain::action_name;
    using chain::abi_def;
    using chain::abi_serializer;
+   using chain::abi_serializer_cache;
+   using chain::cached_abi;
+   using chain::cached_abi_ptr;
 
 namespace chain_apis {
 struct empty{};
@@ -220,6 +223,23 @@ public:
 
    abi_json_to_bin_result abi_json_to_bin( const abi_json_to_bin_params& params )const;
 
+   /**
+    * The abi an abi_json_to_bin call converts with, read from the chain state by abi_json_to_bin_unserialized. convert
+    * and to_json do the conversion, to_json writes the same text as fc::json::to_string( abi_json_to_bin( params ) ),
+    * and both may run on any thread.
+    */
+   struct abi_json_to_bin_unserialized_result {
+      abi_json_to_bin_params params;
+      cached_abi_ptr         abi;
+      fc::microseconds       abi_serializer_max_time;
+      bool                   shorten_abi_errors = true;
+
+      abi_json_to_bin_result convert()const;
+      string to_json()const;
+   };
+
+   abi_json_to_bin_unserialized_result abi_json_to_bin_unserialized( const abi_json_to_bin_params& params )const;
+
 
    struct abi_bin_to_json_params {
       name         code;
@@ -232,6 +252,19 @@ public:
 
    abi_bin_to_json_result abi_bin_to_json( const abi_bin_to_json_params& params )const;
 
+   /// the abi_bin_to_json counterpart of abi_json_to_bin_unserialized_result
+   struct abi_bin_to_json_unserialized_result {
+      abi_bin_to_json_params params;
+      cached_abi_ptr         abi;
+      fc::microseconds       abi_serializer_max_time;
+      bool                   shorten_abi_errors = true;
+
+      abi_bin_to_json_result convert()const;
+      string to_json()const;
+   };
+
+   abi_bin_to_json_unserialized_result abi_bin_to_json_unserialized( const abi_bin_to_json_params& params )const;
+
 
    struct get_required_keys_params {
       fc::variant transaction;
@@ -254,6 +287,21 @@ public:
 
    fc::variant get_block(const get_block_params& params) const;
 
+   /**
+    * A block with the abis of the accounts of its actions, read from the chain state by get_block_unserialized. to_json
+    * writes the same text as fc::json::to_string( get_block( params ) ) straight from the block, and may run on any
+    * thread.
+    */
+   struct get_block_unserialized_result {
+      chain::signed_block_ptr                                       block;
+      std::map<account_name, std::shared_ptr<const abi_serializer>> abis;
+      fc::microseconds                                              abi_serializer_max_time;
+
+      string to_json()const;
+   };
+
+   get_block_unserialized_result get_block_unserialized(const get_block_params& params) const;
+
    struct get_block_header_state_params {
       string block_num_or_id;
    };
@@ -283,6 +331,26 @@ public:
 
    get_table_rows_result get_table_rows( const get_table_rows_params& params )const;
 
+   /**
+    * The rows of a get_table_rows call copied out of the chain state by get_table_rows_unserialized. to_json writes the
+    * same text as fc::json::to_string( get_table_rows( params ) ) straight from the table data without building an
+    * fc::variant for each row, and may run on any thread.
+    */
+   struct get_table_rows_unserialized_result {
+      cached_abi_ptr                           abi;
+      chain::type_name                         table_type;
+      vector<pair<vector<char>, account_name>> rows; ///< data and payer of each row
+      bool                                     more = false;
+      bool                                     json = false;
+      bool                                     show_payer = false;
+      fc::microseconds                         abi_serializer_max_time;
+      bool                                     shorten_abi_errors = true;
+
+      string to_json()const;
+   };
+
+   get_table_rows_unserialized_result get_table_rows_unserialized( const get_table_rows_params& params )const;
+
    struct get_table_by_scope_params {
       name        code; // mandatory
       name        table = 0; // optional, act as filter
@@ -391,15 +459,20 @@ public:
 
    static uint64_t get_table_index_name(const read_only::get_table_rows_params& p, bool& primary);
 
-   template <typename IndexType, typename SecKeyType, typename ConvFn>
-   read_only::get_table_rows_result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_def& abi, ConvFn conv )const {
-      read_only::get_table_rows_result result;
+   /**
+    * Calls on_row(data, payer) for each row of the secondary index requested by p
+    * @return true if the walk stopped before the end of the requested range
+    */
+   template <typename IndexType, typename SecKeyType, typename ConvFn, typename RowFn>
+   bool walk_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_def& abi, ConvFn conv, RowFn&& on_row )const {
+      bool more = false;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
+      // an account without an abi has no cached serializer, fail as building one for it does
+      EOS_ASSERT( !abi.version.empty(), chain::unsupported_abi_version_exception, "ABI has an unsupported version" );
+
       bool primary = false;
       const uint64_t table_with_index = get_table_index_name(p, primary);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
@@ -439,7 +512,7 @@ public:
          }
 
          if( upper_bound_lookup_tuple < lower_bound_lookup_tuple )
-            return result;
+            return more;
 
          auto walk_table_row_range = [&]( auto itr, auto end_itr ) {
             auto cur_time = fc::time_point::now();
@@ -449,24 +522,12 @@ public:
                const auto* itr2 = d.find<chain::key_value_object, chain::by_scope_primary>( boost::make_tuple(t_id->id, itr->primary_key) );
                if( itr2 == nullptr ) continue;
                copy_inline_row(*itr2, data);
-
-               fc::variant data_var;
-               if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
-               } else {
-                  data_var = fc::variant( data );
-               }
-
-               if( p.show_payer && *p.show_payer ) {
-                  result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", itr->payer) );
-               } else {
-                  result.rows.emplace_back( std::move(data_var) );
-               }
+               on_row( data, itr->payer );
 
                ++count;
             }
             if( itr != end_itr ) {
-               result.more = true;
+               more = true;
             }
          };
 
@@ -478,18 +539,20 @@ public:
             walk_table_row_range( lower, upper );
          }
       }
-      return result;
+      return more;
    }
 
-   template <typename IndexType>
-   read_only::get_table_rows_result get_table_rows_ex( const read_only::get_table_rows_params& p, const abi_def& abi )const {
-      read_only::get_table_rows_result result;
+   /**
+    * Calls on_row(data, payer) for each row of the primary index requested by p
+    * @return true if the walk stopped before the end of the requested range
+    */
+   template <typename IndexType, typename RowFn>
+   bool walk_table_rows_ex( const read_only::get_table_rows_params& p, RowFn&& on_row )const {
+      bool more = false;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
       if( t_id != nullptr ) {
          const auto& idx = d.get_index<IndexType, chain::by_scope_primary>();
@@ -517,7 +580,7 @@ public:
          }
 
          if( upper_bound_lookup_tuple < lower_bound_lookup_tuple  )
-            return result;
+            return more;
 
          auto walk_table_row_range = [&]( auto itr, auto end_itr ) {
             auto cur_time = fc::time_point::now();
@@ -525,22 +588,10 @@ public:
             vector<char> data;
             for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++count, ++itr, cur_time = fc::time_point::now() ) {
                copy_inline_row(*itr, data);
-
-               fc::variant data_var;
-               if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
-               } else {
-                  data_var = fc::variant( data );
-               }
-
-               if( p.show_payer && *p.show_payer ) {
-                  result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", itr->payer) );
-               } else {
-                  result.rows.emplace_back( std::move(data_var) );
-               }
+               on_row( data, itr->payer );
             }
             if( itr != end_itr ) {
-               result.more = true;
+               more = true;
             }
          };
 
@@ -552,11 +603,17 @@ public:
             walk_table_row_range( lower, upper );
          }
       }
-      return result;
+      return more;
    }
 
+   /// dispatches p to the walk of the index it names
+   template <typename RowFn>
+   bool walk_table_rows( const read_only::get_table_rows_params& p, const abi_def& abi, RowFn&& on_row )const;
+
    chain::symbol extract_core_symbol()const;
 
+   chain::signed_block_ptr find_block(const get_block_params& params)const;
+
    friend struct resolver_factory<read_only>;
 };
 
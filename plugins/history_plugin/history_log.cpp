@@ -0,0 +1,513 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/history_plugin/history_log.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/log/logger.hpp>
+
+#include <boost/interprocess/file_mapping.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace eosio {
+   namespace bip = boost::interprocess;
+
+   namespace {
+      const uint32_t account_heads_record_size = 20;   ///< packed account, last entry and count
+      const uint32_t account_heads_header_size = 16;   ///< packed account and transaction entries covered
+
+      template<uint32_t Size, typename T>
+      void write_record( std::ostream& out, const T& v ) {
+         char buf[Size];
+         fc::datastream<char*> ds( buf, Size );
+         fc::raw::pack( ds, v );
+         out.write( buf, Size );
+      }
+
+      template<typename T>
+      T read_record( const char* data, uint32_t size ) {
+         fc::datastream<const char*> ds( data, size );
+         T v;
+         fc::raw::unpack( ds, v );
+         return v;
+      }
+
+      std::vector<char> read_file( const boost::filesystem::path& file ) {
+         std::ifstream f( file.generic_string(), std::ios_base::binary );
+         return std::vector<char>( (std::istreambuf_iterator<char>( f )), std::istreambuf_iterator<char>() );
+      }
+   }
+
+   history_log::history_log( const boost::filesystem::path& dir, uint32_t checkpoint_interval )
+   :log_file( dir / "history_action.log" )
+   ,account_index_file( dir / "history_account.index" )
+   ,trx_index_file( dir / "history_trx.index" )
+   ,buckets_file( dir / "history_trx.buckets" )
+   ,account_heads_file( dir / "history_account.heads" )
+   ,head_file( dir / "history.head" )
+   ,checkpoint_interval( std::max<uint32_t>( checkpoint_interval, 1 ) )
+   {
+      if( boost::filesystem::exists( head_file ) ) {
+         try {
+            head = fc::raw::unpack<history_log_head>( read_file( head_file ) );
+         } FC_RETHROW_EXCEPTIONS( error, "corrupt ${f}", ("f", head_file.generic_string()) )
+         EOS_ASSERT( head.version == history_log_version, chain::plugin_exception,
+                     "${f} has unsupported version ${v}, remove the history with --delete-history",
+                     ("f", head_file.generic_string())("v", head.version) );
+      }
+      bool clean = head.clean;
+
+      open_file( log_stream, log_file, head.log_size );
+      open_file( account_index_stream, account_index_file, head.account_entries * history_account_entry_size );
+      open_file( trx_index_stream, trx_index_file, head.trx_entries * history_trx_entry_size );
+
+      const uint64_t buckets_size = sizeof(uint64_t) << history_trx_bucket_bits;
+      bool checkpoint = true;
+      if( !boost::filesystem::exists( buckets_file ) || boost::filesystem::file_size( buckets_file ) != buckets_size ) {
+         std::ofstream( buckets_file.generic_string(), std::ios_base::binary | std::ios_base::trunc );
+         boost::filesystem::resize_file( buckets_file, buckets_size );
+         clean = false;
+         checkpoint = false;
+      }
+      bip::file_mapping mapping( buckets_file.generic_string().c_str(), bip::read_write );
+      buckets_region = std::make_unique<bip::mapped_region>( mapping, bip::read_write );
+
+      uint64_t account_from = 0;
+      uint64_t trx_from = 0;
+      if( !checkpoint || !load_account_heads( clean, account_from, trx_from ) ) {
+         account_from = 0;
+         trx_from = 0;
+         clean = false;
+      }
+      if( !clean )
+         rebuild_heads( account_from, trx_from );
+
+      if( head.trx_entries )
+         last_trx_id = get_trx_entry( head.trx_entries - 1 ).trx_id;
+
+      // until close, a crash leaves the buckets and account heads behind the entries
+      head.clean = false;
+      write_head();
+      if( !clean )
+         write_checkpoint();
+      checkpoint_block_num = head.block_num;
+      is_open = true;
+
+      ilog( "history log has ${a} actions of ${n} accounts up to block ${b}",
+            ("a", head.account_entries)("n", account_heads.size())("b", head.block_num) );
+   }
+
+   history_log::~history_log() {
+      try {
+         close();
+      } FC_LOG_AND_DROP()
+   }
+
+   void history_log::close() {
+      if( !is_open )
+         return;
+      is_open = false;
+      log_stream.close();
+      account_index_stream.close();
+      trx_index_stream.close();
+      // a block which failed to be written leaves pending entries, the next open rebuilds without them
+      if( pending_account_entries.empty() && !pending_trx_entries ) {
+         write_checkpoint();
+         head.clean = true;
+         write_head();
+      }
+      buckets_region.reset();
+   }
+
+   void history_log::append_block( const history_block& block ) {
+      EOS_ASSERT( is_open && log_stream.good() && account_index_stream.good() && trx_index_stream.good(),
+                  chain::plugin_exception, "history log is not writable" );
+      EOS_ASSERT( block.block_num > head.block_num, chain::plugin_exception,
+                  "block ${b} is not after the head of the history log, ${h}", ("b", block.block_num)("h", head.block_num) );
+
+      uint64_t pos = head.log_size;
+      for( const auto& a : block.actions ) {
+         history_action_header header;
+         header.action_sequence_num = a.action_sequence_num;
+         header.trx_id              = a.trx_id;
+         header.block_num           = block.block_num;
+         header.block_time          = block.block_time;
+         header.payload_size        = a.packed_action_trace.size();
+         write_record<history_action_header_size>( log_stream, header );
+         log_stream.write( a.packed_action_trace.data(), a.packed_action_trace.size() );
+
+         for( const auto& account : a.accounts )
+            append_account_entry( account, pos );
+         if( head.trx_entries + pending_trx_entries == 0 || a.trx_id != last_trx_id )
+            append_trx_entry( a.trx_id, pos );
+
+         pos = next_action_pos( pos, header );
+      }
+
+      log_stream.flush();
+      account_index_stream.flush();
+      trx_index_stream.flush();
+      EOS_ASSERT( log_stream.good() && account_index_stream.good() && trx_index_stream.good(), chain::plugin_exception,
+                  "failed to write block ${b} to the history log", ("b", block.block_num) );
+
+      head.block_num        = block.block_num;
+      head.block_id         = block.block_id;
+      head.log_size         = pos;
+      head.account_entries += pending_account_entries.size();
+      head.trx_entries     += pending_trx_entries;
+      pending_account_entries.clear();
+      pending_trx_entries = 0;
+      write_head();
+
+      // the buckets never point at an entry of a block which is not in the head
+      auto* buckets = static_cast<uint64_t*>( buckets_region->get_address() );
+      for( const auto& b : pending_buckets )
+         buckets[b.first] = b.second;
+      pending_buckets.clear();
+
+      if( head.block_num - checkpoint_block_num >= checkpoint_interval ) {
+         write_checkpoint();
+         checkpoint_block_num = head.block_num;
+      }
+   }
+
+   int32_t history_log::account_action_count( const chain::account_name& account )const {
+      auto itr = account_heads.find( account );
+      return itr == account_heads.end() ? 0 : itr->second.count;
+   }
+
+   std::vector<uint64_t> history_log::account_action_positions( const chain::account_name& account, int32_t first, int32_t last )const {
+      std::vector<uint64_t> result;
+      auto itr = account_heads.find( account );
+      if( itr == account_heads.end() )
+         return result;
+      first = std::max( first, 0 );
+      last = std::min( last, itr->second.count - 1 );
+      if( first > last )
+         return result;
+
+      auto entry = get_account_entry( itr->second.last );
+      while( entry.account_sequence_num > last ) {
+         if( entry.jump != entry.prev ) {
+            auto j = get_account_entry( entry.jump );
+            if( j.account_sequence_num >= last ) {
+               entry = j;
+               continue;
+            }
+         }
+         entry = get_account_entry( entry.prev );
+      }
+
+      result.reserve( last - first + 1 );
+      while( true ) {
+         result.push_back( entry.action_pos );
+         if( entry.account_sequence_num == first )
+            break;
+         entry = get_account_entry( entry.prev );
+      }
+      std::reverse( result.begin(), result.end() );
+      return result;
+   }
+
+   history_action_header history_log::read_header( uint64_t pos )const {
+      EOS_ASSERT( pos + history_action_header_size <= head.log_size, chain::plugin_exception,
+                  "read past the end of the history log" );
+      const char* base = map_file( log_region, log_file, pos + history_action_header_size );
+      return read_record<history_action_header>( base + pos, history_action_header_size );
+   }
+
+   chain::action_trace history_log::read_action_trace( uint64_t pos, const history_action_header& header )const {
+      const uint64_t end = next_action_pos( pos, header );
+      EOS_ASSERT( end <= head.log_size, chain::plugin_exception, "read past the end of the history log" );
+      const char* base = map_file( log_region, log_file, end );
+      fc::datastream<const char*> ds( base + pos + history_action_header_size, header.payload_size );
+      chain::action_trace trace;
+      fc::raw::unpack( ds, trace );
+      return trace;
+   }
+
+   uint64_t history_log::bucket_head( uint32_t bucket )const {
+      const uint64_t b = static_cast<const uint64_t*>( buckets_region->get_address() )[bucket];
+      return b ? b - 1 : history_no_entry;
+   }
+
+   history_account_entry history_log::get_account_entry( uint64_t i )const {
+      if( i >= head.account_entries ) {
+         EOS_ASSERT( i - head.account_entries < pending_account_entries.size(), chain::plugin_exception,
+                     "history account entry ${i} does not exist", ("i", i) );
+         return pending_account_entries[i - head.account_entries];
+      }
+      const char* base = map_file( account_index_region, account_index_file, (i + 1) * history_account_entry_size );
+      return read_record<history_account_entry>( base + i * history_account_entry_size, history_account_entry_size );
+   }
+
+   history_trx_entry history_log::get_trx_entry( uint64_t i )const {
+      EOS_ASSERT( i < head.trx_entries, chain::plugin_exception, "history transaction entry ${i} does not exist", ("i", i) );
+      const char* base = map_file( trx_index_region, trx_index_file, (i + 1) * history_trx_entry_size );
+      return read_record<history_trx_entry>( base + i * history_trx_entry_size, history_trx_entry_size );
+   }
+
+   /**
+    * The files are only appended to, so a mapping is reused until a read goes past its end, at which point the
+    * whole file is mapped again.
+    */
+   const char* history_log::map_file( std::unique_ptr<bip::mapped_region>& region,
+                                      const boost::filesystem::path& file, uint64_t min_size )const {
+      if( !region || region->get_size() < min_size ) {
+         region.reset();
+         const uint64_t size = boost::filesystem::file_size( file );
+         EOS_ASSERT( size >= min_size, chain::plugin_exception, "read past the end of ${f}", ("f", file.generic_string()) );
+         bip::file_mapping mapping( file.generic_string().c_str(), bip::read_only );
+         region = std::make_unique<bip::mapped_region>( mapping, bip::read_only, 0, size );
+      }
+      return static_cast<const char*>( region->get_address() );
+   }
+
+   void history_log::append_account_entry( const chain::account_name& account, uint64_t action_pos ) {
+      auto& ah = account_heads[account];
+      history_account_entry entry;
+      entry.account              = account;
+      entry.account_sequence_num = ah.count;
+      entry.action_pos           = action_pos;
+      entry.prev                 = ah.last;
+      entry.jump                 = ah.last;
+      if( ah.last != history_no_entry ) {
+         // skew binary jumps: when the jump of prev spans as many entries as the jump after it, jump over both
+         const auto p = get_account_entry( ah.last );
+         if( p.jump != history_no_entry ) {
+            const auto j = get_account_entry( p.jump );
+            if( j.jump != history_no_entry &&
+                p.account_sequence_num - j.account_sequence_num == j.account_sequence_num - get_account_entry( j.jump ).account_sequence_num )
+               entry.jump = j.jump;
+         }
+      }
+      write_record<history_account_entry_size>( account_index_stream, entry );
+      ah.last = head.account_entries + pending_account_entries.size();
+      ++ah.count;
+      pending_account_entries.push_back( entry );
+   }
+
+   void history_log::append_trx_entry( const chain::transaction_id_type& trx_id, uint64_t action_pos ) {
+      const uint32_t bucket = trx_bucket( trx_id );
+      history_trx_entry entry;
+      entry.trx_id     = trx_id;
+      entry.action_pos = action_pos;
+      auto itr = pending_buckets.find( bucket );
+      entry.prev       = itr == pending_buckets.end() ? bucket_head( bucket ) : itr->second - 1;
+      write_record<history_trx_entry_size>( trx_index_stream, entry );
+      pending_buckets[bucket] = head.trx_entries + pending_trx_entries + 1;
+      ++pending_trx_entries;
+      last_trx_id = trx_id;
+   }
+
+   void history_log::open_file( std::fstream& stream, const boost::filesystem::path& file, uint64_t committed_size ) {
+      if( !boost::filesystem::exists( file ) )
+         std::ofstream( file.generic_string(), std::ios_base::binary );
+      const uint64_t size = boost::filesystem::file_size( file );
+      EOS_ASSERT( size >= committed_size, chain::plugin_exception, "${f} is shorter than recorded in ${h}",
+                  ("f", file.generic_string())("h", head_file.generic_string()) );
+      if( size > committed_size ) {
+         wlog( "removing ${n} incompletely written bytes from ${f}", ("n", size - committed_size)("f", file.generic_string()) );
+         boost::filesystem::resize_file( file, committed_size );
+      }
+      stream.open( file.generic_string(), std::ios_base::binary | std::ios_base::out | std::ios_base::app );
+      EOS_ASSERT( stream.good(), chain::plugin_exception, "unable to open ${f}", ("f", file.generic_string()) );
+   }
+
+   /**
+    * Brings the account heads and buckets from the checkpoint covering the first account_from account entries and
+    * trx_from transaction entries up to the head. Without a checkpoint both start empty and every entry is replayed.
+    */
+   void history_log::rebuild_heads( uint64_t account_from, uint64_t trx_from ) {
+      auto* buckets = static_cast<uint64_t*>( buckets_region->get_address() );
+      if( !account_from && !trx_from ) {
+         ilog( "rebuilding history account heads and transaction buckets" );
+         account_heads.clear();
+         memset( buckets, 0, buckets_region->get_size() );
+      } else {
+         ilog( "replaying ${a} account and ${t} transaction entries written after the history checkpoint",
+               ("a", head.account_entries - account_from)("t", head.trx_entries - trx_from) );
+      }
+      for( uint64_t i = account_from; i < head.account_entries; ++i ) {
+         const auto entry = get_account_entry( i );
+         auto& ah = account_heads[entry.account];
+         ah.last  = i;
+         ah.count = entry.account_sequence_num + 1;
+      }
+      for( uint64_t i = trx_from; i < head.trx_entries; ++i )
+         buckets[trx_bucket( get_trx_entry( i ).trx_id )] = i + 1;
+   }
+
+   /**
+    * Loads the checkpoint into account_heads and returns the entries it covers. After a clean close it must cover
+    * every entry. The heads file of a previous release has no header and is only used after a clean close.
+    */
+   bool history_log::load_account_heads( bool clean, uint64_t& account_entries, uint64_t& trx_entries ) {
+      if( !boost::filesystem::exists( account_heads_file ) )
+         return false;
+      const auto data = read_file( account_heads_file );
+      fc::datastream<const char*> ds( data.data(), data.size() );
+      if( data.size() % account_heads_record_size == 0 ) {
+         if( !clean )
+            return false;
+         account_entries = head.account_entries;
+         trx_entries     = head.trx_entries;
+      } else if( data.size() >= account_heads_header_size &&
+                 (data.size() - account_heads_header_size) % account_heads_record_size == 0 ) {
+         fc::raw::unpack( ds, account_entries );
+         fc::raw::unpack( ds, trx_entries );
+         if( account_entries > head.account_entries || trx_entries > head.trx_entries )
+            return false;
+         if( clean && (account_entries != head.account_entries || trx_entries != head.trx_entries) )
+            return false;
+      } else {
+         return false;
+      }
+      account_heads.clear();
+      while( ds.remaining() ) {
+         chain::account_name account;
+         account_head ah;
+         fc::raw::unpack( ds, account );
+         fc::raw::unpack( ds, ah.last );
+         fc::raw::unpack( ds, ah.count );
+         if( ah.last >= account_entries )
+            return false;
+         account_heads[account] = ah;
+      }
+      return true;
+   }
+
+   /**
+    * Flushes the buckets, then replaces the account heads file with the heads of every entry in the head, so that
+    * after a crash only the entries written since are replayed.
+    */
+   void history_log::write_checkpoint() {
+      buckets_region->flush();
+      auto tmp = account_heads_file;
+      tmp += ".tmp";
+      {
+         std::ofstream f( tmp.generic_string(), std::ios_base::binary | std::ios_base::trunc );
+         char header[account_heads_header_size];
+         fc::datastream<char*> hds( header, sizeof(header) );
+         fc::raw::pack( hds, head.account_entries );
+         fc::raw::pack( hds, head.trx_entries );
+         f.write( header, sizeof(header) );
+         for( const auto& ah : account_heads ) {
+            char buf[account_heads_record_size];
+            fc::datastream<char*> ds( buf, sizeof(buf) );
+            fc::raw::pack( ds, ah.first );
+            fc::raw::pack( ds, ah.second.last );
+            fc::raw::pack( ds, ah.second.count );
+            f.write( buf, sizeof(buf) );
+         }
+         f.flush();
+         EOS_ASSERT( f.good(), chain::plugin_exception, "failed to write ${f}", ("f", tmp.generic_string()) );
+      }
+      boost::filesystem::rename( tmp, account_heads_file );
+   }
+
+   void history_log::write_head() {
+      auto tmp = head_file;
+      tmp += ".tmp";
+      {
+         const auto data = fc::raw::pack( head );
+         std::ofstream f( tmp.generic_string(), std::ios_base::binary | std::ios_base::trunc );
+         f.write( data.data(), data.size() );
+         f.flush();
+         EOS_ASSERT( f.good(), chain::plugin_exception, "failed to write ${f}", ("f", tmp.generic_string()) );
+      }
+      boost::filesystem::rename( tmp, head_file );
+   }
+
+   void history_reversible_blocks::add_block( history_block&& block ) {
+      const uint32_t block_num = block.block_num;
+      const bool fork = !blocks.empty() && block_num <= blocks.rbegin()->first;
+      if( fork )
+         blocks.erase( blocks.lower_bound( block_num ), blocks.end() );
+      const auto& b = blocks.emplace( block_num, std::move(block) ).first->second;
+      if( fork )
+         index_blocks();
+      else
+         index_block( b );
+   }
+
+   void history_reversible_blocks::remove_through( uint32_t block_num ) {
+      // the oldest block is at the front of each account's actions, so removing blocks in order is incremental
+      while( !blocks.empty() && blocks.begin()->first <= block_num )
+         remove_front();
+   }
+
+   void history_reversible_blocks::index_block( const history_block& b ) {
+      for( size_t i = 0; i < b.actions.size(); ++i ) {
+         const auto& a = b.actions[i];
+         for( const auto& account : a.accounts ) {
+            by_account[account].emplace_back( &b, &a );
+         }
+         if( i == 0 || a.trx_id != b.actions[i-1].trx_id )
+            by_trx.emplace( a.trx_id, std::make_pair( &b, i ) );
+      }
+   }
+
+   void history_reversible_blocks::index_blocks() {
+      by_account.clear();
+      by_trx.clear();
+      for( const auto& b : blocks ) {
+         index_block( b.second );
+      }
+   }
+
+   void history_reversible_blocks::remove_front() {
+      const auto& b = blocks.begin()->second;
+      for( size_t i = 0; i < b.actions.size(); ++i ) {
+         const auto& a = b.actions[i];
+         for( const auto& account : a.accounts ) {
+            auto itr = by_account.find( account );
+            itr->second.pop_front();
+            if( itr->second.empty() )
+               by_account.erase( itr );
+         }
+         auto range = by_trx.equal_range( a.trx_id );
+         for( auto itr = range.first; itr != range.second; ++itr ) {
+            if( itr->second.first == &b && itr->second.second == i ) {
+               by_trx.erase( itr );
+               break;
+            }
+         }
+      }
+      blocks.erase( blocks.begin() );
+   }
+
+   void history_reversible_blocks::load( const boost::filesystem::path& file, uint32_t after_block_num ) {
+      if( !boost::filesystem::exists( file ) )
+         return;
+      const auto data = read_file( file );
+      boost::filesystem::remove( file );
+      try {
+         auto loaded = fc::raw::unpack<std::vector<history_block>>( data );
+         for( auto& b : loaded ) {
+            if( b.block_num > after_block_num )
+               blocks.emplace( b.block_num, std::move(b) );
+         }
+      } FC_LOG_AND_DROP()
+      index_blocks();
+   }
+
+   void history_reversible_blocks::write( const boost::filesystem::path& file ) {
+      std::vector<history_block> written;
+      written.reserve( blocks.size() );
+      for( auto& b : blocks ) {
+         written.emplace_back( std::move(b.second) );
+      }
+      blocks.clear();
+      by_account.clear();
+      by_trx.clear();
+      const auto data = fc::raw::pack( written );
+      std::ofstream f( file.generic_string(), std::ios_base::binary | std::ios_base::trunc );
+      f.write( data.data(), data.size() );
+   }
+
+} // namespace eosio
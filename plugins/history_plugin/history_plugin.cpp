@@ -1,4 +1,5 @@
 #include <eosio/history_plugin/history_plugin.hpp>
+#include <eosio/history_plugin/history_log.hpp>
 #include <eosio/history_plugin/account_control_history_object.hpp>
 #include <eosio/history_plugin/public_key_history_object.hpp>
 #include <eosio/chain/controller.hpp>
@@ -16,70 +17,6 @@ namespace eosio {
 
    static appbase::abstract_plugin& _history_plugin = app().register_plugin<history_plugin>(); // 注册插件
 
-
-   struct account_history_object : public chainbase::object<account_history_object_type, account_history_object>  {
-      OBJECT_CTOR( account_history_object );
-
-      id_type      id;
-      account_name account; ///< the name of the account which has this action in its history
-      uint64_t     action_sequence_num = 0; ///< the sequence number of the relevant action (global)
-      int32_t      account_sequence_num = 0; ///< the sequence number for this account (per-account)
-   };
-
-   struct action_history_object : public chainbase::object<action_history_object_type, action_history_object> {
-
-      OBJECT_CTOR( action_history_object, (packed_action_trace) );
-
-      id_type      id;
-      uint64_t     action_sequence_num; ///< the sequence number of the relevant action
-
-      shared_string        packed_action_trace;
-      uint32_t             block_num;
-      block_timestamp_type block_time;
-      transaction_id_type  trx_id;
-   };
-   using account_history_id_type = account_history_object::id_type;
-   using action_history_id_type  = action_history_object::id_type;
-
-
-   struct by_action_sequence_num;
-   struct by_account_action_seq;
-   struct by_trx_id;
-
-   using action_history_index = chainbase::shared_multi_index_container<
-      action_history_object,
-      indexed_by<
-         ordered_unique<tag<by_id>, member<action_history_object, action_history_object::id_type, &action_history_object::id>>,
-         ordered_unique<tag<by_action_sequence_num>, member<action_history_object, uint64_t, &action_history_object::action_sequence_num>>,
-         ordered_unique<tag<by_trx_id>,
-            composite_key< action_history_object,
-               member<action_history_object, transaction_id_type, &action_history_object::trx_id>,
-               member<action_history_object, uint64_t, &action_history_object::action_sequence_num >
-            >
-         >
-      >
-   >;
-
-   using account_history_index = chainbase::shared_multi_index_container<
-      account_history_object,
-      indexed_by<
-         ordered_unique<tag<by_id>, member<account_history_object, account_history_object::id_type, &account_history_object::id>>,
-         ordered_unique<tag<by_account_action_seq>,
-            composite_key< account_history_object,
-               member<account_history_object, account_name, &account_history_object::account >,
-               member<account_history_object, int32_t, &account_history_object::account_sequence_num >
-            >
-         >
-      >
-   >;
-
-} /// namespace eosio
-
-CHAINBASE_SET_INDEX_TYPE(eosio::account_history_object, eosio::account_history_index)
-CHAINBASE_SET_INDEX_TYPE(eosio::action_history_object, eosio::action_history_index)
-
-namespace eosio {
-
    template<typename MultiIndex, typename LookupType>
    static void remove(chainbase::database& db, const account_name& account_name, const permission_name& permission)
    {
@@ -142,8 +79,21 @@ namespace eosio {
          std::set<filter_entry> filter_out;
          chain_plugin*          chain_plug = nullptr;
          fc::optional<scoped_connection> applied_transaction_connection;
+         fc::optional<scoped_connection> accepted_block_connection;
+         fc::optional<scoped_connection> irreversible_block_connection;
+
+         boost::filesystem::path              history_dir;
+         fc::optional<history_log>            actions_log;   ///< actions of the irreversible blocks
+
+         /// traces of the transactions applied since the last accepted block, the ones in the block are recorded
+         std::map<transaction_id_type, transaction_trace_ptr> cached_traces;
+         transaction_trace_ptr                                onblock_trace;
+
+         /// actions of the accepted blocks not yet irreversible, in account sequence order after the ones in actions_log
+         history_reversible_blocks                            reversible_blocks;
+         bool                                                 missing_history = false;
 
-          bool filter(const action_trace& act) {
+          bool filter(const action_trace& act)const {
             bool pass_on = false;
             if (bypass_filter) {
               pass_on = true;
@@ -183,7 +133,7 @@ namespace eosio {
             return true;
           }
 
-         set<account_name> account_set( const action_trace& act ) {
+         set<account_name> account_set( const action_trace& act )const {
             set<account_name> result;
 
             result.insert( act.receipt.receiver );
@@ -204,27 +154,6 @@ namespace eosio {
             return result;
          }
 
-         void record_account_action( account_name n, const base_action_trace& act ) {
-            auto& chain = chain_plug->chain();
-            chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
-
-            const auto& idx = db.get_index<account_history_index, by_account_action_seq>();
-            auto itr = idx.lower_bound( boost::make_tuple( name(n.value+1), 0 ) );
-
-            uint64_t asn = 0;
-            if( itr != idx.begin() ) --itr;
-            if( itr->account == n )
-               asn = itr->account_sequence_num + 1;
-
-            //idump((n)(act.receipt.global_sequence)(asn));
-            const auto& a = db.create<account_history_object>( [&]( auto& aho ) {
-              aho.account = n;
-              aho.action_sequence_num = act.receipt.global_sequence;
-              aho.account_sequence_num = asn;
-            });
-            //idump((a.account)(a.action_sequence_num)(a.action_sequence_num));
-         }
-
          void on_system_action( const action_trace& at ) {
             auto& chain = chain_plug->chain();
             chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
@@ -252,43 +181,135 @@ namespace eosio {
             }
          }
 
-         void on_action_trace( const action_trace& at ) {
-            if( filter( at ) ) {
-               //idump((fc::json::to_pretty_string(at)));
-               auto& chain = chain_plug->chain();
-               chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
-
-               db.create<action_history_object>( [&]( auto& aho ) {
-                  auto ps = fc::raw::pack_size( at );
-                  aho.packed_action_trace.resize(ps);
-                  datastream<char*> ds( aho.packed_action_trace.data(), ps );
-                  fc::raw::pack( ds, at );
-                  aho.action_sequence_num = at.receipt.global_sequence;
-                  aho.block_num = chain.pending_block_state()->block_num;
-                  aho.block_time = chain.pending_block_time();
-                  aho.trx_id     = at.trx_id;
-               });
-
-               auto aset = account_set( at );
-               for( auto a : aset ) {
-                  record_account_action( a, at );
-               }
-            }
+         void on_system_actions( const action_trace& at ) {
             if( at.receipt.receiver == chain::config::system_account_name )
                on_system_action( at );
             for( const auto& iline : at.inline_traces ) {
-               on_action_trace( iline );
+               on_system_actions( iline );
             }
          }
 
+         static bool is_onblock( const transaction_trace_ptr& p ) {
+            if( p->action_traces.size() != 1 )
+               return false;
+            const auto& act = p->action_traces[0].act;
+            if( act.account != chain::config::system_account_name || act.name != N(onblock) || act.authorization.size() != 1 )
+               return false;
+            const auto& auth = act.authorization[0];
+            return auth.actor == chain::config::system_account_name && auth.permission == chain::config::active_name;
+         }
+
          void on_applied_transaction( const transaction_trace_ptr& trace ) {
             if( !trace->receipt || (trace->receipt->status != transaction_receipt_header::executed &&
                   trace->receipt->status != transaction_receipt_header::soft_fail) )
                return;
+            if( is_onblock( trace ) )
+               onblock_trace = trace;
+            else if( trace->failed_dtrx_trace )
+               cached_traces[trace->failed_dtrx_trace->id] = trace;
+            else
+               cached_traces[trace->id] = trace;
             for( const auto& atrace : trace->action_traces ) {
-               on_action_trace( atrace );
+               on_system_actions( atrace );
             }
          }
+
+         void record_actions( history_block& block, const action_trace& at ) {
+            if( filter( at ) ) {
+               //idump((fc::json::to_pretty_string(at)));
+               history_action a;
+               a.action_sequence_num = at.receipt.global_sequence;
+               a.trx_id              = at.trx_id;
+               auto aset = account_set( at );
+               a.accounts.assign( aset.begin(), aset.end() );
+               a.packed_action_trace = fc::raw::pack( at );
+               block.actions.emplace_back( std::move(a) );
+            }
+            for( const auto& iline : at.inline_traces ) {
+               record_actions( block, iline );
+            }
+         }
+
+         /// calls f with the top level action traces of the transactions of bsp, in the order they were applied
+         template<typename F>
+         void for_each_block_trace( const block_state_ptr& bsp, F&& f )const {
+            auto for_each_trace = [&]( const transaction_trace_ptr& trace ) {
+               for( const auto& atrace : trace->action_traces ) {
+                  f( atrace );
+               }
+            };
+            if( onblock_trace )
+               for_each_trace( onblock_trace );
+            for( const auto& r : bsp->block->transactions ) {
+               transaction_id_type id;
+               if( r.trx.contains<transaction_id_type>() )
+                  id = r.trx.get<transaction_id_type>();
+               else
+                  id = r.trx.get<packed_transaction>().id();
+               auto itr = cached_traces.find( id );
+               if( itr != cached_traces.end() )
+                  for_each_trace( itr->second );
+            }
+         }
+
+         /// the recorded actions of account in the pending block, which is neither accepted nor undone yet
+         void pending_account_actions( const account_name& account, vector<const action_trace*>& result, const action_trace& at )const {
+            if( filter( at ) && account_set( at ).count( account ) )
+               result.push_back( &at );
+            for( const auto& iline : at.inline_traces ) {
+               pending_account_actions( account, result, iline );
+            }
+         }
+
+         vector<const action_trace*> pending_account_actions( const account_name& account, const block_state_ptr& pending )const {
+            vector<const action_trace*> result;
+            if( !pending || pending->block_num <= reversible_blocks.last_block_num() )
+               return result;
+            for_each_block_trace( pending, [&]( const action_trace& at ) {
+               pending_account_actions( account, result, at );
+            } );
+            return result;
+         }
+
+         void on_accepted_block( const block_state_ptr& bsp ) {
+            history_block block;
+            block.block_num  = bsp->block_num;
+            block.block_id   = bsp->id;
+            block.block_time = bsp->header.timestamp;
+
+            for_each_block_trace( bsp, [&]( const action_trace& at ) {
+               record_actions( block, at );
+            } );
+            cached_traces.clear();
+            onblock_trace.reset();
+
+            // blocks replayed after they were written are already in the log
+            if( block.block_num <= actions_log->head_block_num() )
+               return;
+            reversible_blocks.add_block( std::move(block) );
+         }
+
+         void on_irreversible_block( const block_state_ptr& bsp ) {
+            if( bsp->block_num <= actions_log->head_block_num() )
+               return;
+
+            const history_block* block = reversible_blocks.find_block( bsp->block_num );
+            if( block && block->block_id == bsp->id ) {
+               actions_log->append_block( *block );
+               missing_history = false;
+            } else {
+               if( !missing_history )
+                  wlog( "no action history was recorded for irreversible block ${n}, it will be missing from the history",
+                        ("n", bsp->block_num) );
+               missing_history = true;
+               history_block empty;
+               empty.block_num  = bsp->block_num;
+               empty.block_id   = bsp->id;
+               empty.block_time = bsp->header.timestamp;
+               actions_log->append_block( empty );
+            }
+            reversible_blocks.remove_through( bsp->block_num );
+         }
    };
 
    history_plugin::history_plugin()
@@ -309,6 +330,13 @@ namespace eosio {
             ("filter-out,F", bpo::value<vector<string>>()->composing(),
              "Do not track actions which match receiver:action:actor. Action and Actor both blank excludes all from Reciever. Actor blank excludes all from reciever:action. Receiver may not be blank.")
             ;
+      cfg.add_options()
+            ("history-dir", bpo::value<bfs::path>()->default_value("history"),
+             "the location of the action history directory (absolute path or relative to application data dir)")
+            ;
+      cli.add_options()
+            ("delete-history", bpo::bool_switch()->default_value(false), "clear action history files")
+            ;
    }
 
    // [1 插件启动] 初始化插件
@@ -319,7 +347,7 @@ namespace eosio {
             for( auto& s : fo ) {
                if( s == "*" || s == "\"*\"" ) { // 不过滤。可以撑爆内存
                   my->bypass_filter = true;
-                  wlog( "--filter-on * enabled. This can fill shared_mem, causing nodeos to stop." );
+                  wlog( "--filter-on * enabled. This can fill the disk of history-dir." );
                   break;
                }
                std::vector<std::string> v;
@@ -349,16 +377,36 @@ namespace eosio {
          auto& chain = my->chain_plug->chain();
 
          chainbase::database& db = const_cast<chainbase::database&>( chain.db() ); // Override read-only access to state DB (highly unrecommended practice!)
-         // TODO: Use separate chainbase database for managing the state of the history_plugin (or remove deprecated history_plugin entirely) 
-         db.add_index<account_history_index>();
-         db.add_index<action_history_index>();
          db.add_index<account_control_history_multi_index>();
          db.add_index<public_key_history_multi_index>();
 
+         // action history is kept in its own files, only the irreversible part is written
+         auto dir_option = options.at( "history-dir" ).as<bfs::path>();
+         if( dir_option.is_relative() )
+            my->history_dir = app().data_dir() / dir_option;
+         else
+            my->history_dir = dir_option;
+         if( options.at( "delete-history" ).as<bool>() ) {
+            ilog( "Deleting action history" );
+            boost::filesystem::remove_all( my->history_dir );
+         }
+         boost::filesystem::create_directories( my->history_dir );
+         my->actions_log.emplace( my->history_dir );
+         // reversible blocks are kept over a restart, they may still become irreversible
+         my->reversible_blocks.load( my->history_dir / "history_reversible.bin", my->actions_log->head_block_num() );
+
          my->applied_transaction_connection.emplace(
                chain.applied_transaction.connect( [&]( const transaction_trace_ptr& p ) {
                   my->on_applied_transaction( p );
                } ));
+         my->accepted_block_connection.emplace(
+               chain.accepted_block.connect( [&]( const block_state_ptr& p ) {
+                  my->on_accepted_block( p );
+               } ));
+         my->irreversible_block_connection.emplace(
+               chain.irreversible_block.connect( [&]( const block_state_ptr& p ) {
+                  my->on_irreversible_block( p );
+               } ));
       } FC_LOG_AND_RETHROW()
    }
 
@@ -367,6 +415,12 @@ namespace eosio {
 
    void history_plugin::plugin_shutdown() {
       my->applied_transaction_connection.reset();
+      my->accepted_block_connection.reset();
+      my->irreversible_block_connection.reset();
+      if( my->actions_log ) {
+         my->reversible_blocks.write( my->history_dir / "history_reversible.bin" );
+         my->actions_log.reset();
+      }
    }
 
 
@@ -376,27 +430,25 @@ namespace eosio {
       read_only::get_actions_result read_only::get_actions( const read_only::get_actions_params& params )const {
          edump((params));
         auto& chain = history->chain_plug->chain();
-        const auto& db = chain.db();
         const auto abi_serializer_max_time = history->chain_plug->get_abi_serializer_max_time();
+        const auto& actions_log = *history->actions_log;
 
-        const auto& idx = db.get_index<account_history_index, by_account_action_seq>();
+        auto n = params.account_name;
+        // account sequence numbers continue from the log into the reversible blocks, then into the pending block
+        const int32_t logged = actions_log.account_action_count( n );
+        const auto& reversible = history->reversible_blocks.account_actions( n );
+        const int32_t accepted = logged + int32_t(reversible.size());
+        const auto pending_block = chain.pending_block_state();
+        const auto pending = history->pending_account_actions( n, pending_block );
+        const int32_t total = accepted + int32_t(pending.size());
 
         int32_t start = 0;
         int32_t pos = params.pos ? *params.pos : -1;
         int32_t end = 0;
         int32_t offset = params.offset ? *params.offset : -20;
-        auto n = params.account_name;
         idump((pos));
-        if( pos == -1 ) {
-            auto itr = idx.lower_bound( boost::make_tuple( name(n.value+1), 0 ) );
-            if( itr == idx.begin() ) {
-               if( itr->account == n )
-                  pos = itr->account_sequence_num+1;
-            } else if( itr != idx.begin() ) --itr;
-
-            if( itr->account == n )
-               pos = itr->account_sequence_num + 1;
-        }
+        if( pos == -1 && total )
+            pos = total;
 
         if( pos== -1 ) pos = 0xfffffff;
 
@@ -412,32 +464,52 @@ namespace eosio {
 
         idump((start)(end));
 
-        auto start_itr = idx.lower_bound( boost::make_tuple( n, start ) );
-        auto end_itr = idx.upper_bound( boost::make_tuple( n, end) );
+        const int32_t first = std::max( start, 0 );
+        const int32_t last = std::min( end, total - 1 );
 
         auto start_time = fc::time_point::now();
         auto end_time = start_time;
 
         get_actions_result result;
         result.last_irreversible_block = chain.last_irreversible_block_num();
-        while( start_itr != end_itr ) {
-           const auto& a = db.get<action_history_object, by_action_sequence_num>( start_itr->action_sequence_num );
-           fc::datastream<const char*> ds( a.packed_action_trace.data(), a.packed_action_trace.size() );
-           action_trace t;
-           fc::raw::unpack( ds, t );
+        auto add_action = [&]( uint64_t action_sequence_num, int32_t account_sequence_num, uint32_t block_num,
+                               block_timestamp_type block_time, const action_trace& t ) {
            result.actions.emplace_back( ordered_action_result{
-                                 start_itr->action_sequence_num,
-                                 start_itr->account_sequence_num,
-                                 a.block_num, a.block_time,
+                                 action_sequence_num,
+                                 account_sequence_num,
+                                 block_num, block_time,
                                  chain.to_variant_with_abi(t, abi_serializer_max_time)
                                  });
 
            end_time = fc::time_point::now();
            if( end_time - start_time > fc::microseconds(100000) ) {
               result.time_limit_exceeded_error = true;
-              break;
+              return false;
+           }
+           return true;
+        };
+
+        int32_t seq = first;
+        if( seq < logged ) {
+           for( auto p : actions_log.account_action_positions( n, first, std::min( last, logged - 1 ) ) ) {
+              const auto header = actions_log.read_header( p );
+              if( !add_action( header.action_sequence_num, seq++, header.block_num, header.block_time,
+                               actions_log.read_action_trace( p, header ) ) )
+                 return result;
            }
-           ++start_itr;
+        }
+        for( seq = std::max( first, logged ); seq <= std::min( last, accepted - 1 ); ++seq ) {
+           const auto& ra = reversible[seq - logged];
+           action_trace t;
+           fc::datastream<const char*> ds( ra.second->packed_action_trace.data(), ra.second->packed_action_trace.size() );
+           fc::raw::unpack( ds, t );
+           if( !add_action( ra.second->action_sequence_num, seq, ra.first->block_num, ra.first->block_time, t ) )
+              return result;
+        }
+        for( seq = std::max( first, accepted ); seq <= last; ++seq ) {
+           const auto& t = *pending[seq - accepted];
+           if( !add_action( t.receipt.global_sequence, seq, pending_block->block_num, pending_block->header.timestamp, t ) )
+              break;
         }
         return result;
       }
@@ -466,11 +538,19 @@ namespace eosio {
             return (*(input_id.data() + input_id_size) & 0xF0) == (*(id.data() + input_id_size) & 0xF0);
          };
 
-         const auto& db = chain.db();
-         const auto& idx = db.get_index<action_history_index, by_trx_id>();
-         auto itr = idx.lower_bound( boost::make_tuple( input_id ) );
+         // the lowest matching id of the log and of the reversible blocks
+         const auto& actions_log = *history->actions_log;
+         const uint64_t log_pos = actions_log.find_transaction( input_id, txn_id_matched );
+         history_action_header log_header;
+         if( log_pos != history_no_entry )
+            log_header = actions_log.read_header( log_pos );
+         const auto reversible = history->reversible_blocks.find_transaction( input_id, txn_id_matched );
+         bool in_reversible = reversible.first != nullptr;
+         if( in_reversible && log_pos != history_no_entry &&
+             log_header.trx_id < reversible.first->actions[reversible.second].trx_id )
+            in_reversible = false;
 
-         bool in_history = (itr != idx.end() && txn_id_matched(itr->trx_id) );
+         bool in_history = in_reversible || log_pos != history_no_entry;
 
          if( !in_history && !p.block_num_hint ) {
             EOS_THROW(tx_not_found, "Transaction ${id} not found in history and no block hint was given", ("id",p.id));
@@ -479,19 +559,32 @@ namespace eosio {
          get_transaction_result result;
 
          if( in_history ) {
-            result.id         = itr->trx_id;
             result.last_irreversible_block = chain.last_irreversible_block_num();
-            result.block_num  = itr->block_num;
-            result.block_time = itr->block_time;
-
-            while( itr != idx.end() && itr->trx_id == result.id ) {
-
-              fc::datastream<const char*> ds( itr->packed_action_trace.data(), itr->packed_action_trace.size() );
-              action_trace t;
-              fc::raw::unpack( ds, t );
-              result.traces.emplace_back( chain.to_variant_with_abi(t, abi_serializer_max_time) );
-
-              ++itr;
+            if( in_reversible ) {
+               const auto& blk = *reversible.first;
+               result.id         = blk.actions[reversible.second].trx_id;
+               result.block_num  = blk.block_num;
+               result.block_time = blk.block_time;
+
+               for( size_t i = reversible.second; i < blk.actions.size() && blk.actions[i].trx_id == result.id; ++i ) {
+                 const auto& packed = blk.actions[i].packed_action_trace;
+                 fc::datastream<const char*> ds( packed.data(), packed.size() );
+                 action_trace t;
+                 fc::raw::unpack( ds, t );
+                 result.traces.emplace_back( chain.to_variant_with_abi(t, abi_serializer_max_time) );
+               }
+            } else {
+               result.id         = log_header.trx_id;
+               result.block_num  = log_header.block_num;
+               result.block_time = log_header.block_time;
+
+               for( uint64_t pos = log_pos; pos < actions_log.end_pos(); ) {
+                 const auto header = actions_log.read_header( pos );
+                 if( header.trx_id != result.id )
+                    break;
+                 result.traces.emplace_back( chain.to_variant_with_abi(actions_log.read_action_trace( pos, header ), abi_serializer_max_time) );
+                 pos = history_log::next_action_pos( pos, header );
+               }
             }
 
             auto blk = chain.fetch_block_by_number( result.block_num );
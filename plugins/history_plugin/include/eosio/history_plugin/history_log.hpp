@@ -0,0 +1,291 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/chain/block_timestamp.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <eosio/chain/trace.hpp>
+#include <eosio/chain/types.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+namespace eosio {
+
+/*
+ *   history_action.log, append only:
+ *   +----------+------------+-----+----------+
+ *   | Action i | Action i+1 | ... | Action z |
+ *   +----------+------------+-----+----------+
+ *
+ *   each action:
+ *      history_action_header
+ *      char[]                   packed action_trace
+ *
+ *   history_account.index, append only:
+ *      one history_account_entry for each account which has an action in its history. The entries of an account
+ *      are linked by prev, and jump skips back along the links so that the entry with any account sequence number
+ *      is found in O(log n) steps from the newest entry of the account.
+ *
+ *   history_trx.index, append only:
+ *      one history_trx_entry for each run of consecutive actions of a transaction. The entries are chained by prev
+ *      into buckets selected by the leading bits of the transaction id.
+ *
+ *   history_trx.buckets:
+ *      the newest history_trx_entry of each bucket plus one, 0 for an empty bucket. Memory mapped and updated in place
+ *      once the block of the entry is recorded in history.head.
+ *
+ *   history_account.heads:
+ *      a checkpoint: the number of account entries and of transaction entries it covers, then the newest
+ *      history_account_entry of each account. Written with the buckets flushed every checkpoint_interval blocks and
+ *      on close.
+ *
+ *   history.head:
+ *      history_log_head, replaced after each block. Anything in the files past the sizes it records was not
+ *      completely written and is truncated on open. When the files were not closed cleanly, the account heads and
+ *      buckets are brought up to date by replaying the index entries written after the checkpoint, or rebuilt from
+ *      all of them when there is no usable checkpoint.
+ *
+ *   Records are written with fc::raw, the headers and index entries have the fixed sizes below.
+ */
+
+const static uint32_t history_log_version = 1;
+const static uint64_t history_no_entry = std::numeric_limits<uint64_t>::max();
+const static uint32_t history_trx_bucket_bits = 24;
+const static uint32_t history_checkpoint_interval = 10000;   ///< default blocks between checkpoints of the heads
+
+const static uint32_t history_action_header_size = 56;   ///< packed size of history_action_header
+const static uint32_t history_account_entry_size = 36;   ///< packed size of history_account_entry
+const static uint32_t history_trx_entry_size     = 48;   ///< packed size of history_trx_entry
+
+struct history_action_header {
+   uint64_t                    action_sequence_num = 0;
+   chain::transaction_id_type  trx_id;
+   uint32_t                    block_num = 0;
+   chain::block_timestamp_type block_time;
+   uint64_t                    payload_size = 0;
+};
+
+struct history_account_entry {
+   chain::account_name account;
+   int32_t             account_sequence_num = 0;
+   uint64_t            action_pos = 0;              ///< position of the action in history_action.log
+   uint64_t            prev = history_no_entry;     ///< entry with account_sequence_num - 1
+   uint64_t            jump = history_no_entry;     ///< an earlier entry of the account, at most prev
+};
+
+struct history_trx_entry {
+   chain::transaction_id_type trx_id;
+   uint64_t                   action_pos = 0;       ///< position of the first action of the run in history_action.log
+   uint64_t                   prev = history_no_entry; ///< previous entry in the same bucket
+};
+
+struct history_log_head {
+   uint32_t             version = history_log_version;
+   uint32_t             block_num = 0;
+   chain::block_id_type block_id;
+   uint64_t             log_size = 0;
+   uint64_t             account_entries = 0;
+   uint64_t             trx_entries = 0;
+   bool                 clean = false;   ///< buckets and account heads are up to date with the entries
+};
+
+struct history_action {
+   uint64_t                         action_sequence_num = 0;
+   chain::transaction_id_type       trx_id;
+   std::vector<chain::account_name> accounts;   ///< accounts which have the action in their history
+   chain::bytes                     packed_action_trace;
+};
+
+struct history_block {
+   uint32_t                     block_num = 0;
+   chain::block_id_type         block_id;
+   chain::block_timestamp_type  block_time;
+   std::vector<history_action>  actions;
+};
+
+/**
+ *  Action history of the irreversible blocks, kept outside of the chain state. Blocks are appended in order and never
+ *  removed, reads go through read only mappings of the files.
+ */
+class history_log {
+   public:
+      explicit history_log( const boost::filesystem::path& dir, uint32_t checkpoint_interval = history_checkpoint_interval );
+      ~history_log();
+
+      history_log( const history_log& ) = delete;
+      history_log& operator=( const history_log& ) = delete;
+
+      /// the last block appended, 0 when empty
+      uint32_t head_block_num()const { return head.block_num; }
+
+      /// appends the actions of the next irreversible block
+      void append_block( const history_block& block );
+
+      /// writes the account heads, after which the files are consistent without a rebuild
+      void close();
+
+      /// the number of actions in the history of account
+      int32_t account_action_count( const chain::account_name& account )const;
+
+      /// positions of the actions of account with account sequence numbers in [first, last], oldest first
+      std::vector<uint64_t> account_action_positions( const chain::account_name& account, int32_t first, int32_t last )const;
+
+      /// the end of the actions, position of the next action to be appended
+      uint64_t end_pos()const { return head.log_size; }
+
+      history_action_header read_header( uint64_t pos )const;
+      chain::action_trace   read_action_trace( uint64_t pos, const history_action_header& header )const;
+
+      static uint64_t next_action_pos( uint64_t pos, const history_action_header& header ) {
+         return pos + history_action_header_size + header.payload_size;
+      }
+
+      /**
+       *  Finds the first action of the lowest transaction id accepted by match. id must hold at least the leading
+       *  history_trx_bucket_bits of the ids match accepts. Returns history_no_entry when none is accepted.
+       */
+      template<typename Match>
+      uint64_t find_transaction( const chain::transaction_id_type& id, Match&& match )const {
+         uint64_t found = history_no_entry;
+         chain::transaction_id_type found_id;
+         // entries are chained newest first, so an older run of an equal id replaces a newer one
+         for( uint64_t i = bucket_head( trx_bucket( id ) ); i != history_no_entry; ) {
+            const auto entry = get_trx_entry( i );
+            if( match( entry.trx_id ) && ( found == history_no_entry || !( found_id < entry.trx_id ) ) ) {
+               found = entry.action_pos;
+               found_id = entry.trx_id;
+            }
+            i = entry.prev;
+         }
+         return found;
+      }
+
+   private:
+      struct account_head {
+         uint64_t last = history_no_entry;
+         int32_t  count = 0;
+      };
+
+      static uint32_t trx_bucket( const chain::transaction_id_type& id ) {
+         const auto* d = reinterpret_cast<const uint8_t*>( id.data() );
+         return ( uint32_t(d[0]) << 16 | uint32_t(d[1]) << 8 | uint32_t(d[2]) ) >> ( 24 - history_trx_bucket_bits );
+      }
+
+      uint64_t bucket_head( uint32_t bucket )const;
+      history_account_entry get_account_entry( uint64_t i )const;
+      history_trx_entry get_trx_entry( uint64_t i )const;
+      const char* map_file( std::unique_ptr<boost::interprocess::mapped_region>& region,
+                            const boost::filesystem::path& file, uint64_t min_size )const;
+
+      void append_account_entry( const chain::account_name& account, uint64_t action_pos );
+      void append_trx_entry( const chain::transaction_id_type& trx_id, uint64_t action_pos );
+      void open_file( std::fstream& stream, const boost::filesystem::path& file, uint64_t committed_size );
+      void rebuild_heads( uint64_t account_from, uint64_t trx_from );
+      bool load_account_heads( bool clean, uint64_t& account_entries, uint64_t& trx_entries );
+      void write_checkpoint();
+      void write_head();
+
+      boost::filesystem::path    log_file;
+      boost::filesystem::path    account_index_file;
+      boost::filesystem::path    trx_index_file;
+      boost::filesystem::path    buckets_file;
+      boost::filesystem::path    account_heads_file;
+      boost::filesystem::path    head_file;
+
+      std::fstream               log_stream;
+      std::fstream               account_index_stream;
+      std::fstream               trx_index_stream;
+
+      history_log_head           head;
+      bool                       is_open = false;
+      uint32_t                   checkpoint_interval = history_checkpoint_interval;
+      uint32_t                   checkpoint_block_num = 0;
+      uint64_t                   pending_trx_entries = 0;
+      std::vector<history_account_entry> pending_account_entries;   ///< appended by the block being written
+      std::unordered_map<uint32_t, uint64_t> pending_buckets;       ///< bucket updates of the block being written
+      chain::transaction_id_type last_trx_id;
+
+      std::unordered_map<chain::account_name, account_head, std::hash<chain::account_name>> account_heads;
+
+      std::unique_ptr<boost::interprocess::mapped_region>          buckets_region;
+      mutable std::unique_ptr<boost::interprocess::mapped_region>  log_region;
+      mutable std::unique_ptr<boost::interprocess::mapped_region>  account_index_region;
+      mutable std::unique_ptr<boost::interprocess::mapped_region>  trx_index_region;
+};
+
+/**
+ *  Actions of the accepted blocks which are not irreversible yet, on the current branch, indexed by account and by
+ *  transaction in the same way as history_log.
+ */
+class history_reversible_blocks {
+   public:
+      using account_action = std::pair<const history_block*, const history_action*>;
+
+      bool empty()const { return blocks.empty(); }
+
+      /// the last block added, 0 when empty
+      uint32_t last_block_num()const { return blocks.empty() ? 0 : blocks.rbegin()->first; }
+
+      const history_block* find_block( uint32_t block_num )const {
+         auto itr = blocks.find( block_num );
+         return itr == blocks.end() ? nullptr : &itr->second;
+      }
+
+      /// adds the next accepted block, a block at or before the last one switches forks and drops the old branch
+      void add_block( history_block&& block );
+
+      /// removes the blocks up to and including block_num, once they are irreversible
+      void remove_through( uint32_t block_num );
+
+      /// the reversible actions of account, in account sequence order
+      const std::deque<account_action>& account_actions( const chain::account_name& account )const {
+         static const std::deque<account_action> none;
+         auto itr = by_account.find( account );
+         return itr == by_account.end() ? none : itr->second;
+      }
+
+      /**
+       *  Finds the first action of the lowest transaction id accepted by match, which must accept only ids starting
+       *  with id. Returns the block and the index of the action in it, or a null block when none is accepted.
+       */
+      template<typename Match>
+      std::pair<const history_block*, size_t> find_transaction( const chain::transaction_id_type& id, Match&& match )const {
+         auto itr = by_trx.lower_bound( id );
+         if( itr == by_trx.end() || !match( itr->first ) )
+            return { nullptr, 0 };
+         return itr->second;
+      }
+
+      /// reads blocks written by write, dropping the ones up to and including after_block_num
+      void load( const boost::filesystem::path& file, uint32_t after_block_num );
+      void write( const boost::filesystem::path& file );
+
+   private:
+      void index_block( const history_block& b );
+      void index_blocks();
+      void remove_front();
+
+      std::map<uint32_t, history_block>                                    blocks;
+      std::unordered_map<chain::account_name, std::deque<account_action>> by_account;
+      /// the first action of each run of actions with the same transaction id, by block and action index
+      std::multimap<chain::transaction_id_type, std::pair<const history_block*, size_t>> by_trx;
+};
+
+} // namespace eosio
+
+FC_REFLECT( eosio::history_action_header, (action_sequence_num)(trx_id)(block_num)(block_time)(payload_size) )
+FC_REFLECT( eosio::history_account_entry, (account)(account_sequence_num)(action_pos)(prev)(jump) )
+FC_REFLECT( eosio::history_trx_entry, (trx_id)(action_pos)(prev) )
+FC_REFLECT( eosio::history_log_head, (version)(block_num)(block_id)(log_size)(account_entries)(trx_entries)(clean) )
+FC_REFLECT( eosio::history_action, (action_sequence_num)(trx_id)(accounts)(packed_action_trace) )
+FC_REFLECT( eosio::history_block, (block_num)(block_id)(block_time)(actions) )
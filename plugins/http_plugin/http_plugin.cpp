@@ -24,6 +24,7 @@
 
 #include <thread>
 #include <memory>
+#include <mutex>
 #include <regex>
 
 namespace eosio {
@@ -128,7 +129,13 @@ namespace eosio {
 
    class http_plugin_impl {
       public:
-         map<string,url_handler>  url_handlers;
+         struct registered_handler {
+            url_handler handler;
+            bool        run_on_http_thread = false;
+         };
+
+         map<string,registered_handler> url_handlers;
+         std::mutex               url_handlers_mtx;
          optional<tcp::endpoint>  listen_endpoint;
          string                   access_control_allow_origin;
          string                   access_control_allow_headers;
@@ -154,6 +161,12 @@ namespace eosio {
          string                   http_server_address_option_name  = "http-server-address";
          string                   https_server_address_option_name = "https-server-address";
 
+         /// all servers run on server_ioc, which is run by thread_pool_size threads
+         uint16_t                 thread_pool_size = 2;
+         asio::io_service         server_ioc;
+         optional<asio::io_service::work> server_ioc_work;
+         vector<std::thread>      server_threads;
+
          bool host_port_is_valid( const std::string& header_host_port, const string& endpoint_local_host_port ) {
             return !validate_host || header_host_port == endpoint_local_host_port || valid_hosts.find(header_host_port) != valid_hosts.end();
          }
@@ -284,14 +297,22 @@ namespace eosio {
                con->append_header( "Content-type", "application/json" );
                auto body = con->get_request_body();
                auto resource = con->get_uri()->get_resource();
-               auto handler_itr = url_handlers.find( resource ); // 查找路由
-               if( handler_itr != url_handlers.end()) {
+               auto handler = find_handler( resource ); // 查找路由
+               if( handler ) {
                   con->defer_http_response();
-                  handler_itr->second( resource, body, [con]( auto code, auto&& body ) {
-                     con->set_body( std::move( body ));
-                     con->set_status( websocketpp::http::status_code::value( code ));
-                     con->send_http_response();
-                  } );
+                  auto cb = make_http_response_handler<T>( con );
+                  if( handler->run_on_http_thread ) {
+                     handler->handler( resource, std::move( body ), cb );
+                  } else {
+                     // chain state is only accessed from the application thread
+                     app().get_io_service().post( [h = std::move( handler->handler ), resource, body = std::move( body ), cb]() {
+                        try {
+                           h( resource, body, cb );
+                        } catch( ... ) {
+                           http_plugin::handle_exception( "http", resource.c_str(), body, cb );
+                        }
+                     } );
+                  }
 
                } else {
                   dlog( "404 - not found: ${ep}", ("ep", resource));
@@ -305,12 +326,69 @@ namespace eosio {
             }
          }
 
+         optional<registered_handler> find_handler( const string& resource ) {
+            std::lock_guard<std::mutex> g( url_handlers_mtx );
+            auto itr = url_handlers.find( resource );
+            if( itr == url_handlers.end() )
+               return optional<registered_handler>();
+            return itr->second;
+         }
+
+         /// the returned callback may be called from any thread, the response is always sent from an http thread
+         template<class T>
+         url_response_callback make_http_response_handler( typename websocketpp::server<T>::connection_ptr con ) {
+            return [this, con]( int code, string body ) {
+               server_ioc.post( [con, code, body = std::move( body )]() mutable {
+                  try {
+                     con->set_body( std::move( body ));
+                     con->set_status( websocketpp::http::status_code::value( code ));
+                     con->send_http_response();
+                  } catch( ... ) {
+                     handle_exception<T>( con );
+                  }
+               } );
+            };
+         }
+
+         void add_handler( const string& url, const url_handler& handler, bool run_on_http_thread ) {
+            std::lock_guard<std::mutex> g( url_handlers_mtx );
+            url_handlers[url] = registered_handler{ handler, run_on_http_thread };
+         }
+
+         void start_server_threads() {
+            server_ioc_work.emplace( server_ioc );
+            for( uint16_t i = 0; i < thread_pool_size; ++i ) {
+               server_threads.emplace_back( [this]() {
+                  while( true ) {
+                     try {
+                        server_ioc.run();
+                        break;
+                     } catch( const fc::exception& e ) {
+                        elog( "http thread: ${e}", ("e", e.to_detail_string()));
+                     } catch( const std::exception& e ) {
+                        elog( "http thread: ${e}", ("e", e.what()));
+                     } catch( ... ) {
+                        elog( "error thrown from http thread" );
+                     }
+                  }
+               } );
+            }
+         }
+
+         void stop_server_threads() {
+            server_ioc_work.reset();
+            server_ioc.stop();
+            for( auto& t : server_threads )
+               t.join();
+            server_threads.clear();
+         }
+
          // 创建http服务器
          template<class T>
          void create_server_for_endpoint(const tcp::endpoint& ep, websocketpp::server<detail::asio_with_stub_log<T>>& ws) {
             try {
                ws.clear_access_channels(websocketpp::log::alevel::all);
-               ws.init_asio(&app().get_io_service());
+               ws.init_asio(&server_ioc);
                ws.set_reuse_addr(true);
                ws.set_max_http_body_size(max_body_size);
                ws.set_http_handler([&](connection_hdl hdl) {
@@ -402,6 +480,8 @@ namespace eosio {
             ("verbose-http-errors", bpo::bool_switch()->default_value(false), "Append the error log to HTTP responses")
             ("http-validate-host", boost::program_options::value<bool>()->default_value(true), "If set to false, then any incoming \"Host\" header is considered valid")
             ("http-alias", bpo::value<std::vector<string>>()->composing(), "Additionaly acceptable values for the \"Host\" header of incoming HTTP requests, can be specified multiple times.  Includes http/s_server_address by default.")
+            ("http-threads", bpo::value<uint16_t>()->default_value(my->thread_pool_size),
+             "Number of worker threads that run the http servers and serialize api responses")
             ;
    }
 
@@ -409,6 +489,9 @@ namespace eosio {
    void http_plugin::plugin_initialize(const variables_map& options) {
       try {
          my->validate_host = options.at("http-validate-host").as<bool>();
+         my->thread_pool_size = options.at( "http-threads" ).as<uint16_t>();
+         EOS_ASSERT( my->thread_pool_size > 0, chain::plugin_config_exception,
+                     "http-threads ${num} must be greater than 0", ("num", my->thread_pool_size));
          if( options.count( "http-alias" )) {
             const auto& aliases = options["http-alias"].as<vector<string>>();
             my->valid_hosts.insert(aliases.begin(), aliases.end());
@@ -505,7 +588,7 @@ namespace eosio {
       if(my->unix_endpoint) {
          try {
             my->unix_server.clear_access_channels(websocketpp::log::alevel::all);
-            my->unix_server.init_asio(&app().get_io_service());
+            my->unix_server.init_asio(&my->server_ioc);
             my->unix_server.set_max_http_body_size(my->max_body_size);
             my->unix_server.listen(*my->unix_endpoint);
             my->unix_server.set_http_handler([&](connection_hdl hdl) {
@@ -545,6 +628,8 @@ namespace eosio {
             throw;
          }
       }
+
+      my->start_server_threads();
    }
 
    void http_plugin::plugin_shutdown() {
@@ -552,13 +637,24 @@ namespace eosio {
          my->server.stop_listening();
       if(my->https_server.is_listening())
          my->https_server.stop_listening();
+      if(my->unix_server.is_listening())
+         my->unix_server.stop_listening();
+
+      my->stop_server_threads();
    }
 
    void http_plugin::add_handler(const string& url, const url_handler& handler) {
       ilog( "add api url: ${c}", ("c",url) );
-      app().get_io_service().post([=](){
-        my->url_handlers.insert(std::make_pair(url,handler));
-      });
+      my->add_handler( url, handler, false );
+   }
+
+   void http_plugin::add_async_handler(const string& url, const url_handler& handler) {
+      ilog( "add api url: ${c}", ("c",url) );
+      my->add_handler( url, handler, true );
+   }
+
+   void http_plugin::post_http_thread_pool(std::function<void()> f) {
+      my->server_ioc.post( std::move( f ));
    }
 
    void http_plugin::handle_exception( const char *api_name, const char *call_name, const string& body, url_response_callback cb ) {
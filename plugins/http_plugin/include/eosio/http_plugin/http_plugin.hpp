@@ -60,12 +60,15 @@ namespace eosio {
     *  called with the response code and body.
     *
     *  The handler will be called from the appbase application io_service
-    *  thread.  The callback can be called from any thread and will
-    *  automatically propagate the call to the http thread.
+    *  thread, unless it was registered with add_async_handler in which case
+    *  it is called from an http thread and must marshal any access to chain
+    *  state to the application thread itself.  The callback can be called
+    *  from any thread and will automatically propagate the call to the http
+    *  thread.
     *
-    *  The HTTP service will run in its own thread with its own io_service to
-    *  make sure that HTTP request processing does not interfer with other
-    *  plugins.
+    *  The HTTP service will run in its own pool of threads with its own
+    *  io_service to make sure that HTTP request processing does not interfer
+    *  with other plugins.
     */
    class http_plugin : public appbase::plugin<http_plugin>
    {
@@ -90,6 +93,16 @@ namespace eosio {
               add_handler(call.first, call.second);
         }
 
+        /// like add_handler, but the handler is called on an http thread instead of the application thread
+        void add_async_handler(const string& url, const url_handler&);
+        void add_async_api(const api_description& api) {
+           for (const auto& call : api)
+              add_async_handler(call.first, call.second);
+        }
+
+        /// run work on the http thread pool, e.g. serializing a large response outside of the application thread
+        void post_http_thread_pool(std::function<void()> f);
+
         // standard exception handling for api handlers
         static void handle_exception( const char *api_name, const char *call_name, const string& body, url_response_callback cb );
 
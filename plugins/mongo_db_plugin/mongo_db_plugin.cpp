@@ -91,7 +91,7 @@ public:
    void process_irreversible_block(const chain::block_state_ptr&);
    void _process_irreversible_block(const chain::block_state_ptr&);
 
-   optional<abi_serializer> get_abi_serializer( account_name n );
+   std::shared_ptr<const abi_serializer> get_abi_serializer( account_name n );
    template<typename T> fc::variant to_variant_with_abi( const T& obj );
 
    void purge_abi_cache();
@@ -176,7 +176,7 @@ public:
    struct abi_cache {
       account_name                     account;
       fc::time_point                   last_accessed;
-      fc::optional<abi_serializer>     serializer;
+      std::shared_ptr<const abi_serializer> serializer; ///< shared with callers so lookups do not copy the serializer
    };
 
    typedef boost::multi_index_container<abi_cache,
@@ -583,7 +583,7 @@ void mongo_db_plugin_impl::purge_abi_cache() {
    }
 }
 
-optional<abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name n ) {
+std::shared_ptr<const abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name n ) {
    using bsoncxx::builder::basic::kvp;
    using bsoncxx::builder::basic::make_document;
    if( n.good()) {
@@ -607,7 +607,7 @@ optional<abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name
                   abi = fc::json::from_string( bsoncxx::to_json( view["abi"].get_document())).as<abi_def>();
                } catch (...) {
                   ilog( "Unable to convert account abi to abi_def for ${n}", ( "n", n ));
-                  return optional<abi_serializer>();
+                  return std::shared_ptr<const abi_serializer>();
                }
 
                purge_abi_cache(); // make room if necessary
@@ -644,14 +644,14 @@ optional<abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name
                   }
                }
                abis.set_abi( abi, abi_serializer_max_time );
-               entry.serializer.emplace( std::move( abis ) );
+               entry.serializer = std::make_shared<const abi_serializer>( std::move( abis ) );
                abi_cache_index.insert( entry );
                return entry.serializer;
             }
          }
       } FC_CAPTURE_AND_LOG((n))
    }
-   return optional<abi_serializer>();
+   return std::shared_ptr<const abi_serializer>();
 }
 
 template<typename T>
@@ -1082,11 +1082,9 @@ void mongo_db_plugin_impl::_process_irreversible_block(const chain::block_state_
          string trx_id_str;
          if( receipt.trx.contains<packed_transaction>() ) {
             const auto& pt = receipt.trx.get<packed_transaction>();
-            // get id via get_raw_transaction() as packed_transaction.id() mutates internal transaction state
-            const auto& raw = pt.get_raw_transaction();
-            const auto& trx = fc::raw::unpack<transaction>( raw );
+            const auto& trx = pt.get_unpacked_transaction();
             if( !filter_include( trx ) ) continue;
-            const auto& id = trx.id();
+            const auto& id = pt.id();
             trx_id_str = id.str();
          } else {
             const auto& id = receipt.trx.get<transaction_id_type>();
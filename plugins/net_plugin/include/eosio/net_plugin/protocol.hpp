@@ -132,6 +132,14 @@ namespace eosio {
       uint32_t end_block;
    };
 
+   /**
+    *  A large signed_block or packed_transaction message, zlib compressed. Only sent to peers whose
+    *  handshake advertises a network version able to receive it.
+    */
+   struct compressed_message {
+      bytes data; ///< compressed net_message, without its size prefix
+   };
+
    using net_message = static_variant<handshake_message,
                                       chain_size_message,
                                       go_away_message,
@@ -140,7 +148,8 @@ namespace eosio {
                                       request_message,
                                       sync_request_message,
                                       signed_block,
-                                      packed_transaction>;
+                                      packed_transaction,
+                                      compressed_message>;
 
 } // namespace eosio
 
@@ -159,6 +168,7 @@ FC_REFLECT( eosio::time_message, (org)(rec)(xmt)(dst) )
 FC_REFLECT( eosio::notice_message, (known_trx)(known_blocks) )
 FC_REFLECT( eosio::request_message, (req_trx)(req_blocks) )
 FC_REFLECT( eosio::sync_request_message, (start_block)(end_block) )
+FC_REFLECT( eosio::compressed_message, (data) )
 
 /**
  *
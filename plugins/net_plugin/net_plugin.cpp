@@ -23,11 +23,22 @@
 #include <fc/crypto/rand.hpp>
 #include <fc/exception/exception.hpp>
 
+#include <boost/asio/bind_executor.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
 #include <boost/intrusive/set.hpp>
 
+#include <atomic>
+
 using namespace eosio::chain::plugin_interface::compat;
 
 namespace fc {
@@ -68,7 +79,7 @@ namespace eosio {
                                 /// Expires increased while the txn is
                                 /// "in flight" to anoher peer
       packed_transaction packed_txn;
-      vector<char>    serialized_txn; /// the received raw bundle
+      std::shared_ptr<vector<char>> serialized_txn; /// the framed message, shared with the write queues
       uint32_t        block_num = 0; /// block transaction was included in
       uint32_t        true_block = 0; /// used to reset block_uum when request is 0
       uint16_t        requests = 0; /// the number of "in flight" requests for this txn
@@ -171,19 +182,45 @@ namespace eosio {
 
       bool                          use_socket_read_watermark = false;
 
+      uint16_t                                  thread_pool_size = 0;
+      /// runs server_ioc, which the peer sockets and their reads and writes are on
+      optional<boost::asio::thread_pool>        thread_pool;
+      std::shared_ptr<boost::asio::io_context>  server_ioc;
+      optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> server_ioc_work;
+
+      /// blocks and transactions of at least this many framed bytes are compressed for peers able to receive it, 0 to disable
+      uint32_t                                  compression_threshold = 0;
+      /// the last buffer compressed and its compressed form, so a broadcast compresses once for all peers
+      std::shared_ptr<vector<char>>             last_uncompressed_buffer;
+      std::shared_ptr<vector<char>>             last_compressed_buffer;
+
+      struct sync_block_buffer {
+         std::shared_ptr<vector<char>> framed;
+         std::shared_ptr<vector<char>> compressed; ///< set once a peer able to receive compressed messages requests it
+      };
+      /// framed block log blocks recently sent to syncing peers, so each is framed and compressed once for all of them
+      std::map<uint32_t, sync_block_buffer>     sync_block_buffers;
+      size_t                                    sync_block_buffers_size = 0;
+
       channels::transaction_ack::channel_type::handle  incoming_transaction_ack_subscription;
 
       void connect( connection_ptr c );
       void connect( connection_ptr c, tcp::resolver::iterator endpoint_itr );
       bool start_session( connection_ptr c );
       void start_listen_loop( );
-      void start_read_message( connection_ptr c);
+      void start_read_message( connection_ptr c, uint32_t session );
+      bool process_read_buffer( const connection_ptr& c, uint32_t session );
+      void resume_read_message( const connection_ptr& c, uint32_t session );
+      void close_from_strand( const connection_ptr& c, uint32_t session, const string& reason, bool error = true );
 
       void   close( connection_ptr c );
       size_t count_open_sockets() const;
 
       template<typename VerifierFunc>
       void send_all( const net_message &msg, VerifierFunc verify );
+      template<typename VerifierFunc>
+      void send_all( const std::shared_ptr<vector<char>>& send_buffer, VerifierFunc verify );
+      std::shared_ptr<vector<char>> compress_send_buffer( const std::shared_ptr<vector<char>>& send_buffer );
 
       void accepted_block_header(const block_state_ptr&);
       void accepted_block(const block_state_ptr&);
@@ -218,7 +255,9 @@ namespace eosio {
       void handle_message( connection_ptr c, const request_message &msg);
       void handle_message( connection_ptr c, const sync_request_message &msg);
       void handle_message( connection_ptr c, const signed_block &msg);
+      void process_block( connection_ptr c, const signed_block_ptr& sbp, std::shared_ptr<vector<char>> received );
       void handle_message( connection_ptr c, const packed_transaction &msg);
+      void handle_message( connection_ptr c, const compressed_message &msg);
 
       void start_conn_timer(boost::asio::steady_timer::duration du, std::weak_ptr<connection> from_connection);
       void start_txn_timer( );
@@ -310,6 +349,11 @@ namespace eosio {
    constexpr auto     def_txn_expire_wait = std::chrono::seconds(3);
    constexpr auto     def_resp_expected_wait = std::chrono::seconds(5);
    constexpr auto     def_sync_fetch_span = 100;
+   constexpr auto     def_sync_fetch_peers = 8;
+   constexpr auto     def_compression_threshold = 1024;
+   constexpr auto     def_sync_block_buffers_size = 32*1024*1024; // bytes of sync blocks kept framed and compressed for peers
+   constexpr uint32_t def_max_pending_messages = 64; // per connection, reading pauses while this many unpacked messages wait for the main thread
+   constexpr uint16_t def_net_threads = 2;
    constexpr uint32_t  def_max_just_send = 1500; // roughly 1 "mtu"
    constexpr bool     large_msg_notify = false;
 
@@ -335,8 +379,9 @@ namespace eosio {
     */
    constexpr uint16_t proto_base = 0;
    constexpr uint16_t proto_explicit_sync = 1;
+   constexpr uint16_t proto_compressed_message = 2;  // able to receive compressed_message
 
-   constexpr uint16_t net_version = proto_explicit_sync;
+   constexpr uint16_t net_version = proto_compressed_message;
 
    /**
     *  Index by id
@@ -463,11 +508,23 @@ namespace eosio {
       peer_block_state_index  blk_state;
       transaction_state_index trx_state;
       optional<sync_state>    peer_requested;  // this peer is requesting info from us
+      /// keeps the io_context of the socket alive as long as the socket
+      std::shared_ptr<boost::asio::io_context> server_ioc;
       socket_ptr              socket;
+      /// the socket's operations and the parsing of what it reads run here, on the net thread pool and in order
+      boost::asio::io_context::strand strand;
 
+      /// only used on the strand
       fc::message_buffer<1024*1024>    pending_message_buffer;
       fc::optional<std::size_t>        outstanding_read_bytes;
-      vector<char>            blk_buffer;
+      /// framed copy of the last signed_block or packed_transaction received, so relaying it does not pack it again
+      std::shared_ptr<vector<char>> received_message;
+      /// bumped on close so reads, writes and messages still in flight for a previous session are dropped
+      std::atomic<uint32_t>   session{0};
+      /// messages of this session parsed on the strand and not handled on the main thread yet
+      std::atomic<uint32_t>   pending_messages{0};
+      /// set on the strand while reading stops because pending_messages reached def_max_pending_messages
+      bool                    read_paused = false;
 
       struct queued_write {
          std::shared_ptr<vector<char>> buff;
@@ -479,6 +536,7 @@ namespace eosio {
       handshake_message       last_handshake_recv;
       handshake_message       last_handshake_sent;
       int16_t                 sent_handshake_count = 0;
+      double                  sync_blocks_per_sec = 0; ///< measured on the sync chunks this peer delivered, 0 until measured
       bool                    connecting = false;
       bool                    syncing = false;
       uint16_t                protocol_version  = 0;
@@ -558,6 +616,11 @@ namespace eosio {
       void stop_send();
 
       void enqueue( const net_message &msg, bool trigger_send = true );
+      /// queues an already framed message, the buffer may be shared with other connections
+      void enqueue_buffer( const std::shared_ptr<vector<char>>& send_buffer, bool trigger_send = true,
+                           go_away_reason close_after_send = no_reason );
+      void enqueue_packed_block( uint32_t block_num, const packed_block_span& packed, bool trigger_send = true );
+      std::shared_ptr<vector<char>> compress_for_peer( const std::shared_ptr<vector<char>>& send_buffer );
       void cancel_sync(go_away_reason);
       void flush_queues();
       bool enqueue_sync_block();
@@ -579,11 +642,13 @@ namespace eosio {
        * Process the next message from the pending_message_buffer.
        * message_length is the already determined length of the data
        * part of the message and impl in the net plugin implementation
-       * that will handle the message.
+       * that will handle the message. Runs on the strand, the unpacked
+       * message is handled on the main thread unless session was closed.
        * Returns true is successful. Returns false if an error was
-       * encountered unpacking or processing the message.
+       * encountered unpacking the message.
        */
-      bool process_next_message(net_plugin_impl& impl, uint32_t message_length);
+      bool process_next_message(net_plugin_impl& impl, uint32_t message_length, uint32_t session);
+      void handle_unpacked_message(net_plugin_impl& impl, const std::shared_ptr<vector<char>>& message, const net_message& msg);
 
       bool add_peer_block(const peer_block_state &pbs);
 
@@ -633,29 +698,48 @@ namespace eosio {
          in_sync
       };
 
+      /// a range of blocks requested from one peer
+      struct sync_chunk {
+         uint32_t       start = 0;
+         uint32_t       end = 0;
+         uint32_t       last_received = 0;
+         fc::time_point requested;
+      };
+
       uint32_t       sync_known_lib_num;
       uint32_t       sync_last_requested_num;
       uint32_t       sync_next_expected_num;
       uint32_t       sync_req_span;
-      connection_ptr source;
+      uint32_t       sync_fetch_peers;
       stages         state;
 
+      /// chunks in flight, at most one per peer
+      std::map<connection_ptr, sync_chunk>  sync_chunks;
+      /// first to last block of ranges left unfinished by a peer, requested again before new ranges
+      std::map<uint32_t, uint32_t>          sync_retry_ranges;
+      /// blocks received ahead of sync_next_expected_num, applied once the blocks before them are
+      std::map<uint32_t, std::pair<connection_ptr, signed_block_ptr>> sync_reassembly;
+
       chain_plugin* chain_plug = nullptr;
 
       constexpr auto stage_str(stages s );
+      void reset_chunks();
+      void release_chunk(connection_ptr c);
 
    public:
-      explicit sync_manager(uint32_t span);
+      sync_manager(uint32_t span, uint32_t fetch_peers);
       void set_state(stages s);
       bool sync_required();
       void send_handshakes();
       bool is_active(connection_ptr conn);
       void reset_lib_num(connection_ptr conn);
-      void request_next_chunk(connection_ptr conn = connection_ptr() );
+      void request_next_chunk();
       void start_sync(connection_ptr c, uint32_t target);
       void reassign_fetch(connection_ptr c, go_away_reason reason);
       void verify_catchup(connection_ptr c, uint32_t num, block_id_type id);
       void rejected_block(connection_ptr c, uint32_t blk_num);
+      bool sync_block_ready(connection_ptr c, const signed_block_ptr& b);
+      bool next_buffered_block(connection_ptr& c, signed_block_ptr& b);
       void recv_block(connection_ptr c, const block_id_type &blk_id, uint32_t blk_num);
       void recv_handshake(connection_ptr c, const handshake_message& msg);
       void recv_notice(connection_ptr c, const notice_message& msg);
@@ -670,7 +754,11 @@ namespace eosio {
       std::multimap<block_id_type, connection_ptr> received_blocks;
       std::multimap<transaction_id_type, connection_ptr> received_transactions;
 
-      void bcast_transaction (const packed_transaction& msg);
+      /// the block being accepted and the bytes it was received in, relayed as is by bcast_block
+      block_id_type                 relay_block_id;
+      std::shared_ptr<vector<char>> relay_block_buffer;
+
+      void bcast_transaction (const packed_transaction& msg, std::shared_ptr<vector<char>> send_buffer = {});
       void rejected_transaction (const transaction_id_type& msg);
       void bcast_block (const signed_block& msg);
       void rejected_block (const block_id_type &id);
@@ -688,7 +776,9 @@ namespace eosio {
       : blk_state(),
         trx_state(),
         peer_requested(),
-        socket( std::make_shared<tcp::socket>( std::ref( app().get_io_service() ))),
+        server_ioc( my_impl->server_ioc ),
+        socket( std::make_shared<tcp::socket>( std::ref( *server_ioc ))),
+        strand( *server_ioc ),
         node_id(),
         last_handshake_recv(),
         last_handshake_sent(),
@@ -712,7 +802,9 @@ namespace eosio {
       : blk_state(),
         trx_state(),
         peer_requested(),
+        server_ioc( my_impl->server_ioc ),
         socket( s ),
+        strand( *server_ioc ),
         node_id(),
         last_handshake_recv(),
         last_handshake_sent(),
@@ -759,13 +851,21 @@ namespace eosio {
    }
 
    void connection::close() {
-      if(socket) {
-         socket->close();
-      }
-      else {
-         wlog("no socket to close!");
-      }
+      ++session;
+      // the socket and the read buffer belong to the strand, reads and writes still pending there are aborted
+      boost::asio::post( strand, [conn = shared_from_this()]() {
+         if(conn->socket) {
+            conn->socket->close();
+         }
+         else {
+            wlog("no socket to close!");
+         }
+         conn->pending_message_buffer.reset();
+         conn->outstanding_read_bytes.reset();
+         conn->read_paused = false;
+      });
       flush_queues();
+      pending_messages = 0;
       connecting = false;
       syncing = false;
       if( last_req ) {
@@ -778,12 +878,11 @@ namespace eosio {
       my_impl->sync_master->reset_lib_num(shared_from_this());
       fc_dlog(logger, "canceling wait on ${p}", ("p",peer_name()));
       cancel_wait();
-      pending_message_buffer.reset();
    }
 
    void connection::txn_send_pending(const vector<transaction_id_type> &ids) {
       for(auto tx = my_impl->local_txns.begin(); tx != my_impl->local_txns.end(); ++tx ){
-         if(tx->serialized_txn.size() && tx->block_num == 0) {
+         if(tx->serialized_txn && tx->block_num == 0) {
             bool found = false;
             for(auto known : ids) {
                if( known == tx->id) {
@@ -793,7 +892,7 @@ namespace eosio {
             }
             if(!found) {
                my_impl->local_txns.modify(tx,incr_in_flight);
-               queue_write(std::make_shared<vector<char>>(tx->serialized_txn),
+               queue_write(tx->serialized_txn,
                            true,
                            [tx_id=tx->id](boost::system::error_code ec, std::size_t ) {
                               auto& local_txns = my_impl->local_txns;
@@ -812,9 +911,9 @@ namespace eosio {
    void connection::txn_send(const vector<transaction_id_type> &ids) {
       for(auto t : ids) {
          auto tx = my_impl->local_txns.get<by_id>().find(t);
-         if( tx != my_impl->local_txns.end() && tx->serialized_txn.size()) {
+         if( tx != my_impl->local_txns.end() && tx->serialized_txn) {
             my_impl->local_txns.modify( tx,incr_in_flight);
-            queue_write(std::make_shared<vector<char>>(tx->serialized_txn),
+            queue_write(tx->serialized_txn,
                         true,
                         [t](boost::system::error_code ec, std::size_t ) {
                            auto& local_txns = my_impl->local_txns;
@@ -1003,49 +1102,62 @@ namespace eosio {
          out_queue.push_back(m);
          write_queue.pop_front();
       }
-      boost::asio::async_write(*socket, bufs, [c](boost::system::error_code ec, std::size_t w) {
-            try {
-               auto conn = c.lock();
-               if(!conn)
-                  return;
+      // written on the strand, the buffers stay in out_queue until the completion is handled on the main thread
+      boost::asio::post(strand, [conn = shared_from_this(), bufs, this_session = session.load()]() {
+         boost::asio::async_write(*conn->socket, bufs, boost::asio::bind_executor(conn->strand,
+               [conn, this_session](boost::system::error_code ec, std::size_t w) {
+            app().get_io_service().post([c = connection_wptr(conn), this_session, ec, w]() {
+               try {
+                  auto conn = c.lock();
+                  if(!conn)
+                     return;
 
-               for (auto& m: conn->out_queue) {
-                  m.callback(ec, w);
-               }
+                  if(conn->session != this_session) {
+                     // written to a closed session, the new session starts its own writes
+                     conn->out_queue.clear();
+                     conn->do_queue_write();
+                     return;
+                  }
 
-               if(ec) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  if( ec.value() != boost::asio::error::eof) {
-                     elog("Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()));
+                  for (auto& m: conn->out_queue) {
+                     m.callback(ec, w);
                   }
-                  else {
-                     ilog("connection closure detected on write to ${p}",("p",pname));
+
+                  if(ec) {
+                     string pname = conn ? conn->peer_name() : "no connection name";
+                     if( ec.value() != boost::asio::error::eof) {
+                        elog("Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()));
+                     }
+                     else {
+                        ilog("connection closure detected on write to ${p}",("p",pname));
+                     }
+                     my_impl->close(conn);
+                     return;
                   }
-                  my_impl->close(conn);
-                  return;
+                  while (conn->out_queue.size() > 0) {
+                     conn->out_queue.pop_front();
+                  }
+                  conn->enqueue_sync_block();
+                  conn->do_queue_write();
                }
-               while (conn->out_queue.size() > 0) {
-                  conn->out_queue.pop_front();
+               catch(const std::exception &ex) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()));
                }
-               conn->enqueue_sync_block();
-               conn->do_queue_write();
-            }
-            catch(const std::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()));
-            }
-            catch(const fc::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()));
-            }
-            catch(...) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               elog("Exception in do_queue_write to ${p}", ("p",pname) );
-            }
-         });
+               catch(const fc::exception &ex) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  elog("Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()));
+               }
+               catch(...) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  elog("Exception in do_queue_write to ${p}", ("p",pname) );
+               }
+            });
+         }));
+      });
    }
 
    void connection::cancel_sync(go_away_reason reason) {
@@ -1076,6 +1188,12 @@ namespace eosio {
          peer_requested.reset();
       }
       try {
+         // irreversible blocks are forwarded as stored in the block log, without an unpack/pack round trip
+         auto packed = cc.fetch_packed_block_by_number(num);
+         if(packed) {
+            enqueue_packed_block( num, packed, trigger_send );
+            return true;
+         }
          signed_block_ptr sb = cc.fetch_block_by_number(num);
          if(sb) {
             enqueue( *sb, trigger_send);
@@ -1087,12 +1205,7 @@ namespace eosio {
       return false;
    }
 
-   void connection::enqueue( const net_message &m, bool trigger_send ) {
-      go_away_reason close_after_send = no_reason;
-      if (m.contains<go_away_message>()) {
-         close_after_send = m.get<go_away_message>().reason;
-      }
-
+   static std::shared_ptr<vector<char>> create_send_buffer( const net_message& m ) {
       uint32_t payload_size = fc::raw::pack_size( m );
       char * header = reinterpret_cast<char*>(&payload_size);
       size_t header_size = sizeof(payload_size);
@@ -1103,8 +1216,98 @@ namespace eosio {
       fc::datastream<char*> ds( send_buffer->data(), buffer_size);
       ds.write( header, header_size );
       fc::raw::pack( ds, m );
+      return send_buffer;
+   }
+
+   // frames m exactly as packing a net_message holding it would, without copying m into a net_message
+   template<typename T>
+   static std::shared_ptr<vector<char>> create_send_buffer( const T& m ) {
+      const unsigned_int which = net_message::tag<T>::value;
+      uint32_t payload_size = fc::raw::pack_size( which ) + fc::raw::pack_size( m );
+      char * header = reinterpret_cast<char*>(&payload_size);
+      size_t header_size = sizeof(payload_size);
+
+      size_t buffer_size = header_size + payload_size;
+
+      auto send_buffer = std::make_shared<vector<char>>(buffer_size);
+      fc::datastream<char*> ds( send_buffer->data(), buffer_size);
+      ds.write( header, header_size );
+      fc::raw::pack( ds, which );
+      fc::raw::pack( ds, m );
+      return send_buffer;
+   }
+
+   namespace bio = boost::iostreams;
+
+   static vector<char> zlib_compress( const char* data, size_t size ) {
+      vector<char>           out;
+      bio::filtering_ostream comp;
+      comp.push( bio::zlib_compressor( bio::zlib::best_speed ) );
+      comp.push( bio::back_inserter( out ) );
+      bio::write( comp, data, size );
+      bio::close( comp );
+      return out;
+   }
+
+   // fails instead of inflating more than max_size bytes
+   static vector<char> zlib_decompress( const vector<char>& in, size_t max_size ) {
+      vector<char>           out;
+      bio::filtering_istream decomp;
+      decomp.push( bio::zlib_decompressor() );
+      decomp.push( bio::array_source( in.data(), in.size() ) );
+      char buffer[64*1024];
+      while( decomp ) {
+         decomp.read( buffer, sizeof(buffer) );
+         out.insert( out.end(), buffer, buffer + decomp.gcount() );
+         EOS_ASSERT( out.size() <= max_size, plugin_exception,
+                     "compressed message inflates to more than ${m} bytes", ("m", max_size) );
+      }
+      return out;
+   }
+
+   std::shared_ptr<vector<char>> net_plugin_impl::compress_send_buffer( const std::shared_ptr<vector<char>>& send_buffer ) {
+      if( send_buffer == last_uncompressed_buffer ) {
+         return last_compressed_buffer;
+      }
+      const size_t header_size = sizeof(uint32_t);
+      auto compressed = zlib_compress( send_buffer->data() + header_size, send_buffer->size() - header_size );
+      auto result = send_buffer;
+      // repetitive action data usually shrinks a lot, keep the original when it does not
+      if( compressed.size() < (send_buffer->size() - header_size) * 9 / 10 ) {
+         result = create_send_buffer( compressed_message{ std::move(compressed) } );
+      }
+      last_uncompressed_buffer = send_buffer;
+      last_compressed_buffer = result;
+      return result;
+   }
+
+   std::shared_ptr<vector<char>> connection::compress_for_peer( const std::shared_ptr<vector<char>>& send_buffer ) {
+      const size_t header_size = sizeof(uint32_t);
+      if( my_impl->compression_threshold == 0 || send_buffer->size() < my_impl->compression_threshold ||
+          protocol_version < proto_compressed_message ) {
+         return send_buffer;
+      }
+      // net_message tags are below 0x80, so the first payload byte is the whole tag
+      const auto which = static_cast<uint8_t>( (*send_buffer)[header_size] );
+      if( which != net_message::tag<signed_block>::value && which != net_message::tag<packed_transaction>::value ) {
+         return send_buffer;
+      }
+      return my_impl->compress_send_buffer( send_buffer );
+   }
+
+   void connection::enqueue( const net_message &m, bool trigger_send ) {
+      go_away_reason close_after_send = no_reason;
+      if (m.contains<go_away_message>()) {
+         close_after_send = m.get<go_away_message>().reason;
+      }
+
+      enqueue_buffer( create_send_buffer( m ), trigger_send, close_after_send );
+   }
+
+   void connection::enqueue_buffer( const std::shared_ptr<vector<char>>& send_buffer, bool trigger_send,
+                                    go_away_reason close_after_send ) {
       connection_wptr weak_this = shared_from_this();
-      queue_write(send_buffer,trigger_send,
+      queue_write(compress_for_peer(send_buffer),trigger_send,
                   [weak_this, close_after_send](boost::system::error_code ec, std::size_t ) {
                      connection_ptr conn = weak_this.lock();
                      if (conn) {
@@ -1119,6 +1322,56 @@ namespace eosio {
                   });
    }
 
+   void connection::enqueue_packed_block( uint32_t block_num, const packed_block_span& packed, bool trigger_send ) {
+      // blocks in the block log never change, peers syncing through the same range share their buffers
+      auto& buffers = my_impl->sync_block_buffers;
+      auto itr = buffers.find( block_num );
+      if( itr == buffers.end() ) {
+         // frame the packed signed_block exactly as packing a net_message holding it would
+         const unsigned_int which = net_message::tag<signed_block>::value;
+         uint32_t payload_size = fc::raw::pack_size( which ) + packed.size;
+         char * header = reinterpret_cast<char*>(&payload_size);
+         size_t header_size = sizeof(payload_size);
+
+         size_t buffer_size = header_size + payload_size;
+
+         auto framed = std::make_shared<vector<char>>(buffer_size);
+         fc::datastream<char*> ds( framed->data(), buffer_size);
+         ds.write( header, header_size );
+         fc::raw::pack( ds, which );
+         ds.write( packed.data, packed.size );
+
+         // peers sync upwards, so the lowest blocks are dropped first
+         while( !buffers.empty() && my_impl->sync_block_buffers_size + buffer_size > def_sync_block_buffers_size ) {
+            const auto& oldest = buffers.begin()->second;
+            my_impl->sync_block_buffers_size -= oldest.framed->size();
+            if( oldest.compressed && oldest.compressed != oldest.framed )
+               my_impl->sync_block_buffers_size -= oldest.compressed->size();
+            buffers.erase( buffers.begin() );
+         }
+         itr = buffers.emplace( block_num, net_plugin_impl::sync_block_buffer{ framed, {} } ).first;
+         my_impl->sync_block_buffers_size += buffer_size;
+      }
+
+      auto& cached = itr->second;
+      auto send_buffer = cached.framed;
+      if( protocol_version >= proto_compressed_message ) {
+         if( !cached.compressed ) {
+            cached.compressed = compress_for_peer( cached.framed );
+            if( cached.compressed != cached.framed )
+               my_impl->sync_block_buffers_size += cached.compressed->size();
+         }
+         send_buffer = cached.compressed;
+      }
+      connection_wptr weak_this = shared_from_this();
+      queue_write(send_buffer,trigger_send,
+                  [weak_this](boost::system::error_code ec, std::size_t ) {
+                     if (!weak_this.lock()) {
+                        fc_wlog(logger, "connection expired before enqueued packed block called callback!");
+                     }
+                  });
+   }
+
    void connection::cancel_wait() {
       if (response_expected)
          response_expected->cancel();
@@ -1195,9 +1448,9 @@ namespace eosio {
       sync_wait();
    }
 
-   bool connection::process_next_message(net_plugin_impl& impl, uint32_t message_length) {
+   bool connection::process_next_message(net_plugin_impl& impl, uint32_t message_length, uint32_t session) {
       try {
-         // If it is a signed_block, then save the raw message for the cache
+         // If it is a signed_block or a packed_transaction, then keep the framed message for relaying it.
          // This must be done before we unpack the message.
          // This code is copied from fc::io::unpack(..., unsigned_int)
          auto index = pending_message_buffer.read_index();
@@ -1208,22 +1461,85 @@ namespace eosio {
             by += 7;
          } while( uint8_t(b) & 0x80 && by < 32);
 
-         if (which == uint64_t(net_message::tag<signed_block>::value)) {
-            blk_buffer.resize(message_length);
+         std::shared_ptr<vector<char>> received;
+         if( which == uint64_t(net_message::tag<signed_block>::value) ||
+             which == uint64_t(net_message::tag<packed_transaction>::value) ) {
+            received = std::make_shared<vector<char>>(sizeof(message_length) + message_length);
+            memcpy(received->data(), &message_length, sizeof(message_length));
             auto index = pending_message_buffer.read_index();
-            pending_message_buffer.peek(blk_buffer.data(), message_length, index);
+            pending_message_buffer.peek(received->data() + sizeof(message_length), message_length, index);
          }
+
+         auto msg = std::make_shared<net_message>();
+         const auto bytes_to_read = pending_message_buffer.bytes_to_read();
          auto ds = pending_message_buffer.create_datastream();
-         net_message msg;
-         fc::raw::unpack(ds, msg);
+         fc::raw::unpack( ds, *msg );
+         EOS_ASSERT( bytes_to_read - pending_message_buffer.bytes_to_read() == message_length, plugin_exception,
+                     "message of ${n} bytes has a length of ${l}",
+                     ("n", bytes_to_read - pending_message_buffer.bytes_to_read())("l", message_length) );
+         if( msg->contains<compressed_message>() ) {
+            // inflated here, handled and relayed as if it had been received uncompressed
+            auto payload = zlib_decompress( msg->get<compressed_message>().data, def_send_buffer_size*2 );
+            uint32_t payload_size = payload.size();
+            received = std::make_shared<vector<char>>( sizeof(payload_size) + payload.size() );
+            memcpy( received->data(), &payload_size, sizeof(payload_size) );
+            memcpy( received->data() + sizeof(payload_size), payload.data(), payload.size() );
+            fc::datastream<const char*> inflated( payload.data(), payload.size() );
+            fc::raw::unpack( inflated, *msg );
+            EOS_ASSERT( !msg->contains<compressed_message>(), plugin_exception, "nested compressed message" );
+         }
+         if( msg->contains<packed_transaction>() ) {
+            // recover the signing keys here, into the shared recovery cache, so applying the transaction hits it
+            try {
+               msg->get<packed_transaction>().get_signature_keys( impl.chain_id );
+            } catch( ... ) {
+               // invalid signatures are reported when the transaction is applied
+            }
+         }
+
+         ++pending_messages;
+         app().get_io_service().post( [&impl, conn = shared_from_this(), session, received, msg]() {
+            if( conn->session != session || !conn->socket || !conn->socket->is_open() ) {
+               return;
+            }
+            const auto pending = --conn->pending_messages;
+            conn->handle_unpacked_message( impl, received, *msg );
+            if( pending == def_max_pending_messages / 2 ) {
+               // reading may have paused at def_max_pending_messages, it resumes on the strand
+               boost::asio::post( conn->strand, [&impl, conn, session]() {
+                  if( conn->session == session && conn->read_paused ) {
+                     impl.resume_read_message( conn, session );
+                  }
+               });
+            }
+         });
+      } catch( const fc::exception& e ) {
+         impl.close_from_strand( shared_from_this(), session, "Error unpacking message: " + e.to_detail_string() );
+         return false;
+      } catch( const std::exception& e ) {
+         impl.close_from_strand( shared_from_this(), session, string("Error unpacking message: ") + e.what() );
+         return false;
+      }
+      return true;
+   }
+
+   void connection::handle_unpacked_message(net_plugin_impl& impl, const std::shared_ptr<vector<char>>& message, const net_message& msg) {
+      try {
+         // keep the raw signed_block or packed_transaction for relaying it
+         if( msg.contains<signed_block>() || msg.contains<packed_transaction>() ) {
+            received_message = message;
+         } else {
+            received_message.reset();
+         }
          msgHandler m(impl, shared_from_this() );
          msg.visit(m);
       } catch(  const fc::exception& e ) {
          edump((e.to_detail_string() ));
          impl.close( shared_from_this() );
-         return false;
+      } catch( const std::exception& e ) {
+         elog( "Exception handling message from ${p}: ${s}", ("p", peer_name())("s", e.what()) );
+         impl.close( shared_from_this() );
       }
-      return true;
    }
 
    bool connection::add_peer_block(const peer_block_state &entry) {
@@ -1246,12 +1562,12 @@ namespace eosio {
 
    //-----------------------------------------------------------
 
-    sync_manager::sync_manager( uint32_t req_span )
+    sync_manager::sync_manager( uint32_t req_span, uint32_t fetch_peers )
       :sync_known_lib_num( 0 )
       ,sync_last_requested_num( 0 )
       ,sync_next_expected_num( 1 )
       ,sync_req_span( req_span )
-      ,source()
+      ,sync_fetch_peers( fetch_peers )
       ,state(in_sync)
    {
       chain_plug = app( ).find_plugin<chain_plugin>( );
@@ -1285,16 +1601,33 @@ namespace eosio {
       return state != in_sync;
    }
 
+   void sync_manager::reset_chunks() {
+      sync_chunks.clear();
+      sync_retry_ranges.clear();
+      sync_reassembly.clear();
+   }
+
+   void sync_manager::release_chunk(connection_ptr c) {
+      auto chunk = sync_chunks.find(c);
+      if( chunk == sync_chunks.end() ) {
+         return;
+      }
+      if( chunk->second.last_received < chunk->second.end ) {
+         sync_retry_ranges[chunk->second.last_received + 1] = chunk->second.end;
+      }
+      sync_chunks.erase(chunk);
+   }
+
    void sync_manager::reset_lib_num(connection_ptr c) {
       if(state == in_sync) {
-         source.reset();
+         reset_chunks();
       }
       if( c->current() ) {
          if( c->last_handshake_recv.last_irreversible_block_num > sync_known_lib_num) {
             sync_known_lib_num =c->last_handshake_recv.last_irreversible_block_num;
          }
-      } else if( c == source ) {
-         sync_last_requested_num = 0;
+      } else if( sync_chunks.count(c) ) {
+         release_chunk(c);
          request_next_chunk();
       }
    }
@@ -1307,86 +1640,74 @@ namespace eosio {
               chain_plug->chain( ).fork_db_head_block_num( ) < sync_last_requested_num );
    }
 
-   void sync_manager::request_next_chunk( connection_ptr conn ) {
-      uint32_t head_block = chain_plug->chain().fork_db_head_block_num();
-
-      if (head_block < sync_last_requested_num && source && source->current()) {
-         fc_ilog (logger, "ignoring request, head is ${h} last req = ${r} source is ${p}",
-                  ("h",head_block)("r",sync_last_requested_num)("p",source->peer_name()));
-         return;
-      }
-
+   void sync_manager::request_next_chunk() {
       /* ----------
-       * next chunk provider selection criteria
-       * a provider is supplied and able to be used, use it.
-       * otherwise select the next available from the list, round-robin style.
+       * chunk provider selection criteria
+       * every current peer without a chunk in flight is able to take one, up to sync_fetch_peers of them.
+       * peers not measured yet go first, then the fastest, so the lowest ranges (which hold up applying
+       * the blocks after them) go to the peers most likely to deliver them soon.
        */
-
-      if (conn && conn->current() ) {
-         source = conn;
-      }
-      else {
-         if (my_impl->connections.size() == 1) {
-            if (!source) {
-               source = *my_impl->connections.begin();
-            }
-         }
-         else {
-            // init to a linear array search
-            auto cptr = my_impl->connections.begin();
-            auto cend = my_impl->connections.end();
-            // do we remember the previous source?
-            if (source) {
-               //try to find it in the list
-               cptr = my_impl->connections.find(source);
-               cend = cptr;
-               if (cptr == my_impl->connections.end()) {
-                  //not there - must have been closed! cend is now connections.end, so just flatten the ring.
-                  source.reset();
-                  cptr = my_impl->connections.begin();
-               } else {
-                  //was found - advance the start to the next. cend is the old source.
-                  if (++cptr == my_impl->connections.end() && cend != my_impl->connections.end() ) {
-                     cptr = my_impl->connections.begin();
-                  }
-               }
-            }
-
-            //scan the list of peers looking for another able to provide sync blocks.
-            auto cstart_it = cptr;
-            do {
-               //select the first one which is current and break out.
-               if((*cptr)->current()) {
-                  source = *cptr;
-                  break;
-               }
-               if(++cptr == my_impl->connections.end())
-                     cptr = my_impl->connections.begin();
-            } while(cptr != cstart_it);
-            // no need to check the result, either source advanced or the whole list was checked and the old source is reused.
+      vector<connection_ptr> idle;
+      for( const auto& c : my_impl->connections ) {
+         if( c->current() && sync_chunks.find(c) == sync_chunks.end() ) {
+            idle.push_back(c);
          }
       }
 
       // verify there is an available source
-      if (!source || !source->current() ) {
+      if( idle.empty() && sync_chunks.empty() ) {
          elog("Unable to continue syncing at this time");
          sync_known_lib_num = chain_plug->chain().last_irreversible_block_num();
          sync_last_requested_num = 0;
+         reset_chunks();
          set_state(in_sync); // probably not, but we can't do anything else
          return;
       }
 
-      if( sync_last_requested_num != sync_known_lib_num ) {
-         uint32_t start = sync_next_expected_num;
-         uint32_t end = start + sync_req_span - 1;
-         if( end > sync_known_lib_num )
-            end = sync_known_lib_num;
-         if( end > 0 && end >= start ) {
-            fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
-                    ("n",source->peer_name())("s",start)("e",end));
-            source->request_sync_blocks(start, end);
+      std::stable_sort( idle.begin(), idle.end(), []( const connection_ptr& a, const connection_ptr& b ) {
+         if( a->sync_blocks_per_sec == 0 || b->sync_blocks_per_sec == 0 ) {
+            return a->sync_blocks_per_sec == 0 && b->sync_blocks_per_sec != 0;
+         }
+         return a->sync_blocks_per_sec > b->sync_blocks_per_sec;
+      } );
+
+      // bound the blocks held in sync_reassembly while a range before them is outstanding
+      uint64_t window_end = uint64_t(sync_next_expected_num) + uint64_t(sync_req_span) * sync_fetch_peers * 2 - 1;
+      if( window_end > sync_known_lib_num )
+         window_end = sync_known_lib_num;
+
+      for( const auto& c : idle ) {
+         if( sync_chunks.size() >= sync_fetch_peers ) {
+            break;
+         }
+         while( !sync_retry_ranges.empty() && sync_retry_ranges.begin()->second < sync_next_expected_num ) {
+            sync_retry_ranges.erase( sync_retry_ranges.begin() );
+         }
+
+         uint32_t start = 0;
+         uint32_t end = 0;
+         if( !sync_retry_ranges.empty() ) {
+            auto range = sync_retry_ranges.begin();
+            uint32_t range_end = range->second;
+            start = std::max( range->first, sync_next_expected_num );
+            end = std::min( range_end, start + sync_req_span - 1 );
+            sync_retry_ranges.erase( range );
+            if( end < range_end ) {
+               sync_retry_ranges[end + 1] = range_end;
+            }
+         } else {
+            start = std::max( sync_last_requested_num + 1, sync_next_expected_num );
+            end = std::min<uint64_t>( uint64_t(start) + sync_req_span - 1, window_end );
+            if( end < start ) {
+               break;
+            }
             sync_last_requested_num = end;
          }
+
+         fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
+                 ("n",c->peer_name())("s",start)("e",end));
+         sync_chunks[c] = sync_chunk{ start, end, start - 1, fc::time_point::now() };
+         c->request_sync_blocks(start, end);
       }
    }
 
@@ -1420,16 +1741,18 @@ namespace eosio {
       fc_ilog(logger, "Catching up with chain, our last req is ${cc}, theirs is ${t} peer ${p}",
               ( "cc",sync_last_requested_num)("t",target)("p",c->peer_name()));
 
-      request_next_chunk(c);
+      request_next_chunk();
    }
 
    void sync_manager::reassign_fetch(connection_ptr c, go_away_reason reason) {
       fc_ilog(logger, "reassign_fetch, our last req is ${cc}, next expected is ${ne} peer ${p}",
               ( "cc",sync_last_requested_num)("ne",sync_next_expected_num)("p",c->peer_name()));
 
-      if (c == source) {
+      if( sync_chunks.count(c) ) {
          c->cancel_sync (reason);
-         sync_last_requested_num = 0;
+         release_chunk(c);
+         // score the peer as slow, so its range goes to another peer if there is one
+         c->sync_blocks_per_sec = std::max( c->sync_blocks_per_sec / 4, 0.001 );
          request_next_chunk();
       }
    }
@@ -1555,12 +1878,73 @@ namespace eosio {
       if (state != in_sync ) {
          fc_ilog (logger, "block ${bn} not accepted from ${p}",("bn",blk_num)("p",c->peer_name()));
          sync_last_requested_num = 0;
-         source.reset();
+         reset_chunks();
          my_impl->close(c);
          set_state(in_sync);
          send_handshakes();
       }
    }
+   bool sync_manager::sync_block_ready (connection_ptr c, const signed_block_ptr& b) {
+      uint32_t blk_num = b->block_num();
+      auto chunk = sync_chunks.find(c);
+      if( chunk != sync_chunks.end() ) {
+         if( blk_num != chunk->second.last_received + 1 ) {
+            fc_ilog (logger, "expected block ${ne} but got ${bn} from ${p}",
+                     ("ne",chunk->second.last_received + 1)("bn",blk_num)("p",c->peer_name()));
+            my_impl->close(c);
+            return false;
+         }
+         chunk->second.last_received = blk_num;
+         if( blk_num == chunk->second.end ) {
+            auto secs = double( (fc::time_point::now() - chunk->second.requested).count() ) / 1000000;
+            double rate = ( chunk->second.end - chunk->second.start + 1 ) / std::max( secs, 0.001 );
+            c->sync_blocks_per_sec = c->sync_blocks_per_sec == 0 ? rate : ( c->sync_blocks_per_sec * 3 + rate ) / 4;
+            fc_dlog(logger, "${p} delivered blocks ${s} to ${e} at ${r} blocks/sec",
+                    ("p",c->peer_name())("s",chunk->second.start)("e",chunk->second.end)("r",rate));
+            sync_chunks.erase(chunk);
+            if( state == lib_catchup ) {
+               request_next_chunk();
+            }
+         } else {
+            fc_dlog(logger,"calling sync_wait on connection ${p}",("p",c->peer_name()));
+            c->sync_wait();
+         }
+      } else if( state == lib_catchup && blk_num != sync_next_expected_num ) {
+         // not part of a chunk in flight, e.g. sent before the peer's range was given to another peer
+         if( blk_num > sync_next_expected_num && blk_num <= sync_last_requested_num ) {
+            sync_reassembly.emplace( blk_num, std::make_pair( c, b ) );
+         }
+         return false;
+      }
+
+      if( state != lib_catchup || blk_num == sync_next_expected_num ) {
+         return true;
+      }
+      if( blk_num > sync_next_expected_num ) {
+         sync_reassembly.emplace( blk_num, std::make_pair( c, b ) );
+      }
+      return false;
+   }
+
+   bool sync_manager::next_buffered_block (connection_ptr& c, signed_block_ptr& b) {
+      while( state == lib_catchup && !sync_reassembly.empty() ) {
+         auto next = sync_reassembly.begin();
+         if( next->first > sync_next_expected_num ) {
+            return false;
+         }
+         bool ready = next->first == sync_next_expected_num;
+         if( ready ) {
+            c = next->second.first;
+            b = next->second.second;
+         }
+         sync_reassembly.erase( next );
+         if( ready ) {
+            return true;
+         }
+      }
+      return false;
+   }
+
    void sync_manager::recv_block (connection_ptr c, const block_id_type &blk_id, uint32_t blk_num) {
       fc_dlog(logger," got block ${bn} from ${p}",("bn",blk_num)("p",c->peer_name()));
       if (state == lib_catchup) {
@@ -1574,7 +1958,7 @@ namespace eosio {
       if (state == head_catchup) {
          fc_dlog (logger, "sync_manager in head_catchup state");
          set_state(in_sync);
-         source.reset();
+         reset_chunks();
 
          block_id_type null_id;
          for (auto cp : my_impl->connections) {
@@ -1593,15 +1977,13 @@ namespace eosio {
       else if (state == lib_catchup) {
          if( blk_num == sync_known_lib_num ) {
             fc_dlog( logger, "All caught up with last known last irreversible block resending handshake");
+            reset_chunks();
             set_state(in_sync);
             send_handshakes();
          }
-         else if (blk_num == sync_last_requested_num) {
-            request_next_chunk();
-         }
          else {
-            fc_dlog(logger,"calling sync_wait on connection ${p}",("p",c->peer_name()));
-            c->sync_wait();
+            // the window of blocks that may be requested moved on
+            request_next_chunk();
          }
       }
    }
@@ -1616,11 +1998,15 @@ namespace eosio {
       }
       received_blocks.erase(range.first, range.second);
 
-      net_message msg(bsum);
-      uint32_t packsiz = fc::raw::pack_size(msg);
-      uint32_t msgsiz = packsiz + sizeof(packsiz);
-      notice_message pending_notify;
       block_id_type bid = bsum.id();
+      // the block is packed at most once and the same buffer is queued to every peer
+      std::shared_ptr<vector<char>> send_buffer;
+      if (relay_block_buffer && relay_block_id == bid) {
+         send_buffer = relay_block_buffer;
+      }
+      uint32_t msgsiz = send_buffer ? send_buffer->size()
+                                    : sizeof(uint32_t) + fc::raw::pack_size( unsigned_int(net_message::tag<signed_block>::value) ) + fc::raw::pack_size( bsum );
+      notice_message pending_notify;
       uint32_t bnum = bsum.block_num();
       pending_notify.known_blocks.mode = normal;
       pending_notify.known_blocks.ids.push_back( bid );
@@ -1648,7 +2034,10 @@ namespace eosio {
                continue;
             }
             cp->add_peer_block(pbstate);
-            cp->enqueue( bsum );
+            if (!send_buffer) {
+               send_buffer = create_send_buffer( bsum );
+            }
+            cp->enqueue_buffer( send_buffer );
          }
       }
    }
@@ -1674,7 +2063,7 @@ namespace eosio {
       received_blocks.erase(range.first, range.second);
    }
 
-   void dispatch_manager::bcast_transaction (const packed_transaction& trx) {
+   void dispatch_manager::bcast_transaction (const packed_transaction& trx, std::shared_ptr<vector<char>> send_buffer) {
       std::set<connection_ptr> skips;
       transaction_id_type id = trx.id();
 
@@ -1695,27 +2084,22 @@ namespace eosio {
          fc_dlog(logger, "found trxid in local_trxs" );
          return;
       }
-      uint32_t packsiz = 0;
-      uint32_t bufsiz = 0;
-
       time_point_sec trx_expiration = trx.expiration();
 
-      net_message msg(trx);
-      packsiz = fc::raw::pack_size(msg);
-      bufsiz = packsiz + sizeof(packsiz);
-      vector<char> buff(bufsiz);
-      fc::datastream<char*> ds( buff.data(), bufsiz);
-      ds.write( reinterpret_cast<char*>(&packsiz), sizeof(packsiz) );
-      fc::raw::pack( ds, msg );
+      // relayed in the bytes it was received in, or packed once, and shared by every peer and later requests
+      if( !send_buffer ) {
+         send_buffer = create_send_buffer( trx );
+      }
+      uint32_t bufsiz = send_buffer->size();
       node_transaction_state nts = {id,
                                     trx_expiration,
                                     trx,
-                                    std::move(buff),
+                                    send_buffer,
                                     0, 0, 0};
       my_impl->local_txns.insert(std::move(nts));
 
       if( !large_msg_notify || bufsiz <= just_send_it_max) {
-         my_impl->send_all( trx, [id, &skips, trx_expiration](connection_ptr c) -> bool {
+         my_impl->send_all( send_buffer, [id, &skips, trx_expiration](connection_ptr c) -> bool {
                if( skips.find(c) != skips.end() || c->syncing ) {
                   return false;
                }
@@ -1945,27 +2329,32 @@ namespace eosio {
       auto current_endpoint = *endpoint_itr;
       ++endpoint_itr;
       c->connecting = true;
-      connection_wptr weak_conn = c;
-      c->socket->async_connect( current_endpoint, [weak_conn, endpoint_itr, this] ( const boost::system::error_code& err ) {
-            auto c = weak_conn.lock();
-            if (!c) return;
-            if( !err && c->socket->is_open() ) {
-               if (start_session( c )) {
-                  c->send_handshake ();
-               }
-            } else {
-               if( endpoint_itr != tcp::resolver::iterator() ) {
-                  close(c);
-                  connect( c, endpoint_itr );
-               }
-               else {
-                  elog( "connection failed to ${peer}: ${error}",
-                        ( "peer", c->peer_name())("error",err.message()));
-                  c->connecting = false;
-                  my_impl->close(c); // 连接失败，关闭连接
+      // connected on the strand, the result is handled on the main thread
+      boost::asio::post( c->strand, [c, current_endpoint, endpoint_itr, this]() {
+         c->socket->async_connect( current_endpoint, boost::asio::bind_executor( c->strand,
+               [c, endpoint_itr, this]( const boost::system::error_code& err ) {
+            app().get_io_service().post( [weak_conn = connection_wptr( c ), endpoint_itr, err, this]() {
+               auto c = weak_conn.lock();
+               if (!c) return;
+               if( !err && c->socket->is_open() ) {
+                  if (start_session( c )) {
+                     c->send_handshake ();
+                  }
+               } else {
+                  if( endpoint_itr != tcp::resolver::iterator() ) {
+                     close(c);
+                     connect( c, endpoint_itr );
+                  }
+                  else {
+                     elog( "connection failed to ${peer}: ${error}",
+                           ( "peer", c->peer_name())("error",err.message()));
+                     c->connecting = false;
+                     my_impl->close(c); // 连接失败，关闭连接
+                  }
                }
-            }
-         } );
+            });
+         }));
+      });
    }
 
    // 开启连接，接收消息
@@ -1981,7 +2370,9 @@ namespace eosio {
          return false;
       }
       else {
-         start_read_message( con );
+         boost::asio::post( con->strand, [this, con, session = con->session.load()]() {
+            start_read_message( con, session );
+         });
          ++started_sessions; // 记录已经开启的session
          return true;
          // for now, we can just use the application main loop.
@@ -1992,7 +2383,7 @@ namespace eosio {
 
 
    void net_plugin_impl::start_listen_loop( ) {
-      auto socket = std::make_shared<tcp::socket>( std::ref( app().get_io_service() ) );
+      auto socket = std::make_shared<tcp::socket>( std::ref( *server_ioc ) );
       acceptor->async_accept( *socket, [socket,this]( boost::system::error_code ec ) {
             if( !ec ) { // 如果没出错
                uint32_t visitors = 0;
@@ -2057,14 +2448,90 @@ namespace eosio {
          });
    }
 
+   // runs on the connection's strand, logs why the connection is closed and closes it on the main thread unless
+   // session was closed already
+   void net_plugin_impl::close_from_strand( const connection_ptr& conn, uint32_t session, const string& reason, bool error ) {
+      app().get_io_service().post( [this, conn, session, reason, error]() {
+         if( conn->session != session ) {
+            return;
+         }
+         if( error ) {
+            elog( "${r}, closing connection to ${p}", ("r", reason)("p", conn->peer_name()) );
+         } else {
+            ilog( "${r}, closing connection to ${p}", ("r", reason)("p", conn->peer_name()) );
+         }
+         close( conn );
+      });
+   }
+
+   // parses the complete messages in the read buffer on the strand, returns false if the connection is being closed
+   bool net_plugin_impl::process_read_buffer( const connection_ptr& conn, uint32_t session ) {
+      while (conn->pending_message_buffer.bytes_to_read() > 0) {
+         if (conn->pending_messages >= def_max_pending_messages) {
+            // the rest of the buffer is parsed once enough of the pending messages are handled
+            conn->read_paused = true;
+            break;
+         }
+         uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
+
+         if (bytes_in_buffer < message_header_size) {
+            conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
+            break;
+         } else {
+            uint32_t message_length;
+            auto index = conn->pending_message_buffer.read_index();
+            conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
+            if(message_length > def_send_buffer_size*2 || message_length == 0) {
+               close_from_strand(conn, session, "incoming message length unexpected (" + std::to_string(message_length) + ")");
+               return false;
+            }
+
+            auto total_message_bytes = message_length + message_header_size;
+
+            if (bytes_in_buffer >= total_message_bytes) {
+               conn->pending_message_buffer.advance_read_ptr(message_header_size);
+               if (!conn->process_next_message(*this, message_length, session)) {
+                  return false;
+               }
+            } else {
+               auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
+               auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
+               if (outstanding_message_bytes > available_buffer_bytes) {
+                  conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
+               }
+
+               conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
+               break;
+            }
+         }
+      }
+      return true;
+   }
+
+   void net_plugin_impl::resume_read_message( const connection_ptr& conn, uint32_t session ) {
+      conn->read_paused = false;
+      try {
+         if (!process_read_buffer(conn, session) || conn->read_paused) {
+            return;
+         }
+      } catch (const std::exception& ex) {
+         close_from_strand( conn, session, string("Exception in handling read data: ") + ex.what() );
+         return;
+      } catch (const fc::exception& ex) {
+         close_from_strand( conn, session, "Exception in handling read data: " + ex.to_string() );
+         return;
+      }
+      start_read_message(conn, session);
+   }
+
    // 开始读取session的消息
-   void net_plugin_impl::start_read_message( connection_ptr conn ) {
+   // runs on the connection's strand, the read completes there too and only the unpacked messages go to the main thread
+   void net_plugin_impl::start_read_message( connection_ptr conn, uint32_t session ) {
 
       try {
-         if(!conn->socket) {
+         if(!conn->socket || conn->session != session) {
             return;
          }
-         connection_wptr weak_conn = conn;
 
          std::size_t minimum_read = conn->outstanding_read_bytes ? *conn->outstanding_read_bytes : message_header_size;
 
@@ -2085,9 +2552,9 @@ namespace eosio {
 
          boost::asio::async_read(*conn->socket,
             conn->pending_message_buffer.get_buffer_sequence_for_boost_async_read(), completion_handler,
-            [this,weak_conn]( boost::system::error_code ec, std::size_t bytes_transferred ) {
-               auto conn = weak_conn.lock();
-               if (!conn) {
+            boost::asio::bind_executor( conn->strand,
+            [this,conn,session]( boost::system::error_code ec, std::size_t bytes_transferred ) {
+               if (conn->session != session) {
                   return;
                }
 
@@ -2101,73 +2568,30 @@ namespace eosio {
                      }
                      EOS_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
                      conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
-                     while (conn->pending_message_buffer.bytes_to_read() > 0) {
-                        uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
-
-                        if (bytes_in_buffer < message_header_size) {
-                           conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
-                           break;
-                        } else {
-                           uint32_t message_length;
-                           auto index = conn->pending_message_buffer.read_index();
-                           conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
-                           if(message_length > def_send_buffer_size*2 || message_length == 0) {
-                              boost::system::error_code ec;
-                              elog("incoming message length unexpected (${i}), from ${p}", ("i", message_length)("p",boost::lexical_cast<std::string>(conn->socket->remote_endpoint(ec))));
-                              close(conn);
-                              return;
-                           }
-
-                           auto total_message_bytes = message_length + message_header_size;
-
-                           if (bytes_in_buffer >= total_message_bytes) {
-                              conn->pending_message_buffer.advance_read_ptr(message_header_size);
-                              if (!conn->process_next_message(*this, message_length)) {
-                                 return;
-                              }
-                           } else {
-                              auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
-                              auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
-                              if (outstanding_message_bytes > available_buffer_bytes) {
-                                 conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
-                              }
-
-                              conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
-                              break;
-                           }
-                        }
+                     if (!process_read_buffer(conn, session) || conn->read_paused) {
+                        return;
                      }
-                     start_read_message(conn); // 嵌套调用
+                     start_read_message(conn, session); // 嵌套调用
                   } else {
-                     auto pname = conn->peer_name();
                      if (ec.value() != boost::asio::error::eof) {
-                        elog( "Error reading message from ${p}: ${m}",("p",pname)( "m", ec.message() ) );
+                        close_from_strand( conn, session, "Error reading message: " + ec.message() );
                      } else {
-                        ilog( "Peer ${p} closed connection",("p",pname) );
+                        close_from_strand( conn, session, "Peer closed connection", false );
                      }
-                     close( conn );
                   }
                }
                catch(const std::exception &ex) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  elog("Exception in handling read data from ${p} ${s}",("p",pname)("s",ex.what()));
-                  close( conn );
+                  close_from_strand( conn, session, string("Exception in handling read data: ") + ex.what() );
                }
                catch(const fc::exception &ex) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  elog("Exception in handling read data ${s}", ("p",pname)("s",ex.to_string()));
-                  close( conn );
+                  close_from_strand( conn, session, "Exception in handling read data: " + ex.to_string() );
                }
                catch (...) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  elog( "Undefined exception hanlding the read data from connection ${p}",( "p",pname));
-                  close( conn );
+                  close_from_strand( conn, session, "Undefined exception handling the read data" );
                }
-            } );
+            } ) );
       } catch (...) {
-         string pname = conn ? conn->peer_name() : "no connection name";
-         elog( "Undefined exception handling reading ${p}",("p",pname) );
-         close( conn );
+         close_from_strand( conn, session, "Undefined exception handling reading" );
       }
    }
 
@@ -2191,6 +2615,15 @@ namespace eosio {
       }
    }
 
+   template<typename VerifierFunc>
+   void net_plugin_impl::send_all( const std::shared_ptr<vector<char>>& send_buffer, VerifierFunc verify) {
+      for( auto &c : connections) {
+         if( c->current() && verify( c)) {
+            c->enqueue_buffer( send_buffer );
+         }
+      }
+   }
+
    bool net_plugin_impl::is_valid( const handshake_message &msg) {
       // Do some basic validation of an incoming handshake_message, so things
       // that really aren't handshake messages can be quickly discarded without
@@ -2478,6 +2911,12 @@ namespace eosio {
       }
    }
 
+   void net_plugin_impl::handle_message( connection_ptr c, const compressed_message &msg) {
+      // compressed messages are inflated when they are unpacked, this one was nested in another
+      peer_elog(c, "unexpected compressed_message");
+      close( c );
+   }
+
    void net_plugin_impl::handle_message( connection_ptr c, const packed_transaction &msg) {
       fc_dlog(logger, "got a packed transaction, cancel wait");
       peer_ilog(c, "received packed_transaction");
@@ -2497,6 +2936,7 @@ namespace eosio {
          return;
       }
       dispatcher->recv_transaction(c, tid);
+      std::shared_ptr<vector<char>> send_buffer = std::move(c->received_message);
       chain_plug->accept_transaction(msg, [=](const static_variant<fc::exception_ptr, transaction_trace_ptr>& result) {
          if (result.contains<fc::exception_ptr>()) {
             peer_dlog(c, "bad packed_transaction : ${m}", ("m",result.get<fc::exception_ptr>()->what()));
@@ -2504,7 +2944,7 @@ namespace eosio {
             auto trace = result.get<transaction_trace_ptr>();
             if (!trace->except) {
                fc_dlog(logger, "chain accepted transaction");
-               dispatcher->bcast_transaction(msg);
+               dispatcher->bcast_transaction(msg, send_buffer);
                return;
             }
 
@@ -2516,11 +2956,27 @@ namespace eosio {
    }
 
    void net_plugin_impl::handle_message( connection_ptr c, const signed_block &msg) {
+      fc_dlog(logger, "canceling wait on ${p}", ("p",c->peer_name()));
+      c->cancel_wait();
+
+      signed_block_ptr sbp = std::make_shared<signed_block>(msg);
+      // during catch up, blocks arriving from several peers are applied in order
+      if( !sync_master->sync_block_ready(c, sbp) ) {
+         return;
+      }
+      process_block(c, sbp, std::move(c->received_message));
+
+      connection_ptr source;
+      while( sync_master->next_buffered_block(source, sbp) ) {
+         process_block(source, sbp, std::shared_ptr<vector<char>>());
+      }
+   }
+
+   void net_plugin_impl::process_block( connection_ptr c, const signed_block_ptr& sbp, std::shared_ptr<vector<char>> received ) {
+      const signed_block& msg = *sbp;
       controller &cc = chain_plug->chain();
       block_id_type blk_id = msg.id();
       uint32_t blk_num = msg.block_num();
-      fc_dlog(logger, "canceling wait on ${p}", ("p",c->peer_name()));
-      c->cancel_wait();
 
       try {
          if( cc.fetch_block_by_id(blk_id)) {
@@ -2538,8 +2994,10 @@ namespace eosio {
               ("n",blk_num)("age",age.to_seconds()));
 
       go_away_reason reason = fatal_other;
+      // accepting the block broadcasts it, in the bytes it was received in
+      dispatcher->relay_block_id = blk_id;
+      dispatcher->relay_block_buffer = std::move(received);
       try {
-         signed_block_ptr sbp = std::make_shared<signed_block>(msg);
          chain_plug->accept_block(sbp); //, sync_master->is_active(c));
          reason = no_reason;
       } catch( const unlinkable_block_exception &ex) {
@@ -2560,6 +3018,7 @@ namespace eosio {
          peer_elog(c, "bad signed_block : unknown exception");
          elog( "handle sync block caught something else from ${p}",("num",blk_num)("p",c->peer_name()));
       }
+      dispatcher->relay_block_buffer.reset();
 
       update_block_num ubn(blk_num);
       if( reason == no_reason ) {
@@ -2885,8 +3344,11 @@ namespace eosio {
          ( "network-version-match", bpo::value<bool>()->default_value(false),
            "True to require exact match of peer network version.")
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
+         ( "p2p-compression-threshold", bpo::value<uint32_t>()->default_value(def_compression_threshold), "Blocks and transactions of at least this many bytes are sent compressed to peers able to receive it, 0 to disable compression")
+         ( "sync-fetch-peers", bpo::value<uint32_t>()->default_value(def_sync_fetch_peers), "maximum number of peers blocks are retrieved from at the same time during synchronization")
          ( "max-implicit-request", bpo::value<uint32_t>()->default_value(def_max_just_send), "maximum sizes of transaction or block messages that are sent without first sending a notice")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable expirimental socket read watermark optimization")
+         ( "net-threads", bpo::value<uint16_t>()->default_value(def_net_threads), "Number of worker threads in net_plugin thread pool, which run the peer sockets, read and unpack received messages and write sent ones")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
            "Available Variables:\n"
@@ -2912,7 +3374,10 @@ namespace eosio {
 
          my->network_version_match = options.at( "network-version-match" ).as<bool>();
 
-         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>()));
+         EOS_ASSERT( options.at( "sync-fetch-peers" ).as<uint32_t>() > 0, chain::plugin_config_exception,
+                     "sync-fetch-peers must be greater than 0" );
+         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>(),
+                                                  options.at( "sync-fetch-peers" ).as<uint32_t>()));
          my->dispatcher.reset( new dispatch_manager );
 
          my->connector_period = std::chrono::seconds( options.at( "connection-cleanup-period" ).as<int>());
@@ -2926,6 +3391,13 @@ namespace eosio {
          my->started_sessions = 0;
 
          my->use_socket_read_watermark = options.at( "use-socket-read-watermark" ).as<bool>();
+         my->compression_threshold = options.at( "p2p-compression-threshold" ).as<uint32_t>();
+
+         my->thread_pool_size = options.at( "net-threads" ).as<uint16_t>();
+         EOS_ASSERT( my->thread_pool_size > 0, chain::plugin_config_exception,
+                     "net-threads ${num} must be greater than 0", ("num", my->thread_pool_size) );
+         my->server_ioc = std::make_shared<boost::asio::io_context>();
+         my->server_ioc_work.emplace( boost::asio::make_work_guard( *my->server_ioc ) );
 
          my->resolver = std::make_shared<tcp::resolver>( std::ref( app().get_io_service()));
          if( options.count( "p2p-listen-endpoint" )) {
@@ -3011,6 +3483,11 @@ namespace eosio {
    }
 
    void net_plugin::plugin_startup() {
+      my->thread_pool.emplace( my->thread_pool_size );
+      for( uint16_t i = 0; i < my->thread_pool_size; ++i ) {
+         boost::asio::post( *my->thread_pool, [ioc = my->server_ioc]() { ioc->run(); } );
+      }
+
       if( my->acceptor ) {
          my->acceptor->open(my->listen_endpoint.protocol());
          my->acceptor->set_option(tcp::acceptor::reuse_address(true));
@@ -3071,6 +3548,14 @@ namespace eosio {
 
             my->acceptor.reset(nullptr);
          }
+         if( my->server_ioc ) {
+            my->server_ioc_work.reset();
+            my->server_ioc->stop();
+         }
+         if( my->thread_pool ) {
+            my->thread_pool->stop();
+            my->thread_pool->join();
+         }
          ilog( "exit shutdown" );
       }
       FC_CAPTURE_AND_RETHROW()
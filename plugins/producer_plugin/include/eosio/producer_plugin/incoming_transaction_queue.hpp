@@ -0,0 +1,169 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/chain/transaction.hpp>
+#include <eosio/chain/transaction_metadata.hpp>
+#include <eosio/chain/types.hpp>
+
+#include <fc/static_variant.hpp>
+
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+
+namespace eosio {
+
+   using chain::account_name;
+   using chain::packed_transaction_ptr;
+   using chain::transaction_metadata_ptr;
+   using chain::transaction_trace_ptr;
+
+   /**
+    *  Bounded queue of the incoming transactions waiting for a pending block.
+    *
+    *  Transactions are kept in lanes by the first authorizer of their actions. Accounts configured as priority
+    *  accounts go in the priority lane, which is always served first; every other account goes in the normal lane.
+    *  Within a lane, accounts are served round robin, one transaction each, so a burst from one account only delays
+    *  that account.
+    *
+    *  Drop policy, when a transaction is added:
+    *   - an account already holding max_per_account transactions has the new one dropped
+    *   - when the queue holds max_size transactions, the newest transaction of the account holding the most in the
+    *     lowest priority lane is evicted, unless the new transaction would itself be the one to evict, in which case
+    *     it is dropped
+    */
+   class incoming_transaction_queue {
+      public:
+         using next_function = std::function<void(const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>&)>;
+
+         struct entry {
+            transaction_metadata_ptr  mtrx;   ///< also holds the packed transaction, which is not kept separately
+            bool                      persist_until_expired = false;
+            next_function             next;
+         };
+
+         enum class drop_reason {
+            account_limit,
+            queue_full
+         };
+
+         struct stats {
+            uint64_t queued = 0;
+            uint64_t dropped_account_limit = 0;
+            uint64_t dropped_queue_full = 0;   ///< new transactions dropped and queued ones evicted
+         };
+
+         using drop_handler = std::function<void(entry&&, drop_reason)>;
+
+         void set_limits( size_t max_queue_size, size_t max_account_size ) {
+            max_size = max_queue_size;
+            max_per_account = max_account_size;
+         }
+
+         void set_priority_accounts( std::set<account_name> accounts ) {
+            priority_accounts = std::move( accounts );
+         }
+
+         size_t size()const { return total; }
+         bool   empty()const { return total == 0; }
+         const stats& get_stats()const { return counters; }
+
+         /// queues trx, or hands it or an evicted transaction to on_drop according to the drop policy
+         void add( entry e, const drop_handler& on_drop ) {
+            const account_name account = e.mtrx->trx.first_authorizor();
+            const size_t lane_idx = priority_accounts.count( account ) ? priority : normal;
+            auto& l = lanes[lane_idx];
+
+            auto itr = l.by_account.find( account );
+            const size_t account_size = itr == l.by_account.end() ? 0 : itr->second.size();
+            if( max_per_account && account_size >= max_per_account ) {
+               ++counters.dropped_account_limit;
+               on_drop( std::move( e ), drop_reason::account_limit );
+               return;
+            }
+
+            if( max_size && total >= max_size ) {
+               size_t victim_lane = lanes[normal].by_size.empty() ? priority : normal;
+               auto& vl = lanes[victim_lane];
+               auto victim = vl.by_size.rbegin();
+               // a priority transaction always evicts a normal one, never the other way around
+               if( lane_idx > victim_lane || ( lane_idx == victim_lane && account_size + 1 >= victim->first ) ) {
+                  ++counters.dropped_queue_full;
+                  on_drop( std::move( e ), drop_reason::queue_full );
+                  return;
+               }
+               const account_name victim_account = victim->second;
+               auto& q = vl.by_account[victim_account];
+               entry evicted = std::move( q.back() );
+               q.pop_back();
+               vl.resize( victim_account, q.size() + 1, q.size() );
+               if( q.empty() )
+                  vl.remove( victim_account );
+               --total;
+               ++counters.dropped_queue_full;
+               on_drop( std::move( evicted ), drop_reason::queue_full );
+            }
+
+            auto& q = l.by_account[account];
+            if( q.empty() )
+               l.rotation.push_back( account );
+            q.emplace_back( std::move( e ) );
+            l.resize( account, q.size() - 1, q.size() );
+            ++total;
+            ++counters.queued;
+         }
+
+         /// removes the next transaction to apply, the queue must not be empty
+         entry pop() {
+            auto& l = lanes[priority].rotation.empty() ? lanes[normal] : lanes[priority];
+            const account_name account = l.rotation.front();
+            l.rotation.pop_front();
+            auto& q = l.by_account[account];
+            entry e = std::move( q.front() );
+            q.pop_front();
+            l.resize( account, q.size() + 1, q.size() );
+            if( q.empty() ) {
+               l.by_account.erase( account );
+            } else {
+               l.rotation.push_back( account );
+            }
+            --total;
+            return e;
+         }
+
+      private:
+         enum lane_index : size_t { priority = 0, normal = 1 };
+
+         struct lane {
+            std::map<account_name, std::deque<entry>>      by_account;
+            std::deque<account_name>                       rotation;   ///< accounts with queued transactions, in serving order
+            std::set<std::pair<size_t, account_name>>      by_size;    ///< accounts by number of queued transactions
+
+            void resize( const account_name& account, size_t old_size, size_t new_size ) {
+               if( old_size )
+                  by_size.erase( std::make_pair( old_size, account ) );
+               if( new_size )
+                  by_size.emplace( new_size, account );
+            }
+
+            void remove( const account_name& account ) {
+               by_account.erase( account );
+               rotation.erase( std::find( rotation.begin(), rotation.end(), account ) );
+            }
+         };
+
+         std::array<lane, 2>     lanes;
+         std::set<account_name>  priority_accounts;
+         size_t                  total = 0;
+         size_t                  max_size = 0;
+         size_t                  max_per_account = 0;
+         stats                   counters;
+   };
+
+} // namespace eosio
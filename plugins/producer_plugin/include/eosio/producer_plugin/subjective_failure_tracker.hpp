@@ -0,0 +1,122 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosio/chain/types.hpp>
+
+#include <fc/time.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+namespace eosio {
+
+   using chain::account_name;
+
+   /**
+    *  Per-account record of the CPU time spent speculatively executing transactions that failed.
+    *
+    *  Each account holds a charge which grows by the execution time of every failed transaction it authorized and
+    *  decays at a constant rate, so that a charge equal to the allowance is cleared after one decay window. An
+    *  account whose charge reaches the allowance is throttled until enough of it has decayed.
+    *
+    *  The charge is kept as the time at which it will have fully decayed, so accounts ordered by that time are also
+    *  ordered by their current charge. When max_accounts are tracked, the account with the lowest charge is forgotten
+    *  to make room for a new one.
+    */
+   class subjective_failure_tracker {
+      public:
+         void set_limits( fc::microseconds cpu_allowance, fc::microseconds decay_window, size_t max_account_size ) {
+            allowance = cpu_allowance;
+            window = decay_window;
+            max_accounts = max_account_size;
+         }
+
+         bool enabled()const { return allowance.count() > 0 && window.count() > 0; }
+         size_t size()const { return accounts.size(); }
+
+         /// charges the execution time of a failed transaction authorized by account
+         void charge( const account_name& account, fc::microseconds elapsed, const fc::time_point& now ) {
+            if( !enabled() || elapsed.count() <= 0 )
+               return;
+
+            // decay rate is allowance per window, so elapsed clears after elapsed * window / allowance
+            const fc::microseconds debt( static_cast<int64_t>( (__int128)elapsed.count() * window.count() / allowance.count() ) );
+
+            auto& by_name = accounts.get<by_account>();
+            auto itr = by_name.find( account );
+            if( itr != by_name.end() ) {
+               by_name.modify( itr, [&]( failure_charge& c ) {
+                  c.cleared = std::max( c.cleared, now ) + debt;
+               } );
+               return;
+            }
+
+            if( max_accounts && accounts.size() >= max_accounts ) {
+               auto& by_time = accounts.get<by_cleared>();
+               by_time.erase( by_time.begin() );
+            }
+            accounts.insert( failure_charge{ account, now + debt } );
+         }
+
+         /// the charge of account decayed to now
+         fc::microseconds get_charge( const account_name& account, const fc::time_point& now )const {
+            if( !enabled() )
+               return fc::microseconds();
+            auto& by_name = accounts.get<by_account>();
+            auto itr = by_name.find( account );
+            if( itr == by_name.end() || itr->cleared <= now )
+               return fc::microseconds();
+            return fc::microseconds( static_cast<int64_t>( (__int128)( itr->cleared - now ).count() * allowance.count() / window.count() ) );
+         }
+
+         /// true when the charge of account has reached the allowance
+         bool is_throttled( const account_name& account, const fc::time_point& now )const {
+            if( !enabled() )
+               return false;
+            auto& by_name = accounts.get<by_account>();
+            auto itr = by_name.find( account );
+            return itr != by_name.end() && itr->cleared - now >= window;
+         }
+
+         /// forgets accounts whose charge has fully decayed, returns the number forgotten
+         size_t remove_decayed( const fc::time_point& now ) {
+            auto& by_time = accounts.get<by_cleared>();
+            size_t num_removed = 0;
+            while( !by_time.empty() && by_time.begin()->cleared <= now ) {
+               by_time.erase( by_time.begin() );
+               ++num_removed;
+            }
+            return num_removed;
+         }
+
+      private:
+         struct failure_charge {
+            account_name      account;
+            fc::time_point    cleared;   ///< time at which the charge has fully decayed
+         };
+
+         struct by_account;
+         struct by_cleared;
+
+         using failure_charge_index = boost::multi_index::multi_index_container<
+            failure_charge,
+            boost::multi_index::indexed_by<
+               boost::multi_index::hashed_unique<boost::multi_index::tag<by_account>,
+                  BOOST_MULTI_INDEX_MEMBER(failure_charge, account_name, account), std::hash<account_name>>,
+               boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_cleared>,
+                  BOOST_MULTI_INDEX_MEMBER(failure_charge, fc::time_point, cleared)>
+            >
+         >;
+
+         failure_charge_index    accounts;
+         fc::microseconds        allowance;
+         fc::microseconds        window;
+         size_t                  max_accounts = 0;
+   };
+
+} // namespace eosio
@@ -3,6 +3,8 @@
  *  @copyright defined in eos/LICENSE.txt
  */
 #include <eosio/producer_plugin/producer_plugin.hpp>
+#include <eosio/producer_plugin/incoming_transaction_queue.hpp>
+#include <eosio/producer_plugin/subjective_failure_tracker.hpp>
 #include <eosio/chain/producer_object.hpp>
 #include <eosio/chain/plugin_interface.hpp>
 #include <eosio/chain/global_property_object.hpp>
@@ -342,15 +344,70 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          }
       }
 
-      std::deque<std::tuple<packed_transaction_ptr, bool, next_function<transaction_trace_ptr>>> _pending_incoming_transactions;
+      incoming_transaction_queue _pending_incoming_transactions;
+      uint64_t                   _incoming_drops_reported = 0;
+      subjective_failure_tracker _subjective_failures;
+
+      /// the packed transaction held by mtrx, shared instead of copied for the transaction ack channel
+      static packed_transaction_ptr packed_trx_ptr(const transaction_metadata_ptr& mtrx) {
+         return packed_transaction_ptr(mtrx, &mtrx->packed_trx);
+      }
+
+      void queue_incoming_transaction(const transaction_metadata_ptr& mtrx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
+         _pending_incoming_transactions.add( incoming_transaction_queue::entry{mtrx, persist_until_expired, std::move(next)},
+                                             [this]( incoming_transaction_queue::entry&& e, incoming_transaction_queue::drop_reason reason ) {
+            const char* why = reason == incoming_transaction_queue::drop_reason::account_limit ?
+                              "too many queued transactions from the same account" : "incoming transaction queue is full";
+            fc::exception_ptr e_ptr = std::make_shared<incoming_transaction_dropped>( FC_LOG_MESSAGE( error, "${why}, dropping transaction ${id}",
+                                                                                                      ("why", why)("id", e.mtrx->id) ) );
+            fc_dlog(_trx_trace_log, "[TRX_TRACE] DROPPING tx: ${txid} : ${why}", ("txid", e.mtrx->id)("why", why));
+            e.next(e_ptr);
+            _transaction_ack_channel.publish(std::pair<fc::exception_ptr, packed_transaction_ptr>(e_ptr, packed_trx_ptr(e.mtrx)));
+         } );
+      }
+
+      /**
+       * Charges the first authorizer of a failed transaction with the wall clock time it took to apply. The failure may
+       * have come before the signatures were checked, so the account is only charged when it did sign the transaction.
+       */
+      void charge_subjective_failure(const transaction_metadata_ptr& trx, fc::microseconds elapsed) {
+         if( !_subjective_failures.enabled() )
+            return;
+         chain::controller& chain = app().get_plugin<chain_plugin>().chain();
+         const permission_level* first_auth = nullptr;
+         for( const auto& a : trx->trx.actions ) {
+            if( !a.authorization.empty() ) {
+               first_auth = &a.authorization.front();
+               break;
+            }
+         }
+         if( !first_auth )
+            return;
+         if( !chain.skip_auth_check() ) {
+            try {
+               chain.get_authorization_manager().check_authorization( first_auth->actor, first_auth->permission,
+                                                                      trx->recover_keys( chain.get_chain_id() ), {},
+                                                                      fc::seconds( trx->trx.delay_sec ), [](){}, true );
+            } catch( const fc::exception& ) {
+               return;
+            }
+         }
+         _subjective_failures.charge( first_auth->actor, elapsed, fc::time_point::now() );
+      }
 
       void on_incoming_transaction_async(const packed_transaction_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
+         process_incoming_transaction(std::make_shared<transaction_metadata>(*trx), persist_until_expired, std::move(next));
+      }
+
+      void process_incoming_transaction(const transaction_metadata_ptr& mtrx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
          chain::controller& chain = app().get_plugin<chain_plugin>().chain();
          if (!chain.pending_block_state()) {
-            _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+            queue_incoming_transaction(mtrx, persist_until_expired, next);
             return;
          }
 
+         const auto trx = packed_trx_ptr(mtrx);
+
          auto block_time = chain.pending_block_state()->header.timestamp.to_time_point();
 
          auto send_response = [this, &trx, &chain, &next](const fc::static_variant<fc::exception_ptr, transaction_trace_ptr>& response) {
@@ -393,6 +450,14 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
             return;
          }
 
+         const account_name first_auth = mtrx->trx.first_authorizor();
+         if( _subjective_failures.is_throttled( first_auth, fc::time_point::now() ) ) {
+            send_response(std::static_pointer_cast<fc::exception>(std::make_shared<account_failure_throttled>(
+                  FC_LOG_MESSAGE(error, "transaction ${id} rejected, ${a} has ${t}us of recently failed transactions",
+                                 ("id", id)("a", first_auth)("t", _subjective_failures.get_charge( first_auth, fc::time_point::now() ).count())) )));
+            return;
+         }
+
          auto deadline = fc::time_point::now() + fc::milliseconds(_max_transaction_time_ms);
          bool deadline_is_subjective = false;
          if (_max_transaction_time_ms < 0 || (_pending_block_mode == pending_block_mode::producing && block_time < deadline) ) {
@@ -401,10 +466,11 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          }
 
          try {
-            auto trace = chain.push_transaction(std::make_shared<transaction_metadata>(*trx), deadline);
+            const auto start = fc::time_point::now();
+            auto trace = chain.push_transaction(mtrx, deadline);
             if (trace->except) {
                if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
-                  _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+                  queue_incoming_transaction(mtrx, persist_until_expired, next);
                   if (_pending_block_mode == pending_block_mode::producing) {
                      fc_dlog(_trx_trace_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} COULD NOT FIT, tx: ${txid} RETRYING ",
                              ("block_num", chain.head_block_num() + 1)
@@ -415,6 +481,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
                              ("txid", trx->id()));
                   }
                } else {
+                  charge_subjective_failure( mtrx, fc::time_point::now() - start );
                   auto e_ptr = trace->except->dynamic_copy_exception();
                   send_response(e_ptr);
                }
@@ -528,6 +595,18 @@ void producer_plugin::set_program_options(
           "offset of last block producing time in microseconds. Negative number results in blocks to go out sooner, and positive number results in blocks to go out later")
          ("incoming-defer-ratio", bpo::value<double>()->default_value(1.0),
           "ratio between incoming transations and deferred transactions when both are exhausted")
+         ("incoming-transaction-queue-size", bpo::value<uint32_t>()->default_value(10000),
+          "maximum number of incoming transactions waiting for a pending block, 0 for no limit. When full, the newest transactions of the account with the most queued are dropped first")
+         ("incoming-transaction-account-limit", bpo::value<uint32_t>()->default_value(1000),
+          "maximum number of incoming transactions of one account waiting for a pending block, 0 for no limit")
+         ("incoming-priority-account", boost::program_options::value<vector<string>>()->composing()->multitoken(),
+          "account whose incoming transactions are applied before the ones of other accounts. May be specified multiple times")
+         ("subjective-failure-cpu-allowance-us", bpo::value<int64_t>()->default_value(100000),
+          "time (in microseconds) an account may spend in failed speculative transactions before its further transactions are rejected, 0 to disable")
+         ("subjective-failure-decay-window-sec", bpo::value<uint32_t>()->default_value(60),
+          "time (in seconds) for the failed transaction time of an account to decay from the allowance to zero")
+         ("subjective-failure-max-accounts", bpo::value<uint32_t>()->default_value(10000),
+          "maximum number of accounts whose failed transaction time is tracked, the accounts with the least are forgotten first")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
           "the location of the snapshots directory (absolute path or relative to application data dir)")
          ;
@@ -658,6 +737,16 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
 
    my->_incoming_defer_ratio = options.at("incoming-defer-ratio").as<double>();
 
+   my->_pending_incoming_transactions.set_limits( options.at("incoming-transaction-queue-size").as<uint32_t>(),
+                                                  options.at("incoming-transaction-account-limit").as<uint32_t>() );
+   std::set<chain::account_name> priority_accounts;
+   LOAD_VALUE_SET(options, "incoming-priority-account", priority_accounts, types::account_name)
+   my->_pending_incoming_transactions.set_priority_accounts( std::move(priority_accounts) );
+
+   my->_subjective_failures.set_limits( fc::microseconds( options.at("subjective-failure-cpu-allowance-us").as<int64_t>() ),
+                                        fc::seconds( options.at("subjective-failure-decay-window-sec").as<uint32_t>() ),
+                                        options.at("subjective-failure-max-accounts").as<uint32_t>() );
+
    if( options.count( "snapshots-dir" )) {
       auto sd = options.at( "snapshots-dir" ).as<bfs::path>();
       if( sd.is_relative()) {
@@ -1121,6 +1210,20 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
       try {
          size_t orig_pending_txn_size = _pending_incoming_transactions.size();
 
+         const auto& queue_stats = _pending_incoming_transactions.get_stats();
+         const uint64_t incoming_drops = queue_stats.dropped_account_limit + queue_stats.dropped_queue_full;
+         if (incoming_drops != _incoming_drops_reported) {
+            ilog("Incoming transaction queue holds ${n}, dropped ${d} over the account limit and ${f} when full, ${q} queued in total",
+                 ("n", orig_pending_txn_size)("d", queue_stats.dropped_account_limit)("f", queue_stats.dropped_queue_full)("q", queue_stats.queued));
+            _incoming_drops_reported = incoming_drops;
+         }
+
+         if (_subjective_failures.size()) {
+            auto num_decayed = _subjective_failures.remove_decayed(fc::time_point::now());
+            fc_dlog(_log, "Tracking failed transaction time of ${n} accounts, ${d} fully decayed",
+                    ("n", _subjective_failures.size())("d", num_decayed));
+         }
+
          // Processing unapplied transactions...
          //
          if (_producers.empty() && persisted_by_id.empty()) {
@@ -1178,11 +1281,13 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
                         deadline = block_time;
                      }
 
+                     const auto start = fc::time_point::now();
                      auto trace = chain.push_transaction(trx, deadline);
                      if (trace->except) {
                         if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
                            exhausted = true;
                         } else {
+                           charge_subjective_failure( trx, fc::time_point::now() - start );
                            // this failed our configured maximum transaction time, we don't want to replay it
                            chain.drop_unapplied_transaction(trx);
                            num_failed++;
@@ -1238,11 +1343,10 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
 
                   // configurable ratio of incoming txns vs deferred txns
                   while (_incoming_trx_weight >= 1.0 && orig_pending_txn_size && _pending_incoming_transactions.size()) {
-                     auto e = _pending_incoming_transactions.front();
-                     _pending_incoming_transactions.pop_front();
+                     auto e = _pending_incoming_transactions.pop();
                      --orig_pending_txn_size;
                      _incoming_trx_weight -= 1.0;
-                     on_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+                     process_incoming_transaction(e.mtrx, e.persist_until_expired, e.next);
                   }
 
                   if (block_time <= fc::time_point::now()) {
@@ -1302,10 +1406,9 @@ producer_plugin_impl::start_block_result producer_plugin_impl::start_block(bool
             if (!_pending_incoming_transactions.empty()) {
                fc_dlog(_log, "Processing ${n} pending transactions");
                while (orig_pending_txn_size && _pending_incoming_transactions.size()) {
-                  auto e = _pending_incoming_transactions.front();
-                  _pending_incoming_transactions.pop_front();
+                  auto e = _pending_incoming_transactions.pop();
                   --orig_pending_txn_size;
-                  on_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+                  process_incoming_transaction(e.mtrx, e.persist_until_expired, e.next);
                   if (block_time <= fc::time_point::now()) return start_block_result::exhausted;
                }
             }
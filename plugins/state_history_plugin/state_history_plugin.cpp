@@ -18,6 +18,12 @@
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/signals2/connection.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 using tcp    = boost::asio::ip::tcp;
 namespace ws = boost::beast::websocket;
 
@@ -66,7 +72,26 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    std::map<transaction_id_type, transaction_trace_ptr> cached_traces;
    transaction_trace_ptr                                onblock_trace;
 
+   // entries are packed on the main thread, then compressed and appended to the logs by the writer thread
+   struct write_job {
+      state_history_log*     log = nullptr;
+      uint32_t               block_num = 0;
+      block_id_type          block_id;
+      block_id_type          prev_id;
+      std::function<bytes()> pack;
+   };
+
+   std::mutex                                            log_mtx; // guards trace_log and chain_state_log
+   uint32_t                                              write_queue_size = 32;
+   std::mutex                                            write_queue_mtx;
+   std::condition_variable                               write_queue_cv;
+   std::deque<write_job>                                 write_queue;
+   bool                                                  writer_done = false;
+   std::thread                                           writer_thread;
+   std::deque<std::pair<state_history_log*, uint32_t>>   unwritten_entries; // main thread only
+
    void get_log_entry(state_history_log& log, uint32_t block_num, fc::optional<bytes>& result) {
+      std::lock_guard<std::mutex> g(log_mtx);
       if (block_num < log.begin_block() || block_num >= log.end_block())
          return;
       state_history_log_header header;
@@ -90,10 +115,12 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    }
 
    fc::optional<chain::block_id_type> get_block_id(uint32_t block_num) {
+      std::unique_lock<std::mutex> g(log_mtx);
       if (trace_log && block_num >= trace_log->begin_block() && block_num < trace_log->end_block())
          return trace_log->get_block_id(block_num);
       if (chain_state_log && block_num >= chain_state_log->begin_block() && block_num < chain_state_log->end_block())
          return chain_state_log->get_block_id(block_num);
+      g.unlock();
       try {
          auto block = chain_plug->chain().fetch_block_by_number(block_num);
          if (block)
@@ -182,6 +209,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          get_status_result_v0 result;
          result.head              = {chain.head_block_num(), chain.head_block_id()};
          result.last_irreversible = {chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
+         std::lock_guard<std::mutex> g(plugin->log_mtx);
          if (plugin->trace_log) {
             result.trace_begin_block = plugin->trace_log->begin_block();
             result.trace_end_block   = plugin->trace_log->end_block();
@@ -225,6 +253,9 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          result.last_irreversible = {chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
          uint32_t current =
              current_request->irreversible_only ? result.last_irreversible.block_num : result.head.block_num;
+         // don't get ahead of entries still waiting for the writer thread
+         for (auto& e : plugin->unwritten_entries)
+            current = std::min(current, e.second - 1);
          if (current_request->start_block_num <= current &&
              current_request->start_block_num < current_request->end_block_num) {
             auto block_id = plugin->get_block_id(current_request->start_block_num);
@@ -368,6 +399,76 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       }
    }
 
+   void start_writer() {
+      writer_thread = std::thread([this] { run_writer(); });
+   }
+
+   // waits for the queued entries to be written
+   void stop_writer() {
+      if (!writer_thread.joinable())
+         return;
+      {
+         std::lock_guard<std::mutex> g(write_queue_mtx);
+         writer_done = true;
+      }
+      write_queue_cv.notify_all();
+      writer_thread.join();
+   }
+
+   // blocks the main thread while the writer is write_queue_size entries behind
+   void queue_write(write_job job) {
+      unwritten_entries.emplace_back(job.log, job.block_num);
+      {
+         std::unique_lock<std::mutex> g(write_queue_mtx);
+         write_queue_cv.wait(g, [&] { return write_queue.size() < write_queue_size; });
+         write_queue.push_back(std::move(job));
+      }
+      write_queue_cv.notify_all();
+   }
+
+   void run_writer() {
+      while (true) {
+         write_job job;
+         {
+            std::unique_lock<std::mutex> g(write_queue_mtx);
+            write_queue_cv.wait(g, [&] { return writer_done || !write_queue.empty(); });
+            if (write_queue.empty())
+               return;
+            job = std::move(write_queue.front());
+            write_queue.pop_front();
+         }
+         write_queue_cv.notify_all();
+         catch_and_log([&] { write_log_entry(job); });
+         app().get_io_service().post([self = shared_from_this(), this] { on_entry_written(); });
+      }
+   }
+
+   void write_log_entry(write_job& job) {
+      auto bin = zlib_compress_bytes(job.pack());
+      EOS_ASSERT(bin.size() == (uint32_t)bin.size(), plugin_exception, "${n} entry is too big", ("n", job.block_num));
+      state_history_log_header header{
+          .block_num = job.block_num, .block_id = job.block_id, .payload_size = sizeof(uint32_t) + bin.size()};
+      std::lock_guard<std::mutex> g(log_mtx);
+      job.log->write_entry(header, job.prev_id, [&](auto& stream) {
+         uint32_t s = (uint32_t)bin.size();
+         stream.write((char*)&s, sizeof(s));
+         if (!bin.empty())
+            stream.write(bin.data(), bin.size());
+      });
+   }
+
+   // jobs complete in queue order, so the oldest unwritten entry is the one just written
+   void on_entry_written() {
+      unwritten_entries.pop_front();
+      if (stopping)
+         return;
+      for (auto& s : sessions) {
+         auto& p = s.second;
+         if (p)
+            p->send_update(true);
+      }
+   }
+
    void store_traces(const block_state_ptr& block_state) {
       if (!trace_log)
          return;
@@ -388,25 +489,25 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       cached_traces.clear();
       onblock_trace.reset();
 
+      // the traces refer to chain state, so they are packed before leaving the main thread
       auto& db         = chain_plug->chain().db();
-      auto  traces_bin = zlib_compress_bytes(fc::raw::pack(make_history_serial_wrapper(db, traces)));
-      EOS_ASSERT(traces_bin.size() == (uint32_t)traces_bin.size(), plugin_exception, "traces is too big");
-
-      state_history_log_header header{.block_num    = block_state->block->block_num(),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + traces_bin.size()};
-      trace_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)traces_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!traces_bin.empty())
-            stream.write(traces_bin.data(), traces_bin.size());
-      });
+      auto  traces_bin = std::make_shared<bytes>(fc::raw::pack(make_history_serial_wrapper(db, traces)));
+      queue_write({.log       = &*trace_log,
+                   .block_num = block_state->block->block_num(),
+                   .block_id  = block_state->block->id(),
+                   .prev_id   = block_state->block->previous,
+                   .pack      = [traces_bin] { return std::move(*traces_bin); }});
    }
 
    void store_chain_state(const block_state_ptr& block_state) {
       if (!chain_state_log)
          return;
-      bool fresh = chain_state_log->begin_block() == chain_state_log->end_block();
+      bool fresh = std::none_of(unwritten_entries.begin(), unwritten_entries.end(),
+                                [&](auto& e) { return e.first == &*chain_state_log; });
+      if (fresh) {
+         std::lock_guard<std::mutex> g(log_mtx);
+         fresh = chain_state_log->begin_block() == chain_state_log->end_block();
+      }
       if (fresh)
          ilog("Placing initial state in block ${n}", ("n", block_state->block->block_num()));
 
@@ -485,24 +586,20 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       process_table("resource_limits_state", db.get_index<resource_limits::resource_limits_state_index>(), pack_row);
       process_table("resource_limits_config", db.get_index<resource_limits::resource_limits_config_index>(), pack_row);
 
-      auto deltas_bin = zlib_compress_bytes(fc::raw::pack(deltas));
-      EOS_ASSERT(deltas_bin.size() == (uint32_t)deltas_bin.size(), plugin_exception, "deltas is too big");
-      state_history_log_header header{.block_num    = block_state->block->block_num(),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + deltas_bin.size()};
-      chain_state_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)deltas_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!deltas_bin.empty())
-            stream.write(deltas_bin.data(), deltas_bin.size());
-      });
+      // the rows are already packed, so the deltas are complete without the undo stack
+      auto shared_deltas = std::make_shared<std::vector<table_delta>>(std::move(deltas));
+      queue_write({.log       = &*chain_state_log,
+                   .block_num = block_state->block->block_num(),
+                   .block_id  = block_state->block->id(),
+                   .prev_id   = block_state->block->previous,
+                   .pack      = [shared_deltas] { return fc::raw::pack(*shared_deltas); }});
    } // store_chain_state
 };   // state_history_plugin_impl
 
 state_history_plugin::state_history_plugin()
     : my(std::make_shared<state_history_plugin_impl>()) {}
 
-state_history_plugin::~state_history_plugin() {}
+state_history_plugin::~state_history_plugin() { my->stop_writer(); }
 
 void state_history_plugin::set_program_options(options_description& cli, options_description& cfg) {
    auto options = cfg.add_options();
@@ -513,6 +610,8 @@ void state_history_plugin::set_program_options(options_description& cli, options
    options("chain-state-history", bpo::bool_switch()->default_value(false), "enable chain state history");
    options("state-history-endpoint", bpo::value<string>()->default_value("0.0.0.0:8080"),
            "the endpoint upon which to listen for incoming connections");
+   options("state-history-write-queue-size", bpo::value<uint32_t>()->default_value(32),
+           "the number of history entries waiting to be compressed and written before block processing waits for them");
 }
 
 void state_history_plugin::plugin_initialize(const variables_map& options) {
@@ -542,6 +641,9 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
       my->endpoint_port    = std::stoi(port);
       idump((ip_port)(host)(port));
 
+      my->write_queue_size = options.at("state-history-write-queue-size").as<uint32_t>();
+      EOS_ASSERT(my->write_queue_size > 0, plugin_exception, "state-history-write-queue-size must be greater than 0");
+
       if (options.at("delete-state-history").as<bool>()) {
          ilog("Deleting state history");
          boost::filesystem::remove_all(state_history_dir);
@@ -554,6 +656,7 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
       if (options.at("chain-state-history").as<bool>())
          my->chain_state_log.emplace("chain_state_history", (state_history_dir / "chain_state_history.log").string(),
                                      (state_history_dir / "chain_state_history.index").string());
+      my->start_writer();
    }
    FC_LOG_AND_RETHROW()
 } // state_history_plugin::plugin_initialize
@@ -563,6 +666,7 @@ void state_history_plugin::plugin_startup() { my->listen(); }
 void state_history_plugin::plugin_shutdown() {
    my->applied_transaction_connection.reset();
    my->accepted_block_connection.reset();
+   my->stop_writer();
    while (!my->sessions.empty())
       my->sessions.begin()->second->close();
    my->stopping = true;
@@ -446,4 +446,24 @@ BOOST_FIXTURE_TEST_CASE( get_table_by_seckey_test, TESTER ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( get_table_no_abi_test, TESTER ) try {
+   produce_blocks(2);
+
+   create_accounts({ N(noabi) });
+   produce_block();
+
+   eosio::chain_apis::read_only plugin(*(this->control), fc::microseconds(INT_MAX));
+   eosio::chain_apis::read_only::get_table_rows_params p;
+   p.code = N(noabi);
+   p.scope = "noabi";
+   p.table = N(accounts);
+   p.json = true;
+   BOOST_CHECK_THROW(plugin.read_only::get_table_rows(p), contract_table_query_exception);
+
+   p.index_position = "secondary";
+   p.key_type = "i64";
+   BOOST_CHECK_THROW(plugin.read_only::get_table_rows(p), unsupported_abi_version_exception);
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
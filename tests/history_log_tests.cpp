@@ -0,0 +1,384 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/history_plugin/history_log.hpp>
+
+#include <fc/filesystem.hpp>
+#include <fc/io/raw.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+namespace eosio {
+
+using namespace eosio::chain;
+
+namespace {
+
+   transaction_id_type make_trx_id( uint32_t n ) {
+      return fc::sha256::hash( "trx" + std::to_string( n ) );
+   }
+
+   block_id_type make_block_id( uint32_t block_num, uint32_t branch = 0 ) {
+      return fc::sha256::hash( "block" + std::to_string( block_num ) + "." + std::to_string( branch ) );
+   }
+
+   /// builds blocks with consecutive global action sequence numbers
+   struct block_builder {
+      uint64_t next_sequence = 1;
+
+      history_block start( uint32_t block_num, uint32_t branch = 0 ) {
+         history_block b;
+         b.block_num  = block_num;
+         b.block_id   = make_block_id( block_num, branch );
+         b.block_time = block_timestamp_type( block_num );
+         return b;
+      }
+
+      uint64_t add( history_block& b, uint32_t trx, std::vector<account_name> accounts ) {
+         action_trace at;
+         at.receipt.global_sequence = next_sequence;
+         at.receipt.receiver        = accounts.front();
+         at.trx_id                  = make_trx_id( trx );
+         history_action a;
+         a.action_sequence_num = next_sequence;
+         a.trx_id              = at.trx_id;
+         a.accounts            = std::move( accounts );
+         a.packed_action_trace = fc::raw::pack( at );
+         b.actions.emplace_back( std::move( a ) );
+         return next_sequence++;
+      }
+   };
+
+   /// global sequence numbers of the actions of account with account sequence numbers in [first, last]
+   std::vector<uint64_t> account_sequences( const history_log& log, account_name account, int32_t first, int32_t last ) {
+      std::vector<uint64_t> result;
+      for( auto p : log.account_action_positions( account, first, last ) ) {
+         const auto header = log.read_header( p );
+         BOOST_REQUIRE_EQUAL( header.action_sequence_num, log.read_action_trace( p, header ).receipt.global_sequence );
+         result.push_back( header.action_sequence_num );
+      }
+      return result;
+   }
+
+   std::vector<uint64_t> all_account_sequences( const history_log& log, account_name account ) {
+      return account_sequences( log, account, 0, log.account_action_count( account ) - 1 );
+   }
+
+   /// global sequence number of the first action of transaction trx, 0 when not found
+   uint64_t find_trx( const history_log& log, uint32_t trx ) {
+      const auto id = make_trx_id( trx );
+      const auto pos = log.find_transaction( id, [&]( const transaction_id_type& t ) { return t == id; } );
+      return pos == history_no_entry ? 0 : log.read_header( pos ).action_sequence_num;
+   }
+
+   /// copies the files of a history log which is still open, as a crash would leave them
+   void copy_open_log( const boost::filesystem::path& from, const boost::filesystem::path& to, bool with_buckets = false ) {
+      boost::filesystem::create_directories( to );
+      for( boost::filesystem::directory_iterator itr( from ), end; itr != end; ++itr ) {
+         // the buckets are rebuilt when missing, and are too large to copy for each test
+         if( with_buckets || itr->path().filename() != "history_trx.buckets" )
+            boost::filesystem::copy_file( itr->path(), to / itr->path().filename() );
+      }
+   }
+
+   void append_bytes( const boost::filesystem::path& file, size_t n ) {
+      std::ofstream f( file.generic_string(), std::ios_base::binary | std::ios_base::app );
+      f << std::string( n, 'x' );
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(history_log_tests)
+
+BOOST_AUTO_TEST_CASE(packed_record_sizes) { try {
+   BOOST_REQUIRE_EQUAL( history_action_header_size, fc::raw::pack_size( history_action_header() ) );
+   BOOST_REQUIRE_EQUAL( history_account_entry_size, fc::raw::pack_size( history_account_entry() ) );
+   BOOST_REQUIRE_EQUAL( history_trx_entry_size, fc::raw::pack_size( history_trx_entry() ) );
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(append_and_reopen) { try {
+   fc::temp_directory tempdir;
+   block_builder bb;
+
+   {
+      history_log log( tempdir.path() );
+      BOOST_REQUIRE_EQUAL( 0, log.head_block_num() );
+
+      auto b1 = bb.start( 1 );
+      bb.add( b1, 1, { N(alice), N(bob) } );
+      bb.add( b1, 1, { N(alice) } );
+      log.append_block( b1 );
+      auto b2 = bb.start( 2 );
+      bb.add( b2, 2, { N(bob) } );
+      log.append_block( b2 );
+      log.append_block( bb.start( 3 ) );
+
+      BOOST_REQUIRE_EQUAL( 3, log.head_block_num() );
+      BOOST_REQUIRE( all_account_sequences( log, N(alice) ) == (std::vector<uint64_t>{ 1, 2 }) );
+      BOOST_REQUIRE( all_account_sequences( log, N(bob) ) == (std::vector<uint64_t>{ 1, 3 }) );
+      BOOST_REQUIRE_EQUAL( 1, find_trx( log, 1 ) );
+      BOOST_CHECK_THROW( log.append_block( bb.start( 3 ) ), plugin_exception );
+   }
+
+   history_log log( tempdir.path() );
+   BOOST_REQUIRE_EQUAL( 3, log.head_block_num() );
+   BOOST_REQUIRE_EQUAL( 2, log.account_action_count( N(alice) ) );
+   BOOST_REQUIRE( all_account_sequences( log, N(alice) ) == (std::vector<uint64_t>{ 1, 2 }) );
+   BOOST_REQUIRE( all_account_sequences( log, N(bob) ) == (std::vector<uint64_t>{ 1, 3 }) );
+   BOOST_REQUIRE_EQUAL( 1, find_trx( log, 1 ) );
+   BOOST_REQUIRE_EQUAL( 3, find_trx( log, 2 ) );
+   BOOST_REQUIRE_EQUAL( 0, find_trx( log, 3 ) );
+
+   const auto header = log.read_header( log.account_action_positions( N(bob), 1, 1 ).front() );
+   BOOST_REQUIRE_EQUAL( 2, header.block_num );
+   BOOST_REQUIRE( make_trx_id( 2 ) == header.trx_id );
+
+   // appending continues after the reopened log
+   auto b4 = bb.start( 4 );
+   bb.add( b4, 4, { N(carol), N(alice) } );
+   log.append_block( b4 );
+   BOOST_REQUIRE( all_account_sequences( log, N(alice) ) == (std::vector<uint64_t>{ 1, 2, 4 }) );
+   BOOST_REQUIRE( all_account_sequences( log, N(carol) ) == (std::vector<uint64_t>{ 4 }) );
+   BOOST_REQUIRE_EQUAL( 4, find_trx( log, 4 ) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(truncates_torn_write) { try {
+   fc::temp_directory tempdir;
+   const boost::filesystem::path root = tempdir.path();
+   const auto crashed = root / "crashed";
+   const auto dir = root / "history";
+   boost::filesystem::create_directories( dir );
+   block_builder bb;
+
+   {
+      history_log log( dir );
+      auto b1 = bb.start( 1 );
+      bb.add( b1, 1, { N(alice) } );
+      bb.add( b1, 2, { N(alice), N(bob) } );
+      log.append_block( b1 );
+      copy_open_log( dir, crashed );
+   }
+
+   // a block written after the head was last replaced
+   append_bytes( crashed / "history_action.log", 100 );
+   append_bytes( crashed / "history_account.index", history_account_entry_size + 7 );
+   append_bytes( crashed / "history_trx.index", history_trx_entry_size );
+
+   history_log log( crashed );
+   BOOST_REQUIRE_EQUAL( 1, log.head_block_num() );
+   BOOST_REQUIRE_EQUAL( log.end_pos(), boost::filesystem::file_size( crashed / "history_action.log" ) );
+   BOOST_REQUIRE_EQUAL( 3 * history_account_entry_size, boost::filesystem::file_size( crashed / "history_account.index" ) );
+   BOOST_REQUIRE_EQUAL( 2 * history_trx_entry_size, boost::filesystem::file_size( crashed / "history_trx.index" ) );
+   BOOST_REQUIRE( all_account_sequences( log, N(alice) ) == (std::vector<uint64_t>{ 1, 2 }) );
+   BOOST_REQUIRE( all_account_sequences( log, N(bob) ) == (std::vector<uint64_t>{ 2 }) );
+   BOOST_REQUIRE_EQUAL( 2, find_trx( log, 2 ) );
+
+   auto b2 = bb.start( 2 );
+   bb.add( b2, 3, { N(bob) } );
+   log.append_block( b2 );
+   BOOST_REQUIRE( all_account_sequences( log, N(bob) ) == (std::vector<uint64_t>{ 2, 3 }) );
+   BOOST_REQUIRE_EQUAL( 3, find_trx( log, 3 ) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(rebuilds_heads) { try {
+   fc::temp_directory tempdir;
+   const boost::filesystem::path dir = tempdir.path();
+   block_builder bb;
+
+   {
+      history_log log( dir );
+      for( uint32_t n = 1; n <= 5; ++n ) {
+         auto b = bb.start( n );
+         bb.add( b, n, { N(alice) } );
+         if( n % 2 )
+            bb.add( b, n, { N(bob), N(alice) } );
+         log.append_block( b );
+      }
+   }
+
+   auto check = [&]() {
+      history_log log( dir );
+      BOOST_REQUIRE_EQUAL( 8, log.account_action_count( N(alice) ) );
+      BOOST_REQUIRE( all_account_sequences( log, N(bob) ) == (std::vector<uint64_t>{ 2, 5, 8 }) );
+      for( uint32_t n = 1; n <= 5; ++n )
+         BOOST_REQUIRE_NE( 0, find_trx( log, n ) );
+   };
+
+   // closed cleanly, the heads are loaded
+   check();
+
+   // missing account heads and buckets are rebuilt from the indexes
+   boost::filesystem::remove( dir / "history_account.heads" );
+   boost::filesystem::remove( dir / "history_trx.buckets" );
+   check();
+
+   // as are account heads which do not match the index
+   append_bytes( dir / "history_account.heads", 3 );
+   check();
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(replays_from_checkpoint) { try {
+   fc::temp_directory tempdir;
+   const boost::filesystem::path root = tempdir.path();
+   const auto crashed = root / "crashed";
+   const auto dir = root / "history";
+   boost::filesystem::create_directories( dir );
+   block_builder bb;
+
+   {
+      history_log log( dir, 2 );
+      for( uint32_t n = 1; n <= 5; ++n ) {
+         auto b = bb.start( n );
+         bb.add( b, n, { N(alice) } );
+         if( n % 2 )
+            bb.add( b, n, { N(bob), N(alice) } );
+         log.append_block( b );
+      }
+      copy_open_log( dir, crashed, true );
+   }
+
+   // the last checkpoint was after block 4, which ends with 8 account entries and 4 transaction entries
+   {
+      std::ifstream f( (crashed / "history_account.heads").generic_string(), std::ios_base::binary );
+      std::vector<char> header( 16 );
+      f.read( header.data(), header.size() );
+      fc::datastream<const char*> ds( header.data(), header.size() );
+      uint64_t account_entries = 0, trx_entries = 0;
+      fc::raw::unpack( ds, account_entries );
+      fc::raw::unpack( ds, trx_entries );
+      BOOST_REQUIRE_EQUAL( 8, account_entries );
+      BOOST_REQUIRE_EQUAL( 4, trx_entries );
+   }
+
+   history_log log( crashed, 2 );
+   BOOST_REQUIRE_EQUAL( 5, log.head_block_num() );
+   BOOST_REQUIRE_EQUAL( 8, log.account_action_count( N(alice) ) );
+   BOOST_REQUIRE( all_account_sequences( log, N(bob) ) == (std::vector<uint64_t>{ 2, 5, 8 }) );
+   BOOST_REQUIRE( all_account_sequences( log, N(alice) ) == (std::vector<uint64_t>{ 1, 2, 3, 4, 5, 6, 7, 8 }) );
+   for( uint32_t n = 1; n <= 5; ++n )
+      BOOST_REQUIRE_NE( 0, find_trx( log, n ) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(jump_lookups_at_boundaries) { try {
+   fc::temp_directory tempdir;
+   block_builder bb;
+   history_log log( tempdir.path() );
+
+   std::vector<uint64_t> alice;
+   std::vector<uint64_t> bob;
+   for( uint32_t n = 1; n <= 30; ++n ) {
+      auto b = bb.start( n );
+      for( uint32_t i = 0; i < 10; ++i ) {
+         const bool with_bob = alice.size() % 3 == 0;
+         const auto seq = with_bob ? bb.add( b, n, { N(alice), N(bob) } ) : bb.add( b, n, { N(alice) } );
+         alice.push_back( seq );
+         if( with_bob )
+            bob.push_back( seq );
+      }
+      log.append_block( b );
+   }
+   BOOST_REQUIRE_EQUAL( 300, log.account_action_count( N(alice) ) );
+
+   auto slice = []( const std::vector<uint64_t>& v, int32_t first, int32_t last ) {
+      return std::vector<uint64_t>( v.begin() + first, v.begin() + last + 1 );
+   };
+
+   // the jumps span 2^k - 1 entries, so check the ranges starting and ending around those
+   std::vector<int32_t> bounds;
+   for( int32_t k = 1; k <= 256; k *= 2 ) {
+      for( int32_t b : { k - 2, k - 1, k } ) {
+         if( b >= 0 )
+            bounds.push_back( b );
+      }
+   }
+   bounds.push_back( 298 );
+   bounds.push_back( 299 );
+   for( auto first : bounds ) {
+      for( auto last : bounds ) {
+         if( first <= last )
+            BOOST_REQUIRE( account_sequences( log, N(alice), first, last ) == slice( alice, first, last ) );
+      }
+   }
+   for( int32_t k = 0; k < 300; ++k )
+      BOOST_REQUIRE( account_sequences( log, N(alice), k, k ) == slice( alice, k, k ) );
+   BOOST_REQUIRE( all_account_sequences( log, N(bob) ) == bob );
+
+   // ranges are clipped to the actions of the account
+   BOOST_REQUIRE( account_sequences( log, N(alice), -5, 2 ) == slice( alice, 0, 2 ) );
+   BOOST_REQUIRE( account_sequences( log, N(alice), 298, 1000 ) == slice( alice, 298, 299 ) );
+   BOOST_REQUIRE( account_sequences( log, N(alice), 300, 310 ).empty() );
+   BOOST_REQUIRE( account_sequences( log, N(alice), 5, 4 ).empty() );
+   BOOST_REQUIRE( account_sequences( log, N(carol), 0, 10 ).empty() );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(reversible_fork_removal) { try {
+   fc::temp_directory tempdir;
+   block_builder bb;
+   history_reversible_blocks reversible;
+
+   auto find = [&]( uint32_t trx ) {
+      const auto id = make_trx_id( trx );
+      return reversible.find_transaction( id, [&]( const transaction_id_type& t ) { return t == id; } ).first;
+   };
+   auto alice_sequences = [&]() {
+      std::vector<uint64_t> result;
+      for( const auto& a : reversible.account_actions( N(alice) ) )
+         result.push_back( a.second->action_sequence_num );
+      return result;
+   };
+
+   for( uint32_t n = 1; n <= 3; ++n ) {
+      auto b = bb.start( n );
+      bb.add( b, n, { N(alice) } );
+      reversible.add_block( std::move( b ) );
+   }
+   BOOST_REQUIRE( alice_sequences() == (std::vector<uint64_t>{ 1, 2, 3 }) );
+   BOOST_REQUIRE( find( 3 ) != nullptr );
+
+   // block 2 of another branch replaces blocks 2 and 3
+   auto fork = bb.start( 2, 1 );
+   bb.add( fork, 4, { N(alice), N(bob) } );
+   reversible.add_block( std::move( fork ) );
+   BOOST_REQUIRE_EQUAL( 2, reversible.last_block_num() );
+   BOOST_REQUIRE( make_block_id( 2, 1 ) == reversible.find_block( 2 )->block_id );
+   BOOST_REQUIRE( reversible.find_block( 3 ) == nullptr );
+   BOOST_REQUIRE( alice_sequences() == (std::vector<uint64_t>{ 1, 4 }) );
+   BOOST_REQUIRE_EQUAL( 1, reversible.account_actions( N(bob) ).size() );
+   BOOST_REQUIRE( find( 2 ) == nullptr );
+   BOOST_REQUIRE( find( 3 ) == nullptr );
+   BOOST_REQUIRE( find( 4 ) != nullptr );
+
+   auto b3 = bb.start( 3, 1 );
+   bb.add( b3, 5, { N(alice) } );
+   reversible.add_block( std::move( b3 ) );
+
+   // irreversible blocks leave from the front
+   reversible.remove_through( 1 );
+   BOOST_REQUIRE( reversible.find_block( 1 ) == nullptr );
+   BOOST_REQUIRE( alice_sequences() == (std::vector<uint64_t>{ 4, 5 }) );
+   BOOST_REQUIRE( find( 1 ) == nullptr );
+
+   // and are kept over a restart, without the ones the log already has
+   const auto file = boost::filesystem::path( tempdir.path() ) / "reversible.bin";
+   reversible.write( file );
+   BOOST_REQUIRE( reversible.empty() );
+   reversible.load( file, 2 );
+   BOOST_REQUIRE( alice_sequences() == (std::vector<uint64_t>{ 5 }) );
+   BOOST_REQUIRE( reversible.account_actions( N(bob) ).empty() );
+   BOOST_REQUIRE( find( 5 ) != nullptr );
+
+   reversible.remove_through( 3 );
+   BOOST_REQUIRE( reversible.empty() );
+   BOOST_REQUIRE( reversible.account_actions( N(alice) ).empty() );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
@@ -0,0 +1,154 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/producer_plugin/incoming_transaction_queue.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+namespace eosio {
+
+using namespace eosio::chain;
+
+namespace {
+
+   using queue = incoming_transaction_queue;
+
+   /// a transaction of account, told apart from the others by tag
+   queue::entry make_entry( account_name account, uint16_t tag ) {
+      signed_transaction trx;
+      trx.ref_block_num = tag;
+      trx.actions.emplace_back( vector<permission_level>{{account, config::active_name}}, N(eosio), N(nonce), bytes() );
+      queue::entry e;
+      e.mtrx = std::make_shared<transaction_metadata>( trx );
+      return e;
+   }
+
+   struct drop_recorder {
+      vector<pair<uint16_t, queue::drop_reason>> dropped;
+
+      queue::drop_handler handler() {
+         return [this]( queue::entry&& e, queue::drop_reason r ) {
+            dropped.emplace_back( e.mtrx->trx.ref_block_num, r );
+         };
+      }
+   };
+
+   vector<uint16_t> pop_all( queue& q ) {
+      vector<uint16_t> tags;
+      while( !q.empty() )
+         tags.push_back( q.pop().mtrx->trx.ref_block_num );
+      return tags;
+   }
+
+}
+
+BOOST_AUTO_TEST_SUITE(incoming_transaction_queue_tests)
+
+BOOST_AUTO_TEST_CASE(per_account_limit) { try {
+   queue q;
+   q.set_limits( 0, 2 );
+   drop_recorder r;
+
+   q.add( make_entry( N(alice), 1 ), r.handler() );
+   q.add( make_entry( N(alice), 2 ), r.handler() );
+   q.add( make_entry( N(bob), 3 ), r.handler() );
+   BOOST_REQUIRE( r.dropped.empty() );
+
+   q.add( make_entry( N(alice), 4 ), r.handler() );
+   BOOST_REQUIRE_EQUAL( 1, r.dropped.size() );
+   BOOST_REQUIRE_EQUAL( 4, r.dropped[0].first );
+   BOOST_REQUIRE( r.dropped[0].second == queue::drop_reason::account_limit );
+   BOOST_REQUIRE_EQUAL( 3, q.size() );
+   BOOST_REQUIRE_EQUAL( 3, q.get_stats().queued );
+   BOOST_REQUIRE_EQUAL( 1, q.get_stats().dropped_account_limit );
+
+   // once one of its transactions is applied the account may queue another
+   BOOST_REQUIRE_EQUAL( 1, q.pop().mtrx->trx.ref_block_num );
+   q.add( make_entry( N(alice), 5 ), r.handler() );
+   BOOST_REQUIRE_EQUAL( 1, r.dropped.size() );
+   BOOST_REQUIRE( pop_all( q ) == (vector<uint16_t>{ 3, 2, 5 }) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(evicts_from_lowest_lane) { try {
+   queue q;
+   q.set_limits( 4, 0 );
+   q.set_priority_accounts( { N(carol) } );
+   drop_recorder r;
+
+   q.add( make_entry( N(alice), 1 ), r.handler() );
+   q.add( make_entry( N(alice), 2 ), r.handler() );
+   q.add( make_entry( N(alice), 3 ), r.handler() );
+   q.add( make_entry( N(carol), 4 ), r.handler() );
+   BOOST_REQUIRE( r.dropped.empty() );
+
+   // the newest transaction of the largest normal account makes room
+   q.add( make_entry( N(bob), 5 ), r.handler() );
+   BOOST_REQUIRE_EQUAL( 1, r.dropped.size() );
+   BOOST_REQUIRE_EQUAL( 3, r.dropped[0].first );
+   BOOST_REQUIRE( r.dropped[0].second == queue::drop_reason::queue_full );
+
+   // a new transaction which would be the next to evict is dropped itself
+   q.add( make_entry( N(alice), 6 ), r.handler() );
+   BOOST_REQUIRE_EQUAL( 2, r.dropped.size() );
+   BOOST_REQUIRE_EQUAL( 6, r.dropped[1].first );
+
+   // a priority transaction evicts a normal one, even from a smaller account
+   q.add( make_entry( N(carol), 7 ), r.handler() );
+   BOOST_REQUIRE_EQUAL( 3, r.dropped.size() );
+   BOOST_REQUIRE_EQUAL( 2, r.dropped[2].first );
+
+   BOOST_REQUIRE_EQUAL( 4, q.size() );
+   BOOST_REQUIRE_EQUAL( 3, q.get_stats().dropped_queue_full );
+   BOOST_REQUIRE( pop_all( q ) == (vector<uint16_t>{ 4, 7, 1, 5 }) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(priority_never_evicted_for_normal) { try {
+   queue q;
+   q.set_limits( 3, 0 );
+   q.set_priority_accounts( { N(carol), N(dave), N(erin) } );
+   drop_recorder r;
+
+   q.add( make_entry( N(carol), 1 ), r.handler() );
+   q.add( make_entry( N(carol), 2 ), r.handler() );
+   q.add( make_entry( N(dave), 3 ), r.handler() );
+
+   q.add( make_entry( N(alice), 4 ), r.handler() );
+   BOOST_REQUIRE_EQUAL( 1, r.dropped.size() );
+   BOOST_REQUIRE_EQUAL( 4, r.dropped[0].first );
+   BOOST_REQUIRE( r.dropped[0].second == queue::drop_reason::queue_full );
+
+   // within the priority lane the largest account still gives way
+   q.add( make_entry( N(erin), 6 ), r.handler() );
+   BOOST_REQUIRE_EQUAL( 2, r.dropped.size() );
+   BOOST_REQUIRE_EQUAL( 2, r.dropped[1].first );
+
+   BOOST_REQUIRE( pop_all( q ) == (vector<uint16_t>{ 1, 3, 6 }) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(round_robin_order) { try {
+   queue q;
+   q.set_priority_accounts( { N(carol) } );
+   drop_recorder r;
+
+   q.add( make_entry( N(alice), 1 ), r.handler() );
+   q.add( make_entry( N(alice), 2 ), r.handler() );
+   q.add( make_entry( N(alice), 3 ), r.handler() );
+   q.add( make_entry( N(bob), 4 ), r.handler() );
+   q.add( make_entry( N(bob), 5 ), r.handler() );
+   q.add( make_entry( N(carol), 6 ), r.handler() );
+   q.add( make_entry( N(carol), 7 ), r.handler() );
+   BOOST_REQUIRE( r.dropped.empty() );
+
+   // the priority lane is served first, then one transaction per account in turn
+   BOOST_REQUIRE( pop_all( q ) == (vector<uint16_t>{ 6, 7, 1, 4, 2, 5, 3 }) );
+   BOOST_REQUIRE_EQUAL( 0, q.size() );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
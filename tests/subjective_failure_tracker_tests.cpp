@@ -0,0 +1,105 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <eosio/producer_plugin/subjective_failure_tracker.hpp>
+
+#include <boost/test/unit_test.hpp>
+
+namespace eosio {
+
+using namespace eosio::chain;
+
+BOOST_AUTO_TEST_SUITE(subjective_failure_tracker_tests)
+
+BOOST_AUTO_TEST_CASE(disabled) { try {
+   subjective_failure_tracker t;
+   const fc::time_point now( fc::seconds(1000000) );
+
+   t.charge( N(alice), fc::milliseconds(500), now );
+   BOOST_REQUIRE_EQUAL( 0, t.size() );
+   BOOST_REQUIRE( !t.is_throttled( N(alice), now ) );
+
+   // nothing is charged for a failure which took no time
+   t.set_limits( fc::milliseconds(100), fc::seconds(60), 0 );
+   t.charge( N(alice), fc::microseconds(), now );
+   BOOST_REQUIRE_EQUAL( 0, t.size() );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(decay) { try {
+   subjective_failure_tracker t;
+   t.set_limits( fc::milliseconds(100), fc::seconds(60), 0 );
+   const fc::time_point now( fc::seconds(1000000) );
+
+   // 100ms decay every 60s, so 50ms is cleared after 30s
+   t.charge( N(alice), fc::milliseconds(50), now );
+   BOOST_REQUIRE_EQUAL( 50000, t.get_charge( N(alice), now ).count() );
+   BOOST_REQUIRE_EQUAL( 25000, t.get_charge( N(alice), now + fc::seconds(15) ).count() );
+   BOOST_REQUIRE_EQUAL( 0, t.get_charge( N(alice), now + fc::seconds(30) ).count() );
+   BOOST_REQUIRE_EQUAL( 0, t.get_charge( N(bob), now ).count() );
+
+   // a charge adds to what is left, not to what was charged
+   t.charge( N(alice), fc::milliseconds(50), now + fc::seconds(15) );
+   BOOST_REQUIRE_EQUAL( 75000, t.get_charge( N(alice), now + fc::seconds(15) ).count() );
+   t.charge( N(alice), fc::milliseconds(20), now + fc::seconds(120) );
+   BOOST_REQUIRE_EQUAL( 20000, t.get_charge( N(alice), now + fc::seconds(120) ).count() );
+
+   BOOST_REQUIRE_EQUAL( 0, t.remove_decayed( now + fc::seconds(120) ) );
+   BOOST_REQUIRE_EQUAL( 1, t.size() );
+   BOOST_REQUIRE_EQUAL( 1, t.remove_decayed( now + fc::seconds(132) ) );
+   BOOST_REQUIRE_EQUAL( 0, t.size() );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(throttle_threshold) { try {
+   subjective_failure_tracker t;
+   t.set_limits( fc::milliseconds(100), fc::seconds(60), 0 );
+   const fc::time_point now( fc::seconds(1000000) );
+
+   t.charge( N(alice), fc::milliseconds(99), now );
+   BOOST_REQUIRE( !t.is_throttled( N(alice), now ) );
+
+   // throttled once the charge reaches the allowance
+   t.charge( N(alice), fc::milliseconds(1), now );
+   BOOST_REQUIRE( t.is_throttled( N(alice), now ) );
+   BOOST_REQUIRE( !t.is_throttled( N(bob), now ) );
+
+   // and released as soon as any of it has decayed
+   BOOST_REQUIRE( !t.is_throttled( N(alice), now + fc::microseconds(1) ) );
+
+   t.charge( N(bob), fc::seconds(1), now );
+   BOOST_REQUIRE( t.is_throttled( N(bob), now + fc::seconds(540) ) );
+   BOOST_REQUIRE( !t.is_throttled( N(bob), now + fc::seconds(541) ) );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(eviction) { try {
+   subjective_failure_tracker t;
+   t.set_limits( fc::milliseconds(100), fc::seconds(60), 2 );
+   const fc::time_point now( fc::seconds(1000000) );
+
+   t.charge( N(alice), fc::milliseconds(10), now );
+   t.charge( N(bob), fc::milliseconds(20), now );
+   BOOST_REQUIRE_EQUAL( 2, t.size() );
+
+   // the account with the lowest charge is forgotten for a new one
+   t.charge( N(carol), fc::milliseconds(5), now );
+   BOOST_REQUIRE_EQUAL( 2, t.size() );
+   BOOST_REQUIRE_EQUAL( 0, t.get_charge( N(alice), now ).count() );
+   BOOST_REQUIRE_EQUAL( 20000, t.get_charge( N(bob), now ).count() );
+   BOOST_REQUIRE_EQUAL( 5000, t.get_charge( N(carol), now ).count() );
+
+   // charging a tracked account makes no room
+   t.charge( N(carol), fc::milliseconds(30), now );
+   BOOST_REQUIRE_EQUAL( 2, t.size() );
+   t.charge( N(dave), fc::milliseconds(1), now );
+   BOOST_REQUIRE_EQUAL( 0, t.get_charge( N(bob), now ).count() );
+   BOOST_REQUIRE_EQUAL( 35000, t.get_charge( N(carol), now ).count() );
+   BOOST_REQUIRE_EQUAL( 1000, t.get_charge( N(dave), now ).count() );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
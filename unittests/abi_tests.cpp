@@ -2698,4 +2698,235 @@ BOOST_AUTO_TEST_CASE(abi_deserialize_detailed_error_messages)
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(abi_serializer_copy_test)
+{
+   try {
+      const char* abi_str = R"=====(
+      {
+         "version": "eosio::abi/1.1",
+         "types": [{ "new_type_name": "account", "type": "name" }],
+         "structs": [
+            { "name": "base", "base": "", "fields": [{ "name": "owner", "type": "account" }] },
+            { "name": "s", "base": "base", "fields": [
+               { "name": "amounts", "type": "uint16[]" },
+               { "name": "children", "type": "s[]" },
+               { "name": "choice", "type": "v?" },
+               { "name": "memo", "type": "string$" }
+            ] }
+         ],
+         "actions": [],
+         "tables": [],
+         "ricardian_clauses": [],
+         "variants": [{ "name": "v", "types": ["uint8", "s"] }]
+      }
+      )=====";
+
+      const auto value = fc::json::from_string(R"({
+         "owner": "alice",
+         "amounts": [1, 2],
+         "children": [{ "owner": "bob", "amounts": [], "children": [], "choice": ["uint8", 7], "memo": "inner" }],
+         "choice": null,
+         "memo": "outer"
+      })");
+
+      // the type plans of a copy must not point into the serializer it was copied from
+      optional<abi_serializer> copy;
+      {
+         abi_serializer abis( fc::json::from_string(abi_str).as<abi_def>(), max_serialization_time );
+         copy = abis;
+      }
+      auto bin = copy->variant_to_binary( "s", value, max_serialization_time );
+      auto var = copy->binary_to_variant( "s", bin, max_serialization_time );
+      BOOST_CHECK_EQUAL( fc::json::to_string(value), fc::json::to_string(var) );
+
+      abi_serializer assigned;
+      assigned = *copy;
+      copy.reset();
+      BOOST_CHECK_EQUAL( fc::json::to_string(value), fc::json::to_string(assigned.binary_to_variant( "s", bin, max_serialization_time )) );
+
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(abi_binary_to_json_test)
+{
+   try {
+      const char* abi_str = R"=====(
+      {
+         "version": "eosio::abi/1.1",
+         "types": [{ "new_type_name": "account", "type": "name" }],
+         "structs": [
+            { "name": "base", "base": "", "fields": [{ "name": "owner", "type": "account" }] },
+            { "name": "s", "base": "base", "fields": [
+               { "name": "amounts", "type": "uint64[]" },
+               { "name": "children", "type": "s[]" },
+               { "name": "choice", "type": "v?" },
+               { "name": "memo", "type": "string$" }
+            ] }
+         ],
+         "actions": [],
+         "tables": [],
+         "ricardian_clauses": [],
+         "variants": [{ "name": "v", "types": ["uint8", "s"] }]
+      }
+      )=====";
+
+      const auto value = fc::json::from_string(R"({
+         "owner": "alice",
+         "amounts": [1, "18446744073709551615"],
+         "children": [{ "owner": "bob", "amounts": [], "children": [], "choice": ["uint8", 7], "memo": "in\"ner" }],
+         "choice": ["s", { "owner": "carol", "amounts": [], "children": [] }],
+         "memo": "outer"
+      })");
+
+      abi_serializer abis( fc::json::from_string(abi_str).as<abi_def>(), max_serialization_time );
+      auto bin = abis.variant_to_binary( "s", value, max_serialization_time );
+
+      string json;
+      abis.binary_to_json( "s", bin, json, max_serialization_time );
+      BOOST_CHECK_EQUAL( fc::json::to_string(abis.binary_to_variant( "s", bin, max_serialization_time )), json );
+
+      // types without a plan take the variant path
+      json.clear();
+      abis.binary_to_json( "name", fc::raw::pack(N(dave)), json, max_serialization_time );
+      BOOST_CHECK_EQUAL( "\"dave\"", json );
+
+      bin.resize( bin.size() - 4 );
+      json.clear();
+      BOOST_CHECK_THROW( abis.binary_to_json( "s", bin, json, max_serialization_time ), unpack_exception );
+
+      // a field name repeated by a struct or its base is written once, in its first position with its last value
+      const char* dup_abi_str = R"=====(
+      {
+         "version": "eosio::abi/1.1",
+         "types": [],
+         "structs": [
+            { "name": "base", "base": "", "fields": [{ "name": "a", "type": "uint8" }, { "name": "b", "type": "uint8" }] },
+            { "name": "d", "base": "base", "fields": [{ "name": "a", "type": "string" }, { "name": "c", "type": "uint8" }] },
+            { "name": "outer", "base": "", "fields": [{ "name": "inner", "type": "d[]" }] }
+         ],
+         "actions": [],
+         "tables": [],
+         "ricardian_clauses": [],
+         "variants": []
+      }
+      )=====";
+      abi_serializer dup_abis( fc::json::from_string(dup_abi_str).as<abi_def>(), max_serialization_time );
+      const bytes dup_bin = { 1, 1, 2, 1, 'x', 3 };
+      json.clear();
+      dup_abis.binary_to_json( "outer", dup_bin, json, max_serialization_time );
+      BOOST_CHECK_EQUAL( "{\"inner\":[{\"a\":\"x\",\"b\":2,\"c\":3}]}", json );
+      BOOST_CHECK_EQUAL( fc::json::to_string(dup_abis.binary_to_variant( "outer", dup_bin, max_serialization_time )), json );
+
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(abi_to_json_block_test)
+{
+   try {
+      const char* hi_abi = R"=====(
+      {
+         "version": "eosio::abi/1.0",
+         "types": [],
+         "structs": [{ "name": "hi", "base": "", "fields": [{ "name": "user", "type": "name" }, { "name": "amounts", "type": "uint64[]" }] }],
+         "actions": [{ "name": "hi", "type": "hi", "ricardian_contract": "" }],
+         "tables": [],
+         "ricardian_clauses": [],
+         "variants": []
+      }
+      )=====";
+      abi_serializer abis( fc::json::from_string(hi_abi).as<abi_def>(), max_serialization_time );
+      auto resolver = [&abis]( const account_name& name ) -> optional<abi_serializer> {
+         if( name == N(hello) )
+            return abis;
+         return optional<abi_serializer>();
+      };
+
+      const auto hi_bin = abis.variant_to_binary( "hi", fc::json::from_string(R"({"user":"alice","amounts":[1,"18446744073709551615"]})"),
+                                                  max_serialization_time );
+      signed_transaction trx;
+      trx.context_free_actions.emplace_back( vector<permission_level>{}, N(hello), N(hi), hi_bin );
+      trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}}, N(hello), N(hi), hi_bin );
+      // data the abi can not decode and accounts without an abi are written as hex
+      trx.actions.emplace_back( vector<permission_level>{}, N(hello), N(hi), bytes{1} );
+      trx.actions.emplace_back( vector<permission_level>{}, N(hello), N(bye), hi_bin );
+      trx.actions.emplace_back( vector<permission_level>{}, N(other), N(hi), hi_bin );
+      trx.context_free_data.emplace_back( bytes{4, 5} );
+
+      signed_block block;
+      block.producer = N(bob);
+      block.transactions.emplace_back( packed_transaction( trx ) );
+      block.transactions.emplace_back( packed_transaction( trx, packed_transaction::zlib ) );
+      block.transactions.emplace_back( trx.id() );
+
+      fc::variant var;
+      abi_serializer::to_variant( block, var, resolver, max_serialization_time );
+      string json;
+      abi_serializer::to_json( block, json, resolver, max_serialization_time );
+      BOOST_CHECK_EQUAL( fc::json::to_string(var), json );
+
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(abi_serializer_cache_test)
+{
+   try {
+      const char* hi_abi = R"=====(
+      {
+         "version": "eosio::abi/1.0",
+         "types": [],
+         "structs": [{ "name": "hi", "base": "", "fields": [{ "name": "user", "type": "name" }] }],
+         "actions": [{ "name": "hi", "type": "hi", "ricardian_contract": "" }],
+         "tables": [],
+         "ricardian_clauses": [],
+         "variants": []
+      }
+      )=====";
+      const char* bye_abi = R"=====(
+      {
+         "version": "eosio::abi/1.0",
+         "types": [],
+         "structs": [{ "name": "bye", "base": "", "fields": [{ "name": "user", "type": "name" }] }],
+         "actions": [{ "name": "bye", "type": "bye", "ricardian_contract": "" }],
+         "tables": [],
+         "ricardian_clauses": [],
+         "variants": []
+      }
+      )=====";
+
+      tester chain;
+      chain.create_accounts( {N(alice)} );
+      BOOST_CHECK( !chain.control->get_cached_abi( N(alice), max_serialization_time ) );
+      BOOST_CHECK( !chain.control->get_cached_abi( N(nobody), max_serialization_time ) );
+
+      chain.set_abi( N(alice), hi_abi );
+      chain.produce_block();
+      auto first = chain.control->get_cached_abi( N(alice), max_serialization_time );
+      BOOST_REQUIRE( first );
+      BOOST_CHECK_EQUAL( first->serializer.get_action_type( N(hi) ), "hi" );
+      BOOST_CHECK( first == chain.control->get_cached_abi( N(alice), max_serialization_time ) );
+
+      // setabi replaces the cached serializer
+      chain.set_abi( N(alice), bye_abi );
+      chain.produce_block();
+      auto second = chain.control->get_cached_abi( N(alice), max_serialization_time );
+      BOOST_REQUIRE( second );
+      BOOST_CHECK( first != second );
+      BOOST_CHECK_EQUAL( second->serializer.get_action_type( N(bye) ), "bye" );
+      BOOST_CHECK_EQUAL( second->serializer.get_action_type( N(hi) ), "" );
+
+      // an aborted setabi and another one with the same abi_sequence
+      chain.set_abi( N(alice), hi_abi );
+      auto aborted = chain.control->get_cached_abi( N(alice), max_serialization_time );
+      BOOST_REQUIRE( aborted );
+      BOOST_CHECK_EQUAL( aborted->serializer.get_action_type( N(hi) ), "hi" );
+      chain.control->abort_block();
+      chain.set_abi( N(alice), bye_abi );
+      auto third = chain.control->get_cached_abi( N(alice), max_serialization_time );
+      BOOST_REQUIRE( third );
+      BOOST_CHECK( third != aborted );
+      BOOST_CHECK_EQUAL( third->serializer.get_action_type( N(bye) ), "bye" );
+
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -294,6 +294,39 @@ BOOST_AUTO_TEST_CASE(link_then_update_auth) { try {
 
 } FC_LOG_AND_RETHROW() }
 
+BOOST_AUTO_TEST_CASE(update_auth_in_failed_transaction) { try {
+   TESTER chain;
+
+   chain.create_account("alice");
+
+   const auto first_priv_key = chain.get_private_key("alice", "first");
+   const auto first_pub_key = first_priv_key.get_public_key();
+   const auto second_priv_key = chain.get_private_key("alice", "second");
+   const auto second_pub_key = second_priv_key.get_public_key();
+
+   chain.set_authority("alice", "first", first_pub_key, "active");
+   chain.produce_block();
+
+   const auto& authorization = chain.control->get_authorization_manager();
+   // Resolve "first" in this block
+   BOOST_REQUIRE_NO_THROW(authorization.check_authorization(N(alice), N(first), {first_pub_key}));
+
+   // Update "first" auth public key in a transaction that fails afterwards, so the update is undone
+   signed_transaction trx;
+   trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}},
+                             updateauth{ N(alice), N(first), config::active_name, authority(second_pub_key) } );
+   trx.actions.emplace_back( vector<permission_level>{{N(alice), config::active_name}},
+                             linkauth{ N(alice), N(eosio), N(reqauth), N(nonexistent) } );
+   chain.set_transaction_headers(trx);
+   trx.sign( chain.get_private_key(N(alice), "active"), chain.control->get_chain_id() );
+   BOOST_CHECK_THROW(chain.push_transaction(trx), permission_query_exception);
+
+   // Still in the same block, "first" must be resolved to its restored authority
+   BOOST_CHECK_NO_THROW(authorization.check_authorization(N(alice), N(first), {first_pub_key}));
+   BOOST_CHECK_THROW(authorization.check_authorization(N(alice), N(first), {second_pub_key}), unsatisfied_authorization);
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_CASE(create_account) {
 try {
    TESTER chain;
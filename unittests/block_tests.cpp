@@ -5,6 +5,7 @@
 
 #include <boost/test/unit_test.hpp>
 #include <eosio/testing/tester.hpp>
+#include <eosio/chain/block_log.hpp>
 
 using namespace eosio;
 using namespace testing;
@@ -163,4 +164,142 @@ BOOST_AUTO_TEST_CASE(untrusted_producer_test)
    }) ;
 }
 
+BOOST_AUTO_TEST_CASE(replay_lookahead_test) { try {
+   tester chain;
+
+   chain.create_accounts( {N(alice), N(bob), N(carol)} );
+   chain.produce_blocks(20);
+   chain.create_account( N(dave) );
+   chain.produce_blocks(20);
+   chain.close();
+
+   // replay a copy of the block log into a fresh state database
+   auto replay = [&]( uint16_t lookahead, bool force_all_checks ) {
+      fc::temp_directory tempdir;
+      controller::config cfg = chain.get_config();
+      cfg.blocks_dir = tempdir.path() / config::default_blocks_dir_name;
+      cfg.state_dir = tempdir.path() / config::default_state_dir_name;
+      cfg.replay_lookahead_blocks = lookahead;
+      cfg.force_all_checks = force_all_checks;
+      fc::create_directories( cfg.blocks_dir );
+      fc::copy( chain.get_config().blocks_dir / "blocks.log", cfg.blocks_dir / "blocks.log" );
+
+      tester replayed( cfg );
+      return std::make_pair( replayed.control->head_block_id(), replayed.control->calculate_integrity_hash() );
+   };
+
+   auto sequential = replay( 0, false );
+   auto pipelined = replay( 4, false );
+   auto pipelined_all_checks = replay( 4, true );
+
+   BOOST_REQUIRE( sequential.first == pipelined.first );
+   BOOST_REQUIRE( sequential.second == pipelined.second );
+   BOOST_REQUIRE( sequential.first == pipelined_all_checks.first );
+   BOOST_REQUIRE( sequential.second == pipelined_all_checks.second );
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(packed_block_read_test) { try {
+   tester chain;
+
+   chain.create_accounts( {N(alice), N(bob)} );
+   chain.produce_blocks(10);
+   chain.close();
+
+   for( bool mmap_reads : {false, true} ) {
+      block_log blog( chain.get_config().blocks_dir, mmap_reads );
+      auto head = blog.read_head();
+      BOOST_REQUIRE( head );
+
+      for( uint32_t n = blog.first_block_num(); n <= head->block_num(); ++n ) {
+         auto b = blog.read_block_by_num( n );
+         BOOST_REQUIRE( b );
+         auto expected = fc::raw::pack( *b );
+
+         auto packed = blog.read_packed_block_by_num( n );
+         BOOST_REQUIRE( packed );
+         BOOST_REQUIRE_EQUAL( packed.size, expected.size() );
+         BOOST_REQUIRE( memcmp( packed.data, expected.data(), expected.size() ) == 0 );
+      }
+
+      BOOST_REQUIRE( !blog.read_packed_block_by_num( head->block_num() + 1 ) );
+   }
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(block_log_segment_test) { try {
+   tester chain;
+
+   chain.create_accounts( {N(alice), N(bob)} );
+   chain.produce_blocks(20);
+   chain.close();
+
+   fc::temp_directory tempdir;
+   auto blocks_dir = tempdir.path() / config::default_blocks_dir_name;
+
+   block_log original( chain.get_config().blocks_dir );
+   auto head = original.read_head();
+   BOOST_REQUIRE( head );
+   const auto gs = block_log::extract_genesis_state( chain.get_config().blocks_dir );
+
+   auto check_blocks = [&]( const block_log& blog ) {
+      BOOST_REQUIRE_EQUAL( blog.first_block_num(), original.first_block_num() );
+      BOOST_REQUIRE( blog.read_head()->id() == head->id() );
+      for( uint32_t n = original.first_block_num(); n <= head->block_num(); ++n ) {
+         auto b = blog.read_block_by_num( n );
+         BOOST_REQUIRE( b );
+         BOOST_REQUIRE( b->id() == original.read_block_by_num( n )->id() );
+         auto expected = fc::raw::pack( *b );
+         auto packed = blog.read_packed_block_by_num( n );
+         BOOST_REQUIRE_EQUAL( packed.size, expected.size() );
+         BOOST_REQUIRE( memcmp( packed.data, expected.data(), expected.size() ) == 0 );
+      }
+   };
+
+   {
+      block_log blog( blocks_dir, false, 8 );
+      blog.reset( gs, original.read_block_by_num( 1 ) );
+      for( uint32_t n = 2; n <= head->block_num(); ++n )
+         blog.append( original.read_block_by_num( n ) );
+      // sealed segments are read before and after they are compressed
+      check_blocks( blog );
+      blog.wait_for_compression();
+      check_blocks( blog );
+   }
+   BOOST_REQUIRE( fc::exists( blocks_dir / "blocks-0000000001-0000000008.zlog" ) );
+   BOOST_REQUIRE( fc::exists( blocks_dir / "blocks-0000000009-0000000016.zlog" ) );
+   BOOST_REQUIRE( !fc::exists( blocks_dir / "blocks-0000000001-0000000008.log" ) );
+
+   // segment indexes are rebuilt when missing
+   fc::remove_all( blocks_dir / "blocks-0000000001-0000000008.zindex" );
+   {
+      block_log reopened( blocks_dir );
+      check_blocks( reopened );
+   }
+
+   // repair only rebuilds blocks.log and keeps the segments
+   block_log::repair_log( blocks_dir );
+   {
+      block_log repaired( blocks_dir );
+      check_blocks( repaired );
+   }
+
+   // an existing blocks.log holding more than a segment is split into segments of that size on open
+   auto split_dir = tempdir.path() / "split";
+   fc::create_directories( split_dir );
+   fc::copy( chain.get_config().blocks_dir / "blocks.log", split_dir / "blocks.log" );
+   {
+      block_log blog( split_dir, false, 8 );
+      check_blocks( blog );
+      blog.wait_for_compression();
+   }
+   BOOST_REQUIRE( fc::exists( split_dir / "blocks-0000000001-0000000008.zlog" ) );
+   BOOST_REQUIRE( fc::exists( split_dir / "blocks-0000000009-0000000016.zlog" ) );
+   {
+      block_log reopened( split_dir );
+      check_blocks( reopened );
+   }
+
+} FC_LOG_AND_RETHROW() }
+
 BOOST_AUTO_TEST_SUITE_END()
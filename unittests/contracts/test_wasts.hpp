@@ -633,3 +633,24 @@ static const char memory_growth_memset_test[] = R"=====(
  )
 )
 )=====";
+
+static const char memory_image_reset_wast[] = R"=====(
+(module
+ (export "apply" (func $apply))
+ (import "env" "eosio_assert" (func $eosio_assert (param i32 i32)))
+ (memory $0 ${PAGES})
+ (data (i32.const 16) "${DATA}")
+ (func $apply (param $0 i64)(param $1 i64)(param $2 i64)
+   (call $eosio_assert (i32.eq (i32.load offset=16 (i32.const 0)) (i32.const ${VALUE})) (i32.const 0))
+   (call $eosio_assert (i32.eq (i32.load offset=1000 (i32.const 0)) (i32.const 0)) (i32.const 0))
+   (call $eosio_assert (i32.eq (current_memory) (i32.const ${PAGES})) (i32.const 0))
+   (drop (grow_memory (i32.const 2)))
+   (call $eosio_assert (i32.eq (i32.load offset=${GROWN_1} (i32.const 0)) (i32.const 0)) (i32.const 0))
+   (call $eosio_assert (i32.eq (i32.load offset=${GROWN_2} (i32.const 0)) (i32.const 0)) (i32.const 0))
+   (i32.store offset=16 (i32.const 0) (i32.const 7))
+   (i32.store offset=1000 (i32.const 0) (i32.const 7))
+   (i32.store offset=${GROWN_1} (i32.const 0) (i32.const 7))
+   (i32.store offset=${GROWN_2} (i32.const 0) (i32.const 7))
+ )
+)
+)=====";
@@ -7,6 +7,7 @@
 #include <eosio/chain/authority.hpp>
 #include <eosio/chain/types.hpp>
 #include <eosio/chain/asset.hpp>
+#include <eosio/chain/apply_context.hpp>
 #include <eosio/testing/tester.hpp>
 
 #include <fc/io/json.hpp>
@@ -606,6 +607,111 @@ BOOST_AUTO_TEST_CASE(transaction_test) { try {
    bytes raw2 = pkt2.get_raw_transaction();
    BOOST_CHECK_EQUAL(raw.size(), raw2.size());
 
+   // cached id, signing digest and keys match the ones computed from the signed_transaction
+   const auto& chain_id = test.control->get_chain_id();
+   packed_transaction pkt3(trx, packed_transaction::zlib);
+   BOOST_CHECK_EQUAL(trx.id(), pkt3.id());
+   BOOST_CHECK_EQUAL(trx.sig_digest(chain_id, trx.context_free_data), pkt3.sig_digest(chain_id));
+   BOOST_CHECK(trx.get_signature_keys(chain_id) == pkt3.get_signature_keys(chain_id));
+   BOOST_CHECK(trx.get_signature_keys(chain_id) == pkt3.get_signature_keys(chain_id, false, false));
+
+   packed_transaction pkt4(pkt3);
+   BOOST_CHECK_EQUAL(trx.id(), pkt4.id());
+   BOOST_CHECK_EQUAL(pkt3.sig_digest(chain_id), pkt4.sig_digest(chain_id));
+
+   // setting another transaction drops the cached values
+   signed_transaction trx2 = trx;
+   trx2.expiration = trx.expiration + fc::seconds(1);
+   pkt4.set_transaction(trx2, trx2.context_free_data, packed_transaction::none);
+   BOOST_CHECK_EQUAL(trx2.id(), pkt4.id());
+   BOOST_CHECK_EQUAL(trx2.sig_digest(chain_id, trx2.context_free_data), pkt4.sig_digest(chain_id));
+   BOOST_CHECK(trx.id() != pkt4.id());
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(object_iterator_map_erase) { try {
+   object_iterator_map<int> m;
+   BOOST_REQUIRE_EQUAL(32u, m.capacity());
+
+   // the same hash the map uses for 32 slots, to pick objects which collide
+   auto home = []( const int* p ) -> size_t {
+      return (reinterpret_cast<uintptr_t>(p) * 11400714819323198485ull) >> 59;
+   };
+
+   // runs of colliding objects, the one homed at 30 and 31 wrap around into the runs homed at 0 and 1
+   vector<int> objects(4096);
+   const vector<pair<size_t, size_t>> wanted{ {30, 4}, {31, 3}, {0, 3}, {1, 2}, {7, 3} };
+   vector<const int*> keys;
+   for( const auto& w : wanted ) {
+      size_t found = 0;
+      for( const auto& o : objects ) {
+         if( found < w.second && home( &o ) == w.first ) {
+            keys.push_back( &o );
+            ++found;
+         }
+      }
+      BOOST_REQUIRE_EQUAL(w.second, found);
+   }
+   BOOST_REQUIRE_EQUAL(15u, keys.size());
+
+   for( size_t i = 0; i < keys.size(); ++i )
+      m.insert( keys[i], i );
+   BOOST_REQUIRE_EQUAL(32u, m.capacity());
+
+   // erase in mixed order, every remaining object must still be found after each erase
+   const vector<size_t> order{ 1, 14, 4, 0, 8, 12, 6, 2, 10, 13, 5, 9, 3, 11, 7 };
+   vector<bool> erased(keys.size());
+   for( auto e : order ) {
+      m.erase( keys[e] );
+      erased[e] = true;
+      for( size_t i = 0; i < keys.size(); ++i )
+         BOOST_REQUIRE_EQUAL(erased[i] ? -1 : int(i), m.find( keys[i] ));
+   }
+
+   // erasing an absent object is a no op, and the freed slots can be reused
+   m.erase( keys[0] );
+   for( size_t i = 0; i < keys.size(); ++i )
+      m.insert( keys[i], i + 100 );
+   for( size_t i = 0; i < keys.size(); ++i )
+      BOOST_REQUIRE_EQUAL(int(i + 100), m.find( keys[i] ));
+   BOOST_REQUIRE_EQUAL(32u, m.capacity());
+
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(object_iterator_map_clear) { try {
+   object_iterator_map<int> m;
+   vector<int> objects(4096);
+   vector<const int*> all;
+   for( size_t i = 0; i < objects.size(); ++i ) {
+      m.insert( &objects[i], i );
+      all.push_back( &objects[i] );
+   }
+   const auto capacity = m.capacity();
+   BOOST_REQUIRE_LE(2*objects.size(), capacity);
+
+   // many objects, all slots are cleared
+   m.clear( all );
+   for( const auto* o : all )
+      BOOST_REQUIRE_EQUAL(-1, m.find( o ));
+
+   // a few objects in the grown map, only their slots are cleared; removed iterators are null
+   vector<const int*> few;
+   for( size_t i = 0; i < 16; ++i ) {
+      m.insert( &objects[i*7], i );
+      few.push_back( &objects[i*7] );
+   }
+   m.erase( few[3] );
+   few[3] = nullptr;
+   m.clear( few );
+   for( const auto* o : all )
+      BOOST_REQUIRE_EQUAL(-1, m.find( o ));
+   BOOST_REQUIRE_EQUAL(capacity, m.capacity());
+
+   for( size_t i = 0; i < 16; ++i )
+      m.insert( &objects[i], i );
+   for( size_t i = 0; i < 16; ++i )
+      BOOST_REQUIRE_EQUAL(int(i), m.find( &objects[i] ));
+
 } FC_LOG_AND_RETHROW() }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -11,6 +11,8 @@
 
 #include <snapshot_test/snapshot_test.wast.hpp>
 #include <snapshot_test/snapshot_test.abi.hpp>
+#include <eosio.token/eosio.token.wast.hpp>
+#include <eosio.token/eosio.token.abi.hpp>
 
 #include <sstream>
 
@@ -254,4 +256,59 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_replay_over_snapshot, SNAPSHOT_SUITE, snapsho
    BOOST_REQUIRE_EQUAL(expected_post_integrity_hash.str(), snap_chain.control->calculate_integrity_hash().str());
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_snapshot_after_table_removal, SNAPSHOT_SUITE, snapshot_suites)
+{
+   tester chain;
+
+   chain.create_accounts({N(eosio.token), N(alice), N(bob), N(carol)});
+   chain.produce_blocks(1);
+   chain.set_code(N(eosio.token), eosio_token_wast);
+   chain.set_abi(N(eosio.token), eosio_token_abi);
+   chain.produce_blocks(1);
+
+   chain.push_action(N(eosio.token), N(create), N(eosio.token), mutable_variant_object()
+      ("issuer", "eosio.token")
+      ("maximum_supply", "1000000.0000 TOK")
+   );
+   for (auto to : {N(alice), N(bob), N(carol)}) {
+      chain.push_action(N(eosio.token), N(issue), N(eosio.token), mutable_variant_object()
+         ("to", name(to))
+         ("quantity", "100.0000 TOK")
+         ("memo", "")
+      );
+   }
+   chain.produce_blocks(1);
+
+   // emptying the balance of alice removes her accounts table, leaving a gap in the table ids
+   chain.push_action(N(eosio.token), N(transfer), N(alice), mutable_variant_object()
+      ("from", "alice")
+      ("to", "bob")
+      ("quantity", "100.0000 TOK")
+      ("memo", "")
+   );
+   chain.produce_blocks(1);
+   chain.control->abort_block();
+   BOOST_REQUIRE(chain.control->db().find<table_id_object, by_code_scope_table>(
+      boost::make_tuple(N(eosio.token), N(alice), N(accounts))) == nullptr);
+
+   auto expected_integrity_hash = chain.control->calculate_integrity_hash();
+   auto writer = SNAPSHOT_SUITE::get_writer();
+   chain.control->write_snapshot(writer);
+   auto snapshot = SNAPSHOT_SUITE::finalize(writer);
+
+   // the restored tables have new ids without the gap, the state and its hash are the same
+   snapshotted_tester snap_chain(chain.get_config(), SNAPSHOT_SUITE::get_reader(snapshot), 1);
+   BOOST_REQUIRE_EQUAL(expected_integrity_hash.str(), snap_chain.control->calculate_integrity_hash().str());
+
+   chain.push_action(N(eosio.token), N(transfer), N(bob), mutable_variant_object()
+      ("from", "bob")
+      ("to", "alice")
+      ("quantity", "50.0000 TOK")
+      ("memo", "")
+   );
+   snap_chain.push_block(chain.produce_block());
+   chain.control->abort_block();
+   BOOST_REQUIRE_EQUAL(chain.control->calculate_integrity_hash().str(), snap_chain.control->calculate_integrity_hash().str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -4,6 +4,7 @@
 #include <eosio/testing/tester.hpp>
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/wasm_eosio_constraints.hpp>
+#include <eosio/chain/wasm_code_cache.hpp>
 #include <eosio/chain/resource_limits.hpp>
 #include <eosio/chain/exceptions.hpp>
 #include <eosio/chain/wast_to_wasm.hpp>
@@ -17,6 +18,7 @@
 #include <noop/noop.abi.hpp>
 
 #include <fc/io/fstream.hpp>
+#include <fc/crypto/hex.hpp>
 
 #include <Runtime/Runtime.h>
 
@@ -27,6 +29,7 @@
 #include "test_softfloat_wasts.hpp"
 
 #include <array>
+#include <fstream>
 #include <utility>
 
 #include "incbin.h"
@@ -1631,6 +1634,184 @@ BOOST_FIXTURE_TEST_CASE( mem_growth_memset, TESTER ) try {
    }
 } FC_LOG_AND_RETHROW()
 
+/**
+ * Each run of memory_image_reset_wast checks that its memory holds only the initial data, including the pages it grows,
+ * and then dirties all of it; so any state left over from an earlier run, of the same or another module, fails it.
+ */
+BOOST_FIXTURE_TEST_CASE( memory_image_reset, TESTER ) try {
+   produce_blocks(2);
+
+   create_accounts( {N(imagea), N(imageb)} );
+   produce_block();
+
+   string image_a_wast = fc::format_string(memory_image_reset_wast, fc::mutable_variant_object
+                                           ("PAGES", 1)("DATA", "\\04\\03\\02\\01")("VALUE", 0x01020304)
+                                           ("GROWN_1", 1*64*1024 + 16)("GROWN_2", 3*64*1024 - 4));
+   string image_b_wast = fc::format_string(memory_image_reset_wast, fc::mutable_variant_object
+                                           ("PAGES", 2)("DATA", "\\08\\07\\06\\05")("VALUE", 0x05060708)
+                                           ("GROWN_1", 2*64*1024 + 16)("GROWN_2", 4*64*1024 - 4));
+   set_code(N(imagea), image_a_wast.c_str());
+   set_code(N(imageb), image_b_wast.c_str());
+   produce_blocks(1);
+
+   uint32_t runs = 0;
+   auto run = [&]( account_name account ) {
+      signed_transaction trx;
+      action act;
+      act.account = account;
+      act.name = N();
+      act.authorization = vector<permission_level>{{account,config::active_name}};
+      trx.actions.push_back(act);
+      // distinct expirations keep repeated runs from being duplicates
+      set_transaction_headers(trx, DEFAULT_EXPIRATION_DELTA + ++runs);
+      trx.sign(get_private_key( account, "active" ), control->get_chain_id());
+      push_transaction(trx);
+   };
+
+   // the same module twice in a row
+   run(N(imagea));
+   run(N(imagea));
+   produce_blocks(1);
+
+   // switching between modules with different initial memory sizes
+   run(N(imageb));
+   run(N(imagea));
+   run(N(imageb));
+   run(N(imageb));
+   run(N(imagea));
+   produce_blocks(1);
+} FC_LOG_AND_RETHROW()
+
+/**
+ * Actions alternating between more contracts than there are open memory image files: every switch maps another image,
+ * some from a file still open and some from one written again, and each run still sees only its own initial memory.
+ */
+BOOST_FIXTURE_TEST_CASE( memory_image_alternating, TESTER ) try {
+   produce_blocks(2);
+
+   const uint32_t num_contracts = 20;
+   vector<account_name> accounts;
+   for( uint32_t i = 0; i < num_contracts; ++i )
+      accounts.push_back( account_name( string("image") + char('a' + i) ) );
+   create_accounts( accounts );
+   produce_block();
+
+   for( uint32_t i = 0; i < num_contracts; ++i ) {
+      const uint32_t pages = 1 + i % 3;
+      const char first_byte = char(0x10 + i);
+      string wast = fc::format_string(memory_image_reset_wast, fc::mutable_variant_object
+                                      ("PAGES", pages)("DATA", "\\" + fc::to_hex(&first_byte, 1) + "\\03\\02\\01")
+                                      ("VALUE", 0x01020300 + first_byte)
+                                      ("GROWN_1", pages*64*1024 + 16)("GROWN_2", (pages + 2)*64*1024 - 4));
+      set_code(accounts[i], wast.c_str());
+   }
+   produce_blocks(1);
+
+   uint32_t runs = 0;
+   auto run = [&]( account_name account ) {
+      signed_transaction trx;
+      action act;
+      act.account = account;
+      act.name = N();
+      act.authorization = vector<permission_level>{{account,config::active_name}};
+      trx.actions.push_back(act);
+      set_transaction_headers(trx, DEFAULT_EXPIRATION_DELTA + ++runs);
+      trx.sign(get_private_key( account, "active" ), control->get_chain_id());
+      push_transaction(trx);
+   };
+
+   // a few recent contracts back and forth, then rounds over all of them
+   for( uint32_t round = 0; round < 3; ++round ) {
+      run(accounts[0]);
+      run(accounts[1]);
+      run(accounts[2]);
+   }
+   produce_blocks(1);
+   for( uint32_t round = 0; round < 2; ++round ) {
+      for( const auto& a : accounts )
+         run(a);
+      produce_blocks(1);
+   }
+} FC_LOG_AND_RETHROW()
+
+/**
+ * A node restarted with a wasm code cache finds the code it applied before, along with its use counts, and the cache
+ * holds no more contracts than its limit.
+ */
+BOOST_AUTO_TEST_CASE( wasm_code_cache_restart ) try {
+   fc::temp_directory cache_dir;
+   tester chain;
+   auto cfg = chain.get_config();
+   chain.close();
+   cfg.wasm_code_cache_dir = cache_dir.path();
+   cfg.wasm_code_cache_max_entries = 2;
+   chain.init( cfg );
+
+   chain.create_accounts( {N(noop)} );
+   chain.produce_block();
+   chain.set_code( N(noop), noop_wast );
+   chain.set_abi( N(noop), noop_abi );
+   chain.produce_block();
+
+   uint32_t runs = 0;
+   auto run = [&]() {
+      chain.push_action( N(noop), N(anyaction), N(noop), mutable_variant_object()
+                         ("from", "noop")
+                         ("type", "some type")
+                         ("data", "some data goes here"),
+                         base_tester::DEFAULT_EXPIRATION_DELTA + ++runs );
+   };
+   run();
+   run();
+   run();
+   chain.produce_block();
+
+   const auto code_id = chain.control->db().get<account_object,by_name>( N(noop) ).code_version;
+   BOOST_REQUIRE( fc::exists( cache_dir.path() / (code_id.str() + ".wasm") ) );
+   chain.close();
+
+   {
+      wasm_code_cache cache( cache_dir.path(), 2 );
+      BOOST_REQUIRE( cache.load( code_id ) );
+      auto most_used = cache.most_used( 2 );
+      BOOST_REQUIRE_EQUAL( most_used.size(), 1 );
+      BOOST_REQUIRE( most_used.front() == code_id );
+   }
+
+   // the cached code is instantiated at startup and applied again
+   cfg.wasm_code_cache_warmup = 1;
+   chain.init( cfg );
+   run();
+   chain.produce_block();
+   chain.close();
+
+   {
+      wasm_code_cache cache( cache_dir.path(), 2 );
+      const wasm_code_cache::entry e{ {1, 2, 3}, {} };
+      const auto a = digest_type::hash( std::string("a") );
+      const auto b = digest_type::hash( std::string("b") );
+      cache.store( a, e );
+      cache.record_use( a );
+      // the least used code makes room for b
+      cache.store( b, e );
+      BOOST_REQUIRE( !cache.load( a ) );
+      BOOST_REQUIRE( cache.load( b ) );
+      BOOST_REQUIRE( cache.load( code_id ) );
+   }
+
+   // code injected by another build is discarded
+   {
+      const auto other_build = fc::raw::pack( std::make_pair( wasm_code_cache::format_version, string("other") ) );
+      std::ofstream out( (cache_dir.path() / "version.bin").generic_string(), std::ios::out | std::ios::binary | std::ios::trunc );
+      out.write( other_build.data(), other_build.size() );
+   }
+   {
+      wasm_code_cache cache( cache_dir.path(), 2 );
+      BOOST_REQUIRE( !cache.load( code_id ) );
+      BOOST_REQUIRE( cache.most_used( 2 ).empty() );
+   }
+} FC_LOG_AND_RETHROW()
+
 INCBIN(fuzz1, "fuzz1.wasm");
 INCBIN(fuzz2, "fuzz2.wasm");
 INCBIN(fuzz3, "fuzz3.wasm");